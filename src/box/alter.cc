@@ -347,6 +347,9 @@ index_opts_create(struct index_opts *opts, const char *map)
 	if (opts->run_size_ratio <= 1)
 		tnt_raise(ClientError, ER_WRONG_SPACE_OPTIONS, INDEX_OPTS,
 			  "run_size_ratio must be > 1");
+	if (opts->memory_limit < 0)
+		tnt_raise(ClientError, ER_WRONG_INDEX_OPTIONS, INDEX_OPTS,
+			  "memory_limit must be >= 0");
 	return map;
 }
 
@@ -1162,6 +1165,9 @@ index_def_change_require_index_rebuid(struct index_def *old_index_def,
 			 new_index_def->key_def.part_count) != 0) {
 		return true;
 	}
+	if (old_index_def->type == TREE &&
+	    old_index_def->opts.hint != new_index_def->opts.hint)
+		return true;
 	if (old_index_def->type == RTREE) {
 		if (old_index_def->opts.dimension != new_index_def->opts.dimension
 		    || old_index_def->opts.distance != new_index_def->opts.distance)
@@ -1528,6 +1534,10 @@ on_replace_dd_index(struct trigger * /* trigger */, void *event)
 				       INDEX_ID);
 	struct space *old_space = space_cache_find(id);
 	access_check_ddl(old_space->def.uid, SC_SPACE);
+	if (memtx_read_view_pins_space(id)) {
+		tnt_raise(ClientError, ER_ALTER_SPACE, space_name(old_space),
+			  "the space has open read views");
+	}
 	Index *old_index = space_index(old_space, iid);
 	struct alter_space *alter = alter_space_new();
 	auto scoped_guard =
@@ -1825,6 +1835,24 @@ func_cache_replace_func(struct trigger * /* trigger */, void *event)
 	func_cache_replace(&def);
 }
 
+/** Arguments of func_index_use_cb(). */
+struct func_index_use {
+	const char *name;
+	bool is_used;
+};
+
+/** Check if any index of a space is computed by a function. */
+static void
+func_index_use_cb(struct space *space, void *udata)
+{
+	struct func_index_use *use = (struct func_index_use *) udata;
+	for (uint32_t i = 0; i < space->index_count; i++) {
+		if (strcmp(space->index[i]->index_def->opts.func,
+			   use->name) == 0)
+			use->is_used = true;
+	}
+}
+
 /**
  * A trigger invoked on replace in a space containing
  * functions on which there were defined any grants.
@@ -1861,6 +1889,14 @@ on_replace_dd_func(struct trigger * /* trigger */, void *event)
 				  (unsigned) old_func->def.uid,
 				  "function has grants");
 		}
+		/* Nor if it computes keys of a functional index. */
+		struct func_index_use use = { old_func->def.name, false };
+		space_foreach(func_index_use_cb, &use);
+		if (use.is_used) {
+			tnt_raise(ClientError, ER_DROP_FUNCTION,
+				  (unsigned) old_func->def.fid,
+				  "function is used by a functional index");
+		}
 		struct trigger *on_commit =
 			txn_alter_trigger_new(func_cache_remove_func, NULL);
 		txn_on_commit(txn, on_commit);
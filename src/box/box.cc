@@ -407,6 +407,40 @@ box_check_wal_max_size(int64_t wal_max_size)
 	return wal_max_size;
 }
 
+static void
+box_check_memtx_defrag_threshold(double threshold)
+{
+	if (threshold < 0 || threshold >= 1) {
+		tnt_raise(ClientError, ER_CFG, "memtx_defrag_threshold",
+			  "must be >= 0 and < 1");
+	}
+}
+
+static void
+box_check_memtx_defrag_budget(double budget)
+{
+	if (budget <= 0) {
+		tnt_raise(ClientError, ER_CFG, "memtx_defrag_budget",
+			  "must be > 0");
+	}
+}
+
+static void
+box_check_memtx_numa_node(int numa_node)
+{
+	if (numa_node < -1) {
+		tnt_raise(ClientError, ER_CFG, "memtx_numa_node",
+			  "must be >= 0 or -1 to disable NUMA binding");
+	}
+}
+
+static void
+box_check_vinyl_threads(int threads)
+{
+	if (threads < 2)
+		tnt_raise(ClientError, ER_CFG, "vinyl_threads", "must be >= 2");
+}
+
 void
 box_check_config()
 {
@@ -418,11 +452,13 @@ box_check_config()
 	box_check_wal_max_size(cfg_geti64("wal_max_size"));
 	box_check_wal_mode(cfg_gets("wal_mode"));
 	box_check_memtx_min_tuple_size(cfg_geti64("memtx_min_tuple_size"));
+	box_check_memtx_defrag_threshold(cfg_getd("memtx_defrag_threshold"));
+	box_check_memtx_defrag_budget(cfg_getd("memtx_defrag_budget"));
+	box_check_memtx_numa_node(cfg_geti("memtx_numa_node"));
 	if (cfg_geti64("vinyl_page_size") > cfg_geti64("vinyl_range_size"))
 		tnt_raise(ClientError, ER_CFG, "vinyl_page_size",
 			  "can't be greater than vinyl_range_size");
-	if (cfg_geti("vinyl_threads") < 2)
-		tnt_raise(ClientError, ER_CFG, "vinyl_threads", "must be >= 2");
+	box_check_vinyl_threads(cfg_geti("vinyl_threads"));
 }
 
 /*
@@ -538,6 +574,36 @@ box_set_snap_io_rate_limit(void)
 		memtx->setSnapIoRateLimit(cfg_getd("snap_io_rate_limit"));
 }
 
+void
+box_set_memtx_defrag_threshold(void)
+{
+	double threshold = cfg_getd("memtx_defrag_threshold");
+	box_check_memtx_defrag_threshold(threshold);
+	MemtxEngine *memtx = (MemtxEngine *) engine_find("memtx");
+	if (memtx)
+		memtx->setDefragThreshold(threshold);
+}
+
+void
+box_set_memtx_defrag_budget(void)
+{
+	double budget = cfg_getd("memtx_defrag_budget");
+	box_check_memtx_defrag_budget(budget);
+	MemtxEngine *memtx = (MemtxEngine *) engine_find("memtx");
+	if (memtx)
+		memtx->setDefragBudget(budget);
+}
+
+void
+box_set_vinyl_threads(void)
+{
+	int threads = cfg_geti("vinyl_threads");
+	box_check_vinyl_threads(threads);
+	VinylEngine *vinyl = (VinylEngine *) engine_find("vinyl");
+	if (vinyl)
+		vinyl->setWorkerPoolSize(threads);
+}
+
 void
 box_set_too_long_threshold(void)
 {
@@ -1374,7 +1440,9 @@ engine_init()
 					     cfg_getd("memtx_memory"),
 					     cfg_geti("memtx_min_tuple_size"),
 					     cfg_geti("memtx_max_tuple_size"),
-					     cfg_getd("slab_alloc_factor"));
+					     cfg_getd("slab_alloc_factor"),
+					     cfg_geti("memtx_huge_pages"),
+					     cfg_geti("memtx_numa_node"));
 	engine_register(memtx);
 
 	SysviewEngine *sysview = new SysviewEngine();
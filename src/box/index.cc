@@ -37,6 +37,12 @@
 #include "iproto_constants.h"
 #include "txn.h"
 #include "rmean.h"
+#include "memtx_index.h"
+#include "port.h"
+#include "fiber.h"
+#include "func.h"
+#include "box.h" /* struct box_function_ctx */
+#include <bit/int96.h>
 
 const char *iterator_type_strs[] = {
 	/* [ITER_EQ]  = */ "EQ",
@@ -56,6 +62,17 @@ const char *iterator_type_strs[] = {
 static_assert(sizeof(iterator_type_strs) / sizeof(const char *) ==
 	iterator_type_MAX, "iterator_type_str constants");
 
+const char *box_aggregate_op_strs[] = {
+	/* [BOX_AGGREGATE_COUNT] = */ "count",
+	/* [BOX_AGGREGATE_SUM]   = */ "sum",
+	/* [BOX_AGGREGATE_MIN]   = */ "min",
+	/* [BOX_AGGREGATE_MAX]   = */ "max",
+	/* [BOX_AGGREGATE_AVG]   = */ "avg",
+};
+
+static_assert(sizeof(box_aggregate_op_strs) / sizeof(const char *) ==
+	box_aggregate_op_MAX, "box_aggregate_op_strs constants");
+
 /* {{{ Utilities. **********************************************/
 
 UnsupportedIndexFeature::UnsupportedIndexFeature(const char *file,
@@ -157,6 +174,64 @@ primary_key_validate(struct index_def *index_def, const char *key,
 	return key_validate_parts(index_def, key, part_count);
 }
 
+char *
+index_extract_func_key(const struct index_def *index_def, const char *data,
+		       const char *data_end, uint32_t *key_size)
+{
+	assert(index_def_is_functional(index_def));
+	const char *name = index_def->opts.func;
+	/*
+	 * The function is looked up on each call rather than
+	 * cached in the index: _index is recovered before _func.
+	 */
+	struct func *func = func_by_name(name, strlen(name));
+	if (func == NULL) {
+		diag_set(ClientError, ER_NO_SUCH_FUNCTION, name);
+		return NULL;
+	}
+	if (func->def.language != FUNC_LANGUAGE_C) {
+		diag_set(ClientError, ER_FUNCTION_LANGUAGE,
+			 func_language_strs[func->def.language], name);
+		return NULL;
+	}
+	try {
+		if (func->func == NULL)
+			func_load(func);
+	} catch (Exception *e) {
+		return NULL;
+	}
+	struct port port;
+	port_create(&port);
+	box_function_ctx_t ctx = { NULL, &port };
+	char *key = NULL;
+	diag_clear(diag_get());
+	if (func->func(&ctx, data, data_end) != 0) {
+		if (diag_last_error(diag_get()) == NULL)
+			diag_set(ClientError, ER_PROC_C, "unknown error");
+		goto out;
+	}
+	if (port.size != 1) {
+		char msg[DIAG_ERRMSG_MAX];
+		snprintf(msg, sizeof(msg), "key function '%s' must return "
+			 "exactly one tuple, got %zu", name, port.size);
+		diag_set(ClientError, ER_PROC_C, msg);
+		goto out;
+	}
+	uint32_t bsize;
+	const char *tuple_data;
+	tuple_data = tuple_data_range(port.first->tuple, &bsize);
+	key = (char *) region_alloc(&fiber()->gc, bsize);
+	if (key == NULL) {
+		diag_set(OutOfMemory, bsize, "region", "functional key");
+		goto out;
+	}
+	memcpy(key, tuple_data, bsize);
+	*key_size = bsize;
+out:
+	port_destroy(&port);
+	return key;
+}
+
 char *
 box_tuple_extract_key(const box_tuple_t *tuple, uint32_t space_id,
 	uint32_t index_id, uint32_t *key_size)
@@ -164,6 +239,12 @@ box_tuple_extract_key(const box_tuple_t *tuple, uint32_t space_id,
 	try {
 		struct space *space = space_by_id(space_id);
 		Index *index = index_find_xc(space, index_id);
+		if (index_def_is_functional(index->index_def)) {
+			uint32_t bsize;
+			const char *data = tuple_data_range(tuple, &bsize);
+			return index_extract_func_key(index->index_def, data,
+						      data + bsize, key_size);
+		}
 		return tuple_extract_key(tuple, index->index_def, key_size);
 	} catch (ClientError *e) {
 		return NULL;
@@ -233,6 +314,17 @@ Index::findByKey(const char *key, uint32_t part_count) const
 	return NULL;
 }
 
+void
+Index::findByKeys(const char **keys, uint32_t count, struct port *port) const
+{
+	uint32_t part_count = index_def->key_def.part_count;
+	for (uint32_t i = 0; i < count; i++) {
+		struct tuple *tuple = findByKey(keys[i], part_count);
+		if (tuple != NULL)
+			port_add_tuple(port, tuple);
+	}
+}
+
 struct tuple *
 Index::findByTuple(struct tuple *tuple) const
 {
@@ -377,6 +469,47 @@ box_index_get(uint32_t space_id, uint32_t index_id, const char *key,
 	}
 }
 
+int
+box_index_get_many(struct port *port, uint32_t space_id, uint32_t index_id,
+		   const char *keys, const char *keys_end)
+{
+	assert(keys != NULL && keys_end != NULL && port != NULL);
+	mp_tuple_assert(keys, keys_end);
+	try {
+		struct space *space;
+		Index *index = check_index(space_id, index_id, &space);
+		if (!index->index_def->opts.is_unique)
+			tnt_raise(ClientError, ER_MORE_THAN_ONE_TUPLE);
+		uint32_t count = mp_decode_array(&keys);
+		const char **key_array = (const char **)
+			region_alloc_xc(&fiber()->gc,
+					count * sizeof(*key_array));
+		for (uint32_t i = 0; i < count; i++) {
+			if (mp_typeof(*keys) != MP_ARRAY) {
+				tnt_raise(ClientError, ER_ILLEGAL_PARAMS,
+					  "keys must be an array of arrays");
+			}
+			const char *key = keys;
+			mp_next(&keys);
+			uint32_t part_count = mp_decode_array(&key);
+			if (primary_key_validate(index->index_def, key,
+						 part_count))
+				diag_raise();
+			key_array[i] = key;
+		}
+		/* Start transaction in the engine. */
+		struct txn *txn = txn_begin_ro_stmt(space);
+		index->findByKeys(key_array, count, port);
+		/* Count statistics */
+		rmean_collect(rmean_box, IPROTO_SELECT, 1);
+		txn_commit_ro_stmt(txn);
+		return 0;
+	}  catch (Exception *) {
+		txn_rollback_stmt();
+		return -1;
+	}
+}
+
 int
 box_index_min(uint32_t space_id, uint32_t index_id, const char *key,
 	      const char *key_end, box_tuple_t **result)
@@ -457,6 +590,194 @@ box_index_count(uint32_t space_id, uint32_t index_id, int type,
 	}
 }
 
+/**
+ * Decode a field of the tuple to aggregate. The field is found
+ * with the tuple field map, so indexed fields cost no scan.
+ * @retval false the field is absent or nil
+ */
+static inline bool
+aggregate_field_value(const struct tuple *tuple, uint32_t fieldno,
+		      box_aggregate_result_t *value)
+{
+	const char *field = tuple_field(tuple, fieldno);
+	if (field == NULL)
+		return false;
+	switch (mp_typeof(*field)) {
+	case MP_UINT:
+		value->type = BOX_AGGREGATE_UINT;
+		value->uval = mp_decode_uint(&field);
+		return true;
+	case MP_INT:
+		value->type = BOX_AGGREGATE_INT;
+		value->ival = mp_decode_int(&field);
+		if (value->ival >= 0) {
+			value->type = BOX_AGGREGATE_UINT;
+			value->uval = value->ival;
+		}
+		return true;
+	case MP_FLOAT:
+		value->type = BOX_AGGREGATE_DOUBLE;
+		value->dval = mp_decode_float(&field);
+		return true;
+	case MP_DOUBLE:
+		value->type = BOX_AGGREGATE_DOUBLE;
+		value->dval = mp_decode_double(&field);
+		return true;
+	case MP_NIL:
+		return false;
+	default:
+		tnt_raise(ClientError, ER_FIELD_TYPE,
+			  fieldno + TUPLE_INDEX_BASE,
+			  field_type_strs[FIELD_TYPE_NUMBER]);
+	}
+}
+
+static inline double
+aggregate_value_to_double(const box_aggregate_result_t *value)
+{
+	switch (value->type) {
+	case BOX_AGGREGATE_UINT:
+		return value->uval;
+	case BOX_AGGREGATE_INT:
+		return value->ival;
+	default:
+		return value->dval;
+	}
+}
+
+/**
+ * Compare two aggregated values. Integers are compared exactly,
+ * an integer and a floating point number are compared as doubles.
+ */
+static inline int
+aggregate_value_compare(const box_aggregate_result_t *a,
+			const box_aggregate_result_t *b)
+{
+	if (a->type == BOX_AGGREGATE_DOUBLE ||
+	    b->type == BOX_AGGREGATE_DOUBLE) {
+		double da = aggregate_value_to_double(a);
+		double db = aggregate_value_to_double(b);
+		return da < db ? -1 : da > db;
+	}
+	if (a->type != b->type)
+		return a->type == BOX_AGGREGATE_INT ? -1 : 1;
+	if (a->type == BOX_AGGREGATE_UINT)
+		return a->uval < b->uval ? -1 : a->uval > b->uval;
+	return a->ival < b->ival ? -1 : a->ival > b->ival;
+}
+
+/** Convert a 96-bit integer to double. */
+static inline double
+aggregate_int96_to_double(const struct int96_num *num)
+{
+	return (double)(int64_t)num->high64 * ((uint64_t)1 << 32) +
+	       (double)num->low32;
+}
+
+ssize_t
+box_index_aggregate(uint32_t space_id, uint32_t index_id, int type,
+		    const char *key, const char *key_end, uint32_t fieldno,
+		    int op, box_aggregate_result_t *result)
+{
+	assert(key != NULL && key_end != NULL && result != NULL);
+	mp_tuple_assert(key, key_end);
+	enum iterator_type itype = (enum iterator_type) type;
+	try {
+		if (op < 0 || op >= box_aggregate_op_MAX)
+			tnt_raise(IllegalParams, "Invalid aggregate function");
+		struct space *space;
+		Index *index = check_index(space_id, index_id, &space);
+		uint32_t part_count = mp_decode_array(&key);
+		if (key_validate(index->index_def, itype, key, part_count))
+			diag_raise();
+		/* Start transaction in the engine */
+		struct txn *txn = txn_begin_ro_stmt(space);
+		struct iterator *it = index->allocIterator();
+		IteratorGuard guard(it);
+		index->initIterator(it, itype, key, part_count);
+
+		/*
+		 * Integers are summed up in 96 bits, which can't
+		 * overflow, floating point numbers separately.
+		 */
+		ssize_t count = 0;
+		bool has_double = false;
+		struct int96_num isum, ivalue;
+		int96_set_unsigned(&isum, 0);
+		double dsum = 0;
+		box_aggregate_result_t min, max, value;
+		min.type = max.type = BOX_AGGREGATE_UINT;
+		min.uval = max.uval = 0;
+		struct tuple *tuple;
+		while ((tuple = it->next(it)) != NULL) {
+			if (!aggregate_field_value(tuple, fieldno, &value))
+				continue;
+			if (count++ == 0)
+				min = max = value;
+			switch (value.type) {
+			case BOX_AGGREGATE_UINT:
+				int96_set_unsigned(&ivalue, value.uval);
+				int96_add(&isum, &ivalue);
+				break;
+			case BOX_AGGREGATE_INT:
+				int96_set_signed(&ivalue, value.ival);
+				int96_add(&isum, &ivalue);
+				break;
+			default:
+				has_double = true;
+				dsum += value.dval;
+			}
+			if (aggregate_value_compare(&value, &min) < 0)
+				min = value;
+			if (aggregate_value_compare(&value, &max) > 0)
+				max = value;
+		}
+		txn_commit_ro_stmt(txn);
+
+		bool is_sum_exact = !has_double &&
+			(int96_is_uint64(&isum) || int96_is_neg_int64(&isum));
+		double sum = dsum + aggregate_int96_to_double(&isum);
+		switch ((enum box_aggregate_op) op) {
+		case BOX_AGGREGATE_COUNT:
+			result->type = BOX_AGGREGATE_UINT;
+			result->uval = count;
+			break;
+		case BOX_AGGREGATE_SUM:
+			if (has_double) {
+				result->type = BOX_AGGREGATE_DOUBLE;
+				result->dval = sum;
+			} else if (!is_sum_exact) {
+				tnt_raise(ClientError,
+					  ER_UPDATE_INTEGER_OVERFLOW, '+',
+					  fieldno + TUPLE_INDEX_BASE);
+			} else if (int96_is_uint64(&isum)) {
+				result->type = BOX_AGGREGATE_UINT;
+				result->uval = int96_extract_uint64(&isum);
+			} else {
+				result->type = BOX_AGGREGATE_INT;
+				result->ival = int96_extract_neg_int64(&isum);
+			}
+			break;
+		case BOX_AGGREGATE_MIN:
+			*result = min;
+			break;
+		case BOX_AGGREGATE_MAX:
+			*result = max;
+			break;
+		case BOX_AGGREGATE_AVG:
+			result->type = BOX_AGGREGATE_DOUBLE;
+			result->dval = count > 0 ? sum / count : 0;
+			break;
+		default:
+			unreachable();
+		}
+		return count;
+	} catch (Exception *) {
+		txn_rollback_stmt();
+		return -1; /* handled by box.error() in Lua */
+	}
+}
+
 /* }}} */
 
 /* {{{ Iterators ************************************************/
@@ -493,6 +814,37 @@ box_index_iterator(uint32_t space_id, uint32_t index_id, int type,
 	}
 }
 
+box_iterator_t *
+box_index_read_view_iterator(uint32_t space_id, uint32_t index_id, int type,
+			     const char *key, const char *key_end)
+{
+	assert(key != NULL && key_end != NULL);
+	mp_tuple_assert(key, key_end);
+	enum iterator_type itype = (enum iterator_type) type;
+	try {
+		struct space *space;
+		Index *index = check_index(space_id, index_id, &space);
+		if (!space_is_memtx(space)) {
+			/* Show nice error messages in Lua */
+			tnt_raise(UnsupportedIndexFeature, index,
+				  "consistent read view");
+		}
+		uint32_t part_count = mp_decode_array(&key);
+		if (key_validate(index->index_def, itype, key, part_count))
+			diag_raise();
+		struct iterator *it = memtx_read_view_iterator_new(space,
+			(MemtxIndex *) index, itype, key, part_count);
+		it->sc_version = sc_version;
+		it->space_id = space_id;
+		it->index_id = index_id;
+		it->index = index;
+		return it;
+	} catch (Exception *) {
+		/* will be hanled by box.error() in Lua */
+		return NULL;
+	}
+}
+
 int
 box_iterator_next(box_iterator_t *itr, box_tuple_t **result)
 {
@@ -241,9 +241,121 @@ ssize_t
 box_index_count(uint32_t space_id, uint32_t index_id, int type,
 		const char *key, const char *key_end);
 
+/**
+ * Allocate and initialize an iterator over a consistent read view
+ * of a memtx TREE or HASH index. The iterator doesn't see changes
+ * made to the space after it was created, so it may be used across
+ * yields, and returns copies of the tuples. Iterators created
+ * without a yield in between see the same state of the database.
+ *
+ * Tuples deleted from the space are kept in memory until the
+ * iterator is exhausted or freed, and the space can't be altered
+ * meanwhile. The key buffer must stay valid until then.
+ *
+ * \param space_id space identifier
+ * \param index_id index identifier
+ * \param type iterator type - enum \link iterator_type \endlink
+ * \param key encoded key in MsgPack Array format ([part1, part2, ...]).
+ * \param key_end the end of encoded \a key
+ * \retval NULL on error (check box_error_last())
+ * \retval iterator otherwise
+ * \sa box_iterator_next()
+ * \sa box_iterator_free()
+ * \sa \code box.space[space_id].index[index_id]:pairs(key,
+ *     { iterator = type, read_view = true }) \endcode
+ */
+box_iterator_t *
+box_index_read_view_iterator(uint32_t space_id, uint32_t index_id, int type,
+			     const char *key, const char *key_end);
+
+/**
+ * Aggregate functions supported by box_index_aggregate().
+ */
+enum box_aggregate_op {
+	BOX_AGGREGATE_COUNT = 0, /* number of non-nil values */
+	BOX_AGGREGATE_SUM   = 1, /* sum of values */
+	BOX_AGGREGATE_MIN   = 2, /* minimal value */
+	BOX_AGGREGATE_MAX   = 3, /* maximal value */
+	BOX_AGGREGATE_AVG   = 4, /* arithmetic mean of values */
+	box_aggregate_op_MAX
+};
+
+/**
+ * Type of a value computed by box_index_aggregate().
+ */
+enum box_aggregate_type {
+	BOX_AGGREGATE_UINT   = 0, /* non-negative integer */
+	BOX_AGGREGATE_INT    = 1, /* negative integer */
+	BOX_AGGREGATE_DOUBLE = 2, /* floating point number */
+};
+
+/**
+ * Value computed by box_index_aggregate().
+ */
+typedef struct box_aggregate_result {
+	/** Type of the value - enum box_aggregate_type. */
+	int type;
+	union {
+		uint64_t uval;
+		int64_t ival;
+		double dval;
+	};
+} box_aggregate_result_t;
+
+/**
+ * Compute an aggregate function over a numeric field of tuples
+ * matched the provided key. Tuples where the field is absent
+ * or nil are skipped, any other non-numeric value is an error.
+ *
+ * SUM, MIN and MAX of integer values are computed exactly,
+ * an integer sum out of [INT64_MIN, UINT64_MAX] range is an
+ * error. If any of the values is a floating point number, SUM
+ * is computed and MIN and MAX are compared in double precision.
+ * AVG is always a double, COUNT is always an unsigned integer.
+ *
+ * \param space_id space identifier
+ * \param index_id index identifier
+ * \param type iterator type - enum \link iterator_type \endlink
+ * \param key encoded key in MsgPack Array format ([part1, part2, ...]).
+ * \param key_end the end of encoded \a key.
+ * \param fieldno zero-based number of the field to aggregate
+ * \param op aggregate function - enum \link box_aggregate_op \endlink
+ * \param[out] result value of the function, 0 if no values were found
+ * \retval -1 on error (check box_error_last())
+ * \retval >=0 the number of aggregated values on success
+ * \sa \code box.space[space_id].index[index_id]:aggregate(fieldno + 1,
+ *     op, key, { iterator = type }) \endcode
+ */
+ssize_t
+box_index_aggregate(uint32_t space_id, uint32_t index_id, int type,
+		    const char *key, const char *key_end, uint32_t fieldno,
+		    int op, box_aggregate_result_t *result);
+
 /** \endcond public */
 
+struct port;
+
+/**
+ * Get tuples for a batch of keys of a unique index. Keys which
+ * are not found are skipped, found tuples are appended to @a port
+ * in the order of the keys.
+ *
+ * \param port port to append found tuples to
+ * \param space_id space identifier
+ * \param index_id index identifier
+ * \param keys MsgPack array of keys, each key is a MsgPack array
+ *        ([[part1, part2, ...], ...]).
+ * \param keys_end the end of encoded \a keys
+ * \retval -1 on error (check box_error_last())
+ * \retval 0 on success
+ * \sa \code box.space[space_id].index[index_id]:get_many(keys) \endcode
+ */
+int
+box_index_get_many(struct port *port, uint32_t space_id, uint32_t index_id,
+		   const char *keys, const char *keys_end);
+
 extern const char *iterator_type_strs[];
+extern const char *box_aggregate_op_strs[];
 
 #if defined(__cplusplus)
 } /* extern "C" */
@@ -291,6 +403,24 @@ int
 primary_key_validate(struct index_def *index_def, const char *key,
 		     uint32_t part_count);
 
+/**
+ * Compute the key of a tuple in a functional index: call the
+ * C stored function of the index with the tuple fields as
+ * arguments. The function must return exactly one tuple, which
+ * is the key. The key is copied to the fiber region.
+ *
+ * @param index_def definition of a functional index
+ * @param data tuple data
+ * @param data_end the end of @a data
+ * @param[out] key_size the size of the key
+ *
+ * @retval not NULL MsgPack array with the key.
+ * @retval NULL     the function failed, diag is set.
+ */
+char *
+index_extract_func_key(const struct index_def *index_def, const char *data,
+		       const char *data_end, uint32_t *key_size);
+
 /**
  * The manner in which replace in a unique index must treat
  * duplicates (tuples with the same value of indexed key),
@@ -342,6 +472,14 @@ public:
 	virtual size_t count(enum iterator_type type, const char *key,
 			     uint32_t part_count) const;
 	virtual struct tuple *findByKey(const char *key, uint32_t part_count) const;
+	/**
+	 * Look up a batch of full keys of a unique index and
+	 * append the found tuples to @a port in the order of the
+	 * keys. Keys which are not found are skipped. Each key
+	 * points to its first part, past the MsgPack array header.
+	 */
+	virtual void findByKeys(const char **keys, uint32_t count,
+				struct port *port) const;
 	virtual struct tuple *findByTuple(struct tuple *tuple) const;
 	virtual struct tuple *replace(struct tuple *old_tuple,
 				      struct tuple *new_tuple,
@@ -119,7 +119,10 @@ const struct index_opts index_opts_default = {
 	/* .page_size           = */ 0,
 	/* .run_count_per_level = */ 2,
 	/* .run_size_ratio      = */ 3.5,
+	/* .memory_limit        = */ 0,
 	/* .lsn                 = */ 0,
+	/* .func                = */ { '\0' },
+	/* .hint                = */ true,
 };
 
 const struct opt_def index_opts_reg[] = {
@@ -131,7 +134,10 @@ const struct opt_def index_opts_reg[] = {
 	OPT_DEF("page_size", OPT_INT, struct index_opts, page_size),
 	OPT_DEF("run_count_per_level", OPT_INT, struct index_opts, run_count_per_level),
 	OPT_DEF("run_size_ratio", OPT_FLOAT, struct index_opts, run_size_ratio),
+	OPT_DEF("memory_limit", OPT_INT, struct index_opts, memory_limit),
 	OPT_DEF("lsn", OPT_INT, struct index_opts, lsn),
+	OPT_DEF("func", OPT_STR, struct index_opts, func),
+	OPT_DEF("hint", OPT_BOOL, struct index_opts, hint),
 	{ NULL, opt_type_MAX, 0, 0 },
 };
 
@@ -338,6 +344,25 @@ index_def_check(struct index_def *index_def)
 			}
 		}
 	}
+	if (index_def_is_functional(index_def)) {
+		if (index_def->iid == 0) {
+			tnt_raise(ClientError, ER_MODIFY_INDEX,
+				  index_def->name,
+				  space_name(space),
+				  "primary key can not be functional");
+		}
+		/*
+		 * Parts of a functional index refer to fields of
+		 * the key returned by the function, in order.
+		 */
+		if (!key_def_is_sequential(&index_def->key_def)) {
+			tnt_raise(ClientError, ER_MODIFY_INDEX,
+				  index_def->name,
+				  space_name(space),
+				  "functional index parts must be "
+				  "fields 1..n of the key");
+		}
+	}
 
 	/* validate index_def->type */
 	space->handler->engine->checkIndexDef(space, index_def);
@@ -433,10 +458,14 @@ key_validate_parts(struct index_def *index_def, const char *key,
 
 const struct space_opts space_opts_default = {
 	/* .temporary = */ false,
+	/* .field_map = */ 0,
+	/* .field_map_step = */ 1,
 };
 
 const struct opt_def space_opts_reg[] = {
 	OPT_DEF("temporary", OPT_BOOL, struct space_opts, temporary),
+	OPT_DEF("field_map", OPT_INT, struct space_opts, field_map),
+	OPT_DEF("field_map_step", OPT_INT, struct space_opts, field_map_step),
 	{ NULL, opt_type_MAX, 0, 0 }
 };
 
@@ -469,6 +498,22 @@ space_def_check(struct space_def *def, uint32_t namelen, uint32_t engine_namelen
 				  def->name,
 			         "space does not support temporary flag");
 	}
+	if (def->opts.field_map < 0) {
+		tnt_raise(ClientError, errcode, def->name,
+			  "field_map must be >= 0");
+	}
+	if (def->opts.field_map > BOX_FIELD_MAX) {
+		tnt_raise(ClientError, errcode, def->name,
+			  "field_map is too big");
+	}
+	if (def->opts.field_map_step < 1) {
+		tnt_raise(ClientError, errcode, def->name,
+			  "field_map_step must be >= 1");
+	}
+	if (def->opts.field_map_step > BOX_FIELD_MAX) {
+		tnt_raise(ClientError, errcode, def->name,
+			  "field_map_step is too big");
+	}
 }
 
 bool
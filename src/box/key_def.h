@@ -206,10 +206,26 @@ struct index_opts {
 	 * previous one.
 	 */
 	double run_size_ratio;
+	/**
+	 * Max amount of memory in-memory trees of this index
+	 * may use before its ranges are dumped regardless of
+	 * the global quota. 0 means no limit.
+	 */
+	int64_t memory_limit;
 	/**
 	 * LSN from the time of index creation.
 	 */
 	int64_t lsn;
+	/**
+	 * Name of the C stored function computing the key of a
+	 * functional index, empty for regular indexes.
+	 */
+	char func[BOX_NAME_MAX + 1];
+	/**
+	 * Store comparison hints in a memtx TREE index, see
+	 * memtx_tree_data. Costs 8 bytes per element.
+	 */
+	bool hint;
 };
 
 extern const struct index_opts index_opts_default;
@@ -224,7 +240,9 @@ index_opts_cmp(const struct index_opts *o1, const struct index_opts *o2)
 		return o1->dimension < o2->dimension ? -1 : 1;
 	if (o1->distance != o2->distance)
 		return o1->distance < o2->distance ? -1 : 1;
-	return 0;
+	if (o1->hint != o2->hint)
+		return o1->hint < o2->hint ? -1 : 1;
+	return strcmp(o1->func, o2->func);
 }
 
 struct key_def;
@@ -389,6 +407,14 @@ struct space_opts {
 	 * - changes are not part of a snapshot
 	 */
 	bool temporary;
+	/**
+	 * The number of leading fields of a tuple which have
+	 * offsets in the field map, whether they are indexed or
+	 * not. 0 means only indexed fields have offsets.
+	 */
+	int64_t field_map;
+	/** Map only every field_map_step-th of these fields. */
+	int64_t field_map_step;
 };
 
 extern const struct space_opts space_opts_default;
@@ -509,6 +535,18 @@ key_def_is_sequential(const struct key_def *key_def)
 	return true;
 }
 
+/**
+ * Return true if @a index_def defines a functional index, i.e.
+ * an index on keys computed from tuples by a stored function.
+ * Parts of such an index refer to fields of the computed key
+ * rather than fields of the tuple.
+ */
+static inline bool
+index_def_is_functional(const struct index_def *index_def)
+{
+	return index_def->opts.func[0] != '\0';
+}
+
 /** A helper table for key_mp_type_validate */
 extern const uint32_t key_mp_type[];
 
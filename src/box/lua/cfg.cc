@@ -142,6 +142,39 @@ lbox_cfg_set_snap_io_rate_limit(struct lua_State *L)
 	return 0;
 }
 
+static int
+lbox_cfg_set_memtx_defrag_threshold(struct lua_State *L)
+{
+	try {
+		box_set_memtx_defrag_threshold();
+	} catch (Exception *) {
+		luaT_error(L);
+	}
+	return 0;
+}
+
+static int
+lbox_cfg_set_memtx_defrag_budget(struct lua_State *L)
+{
+	try {
+		box_set_memtx_defrag_budget();
+	} catch (Exception *) {
+		luaT_error(L);
+	}
+	return 0;
+}
+
+static int
+lbox_cfg_set_vinyl_threads(struct lua_State *L)
+{
+	try {
+		box_set_vinyl_threads();
+	} catch (Exception *) {
+		luaT_error(L);
+	}
+	return 0;
+}
+
 static int
 lbox_cfg_set_read_only(struct lua_State *L)
 {
@@ -168,6 +201,9 @@ box_lua_cfg_init(struct lua_State *L)
 		{"cfg_set_io_collect_interval", lbox_cfg_set_io_collect_interval},
 		{"cfg_set_too_long_threshold", lbox_cfg_set_too_long_threshold},
 		{"cfg_set_snap_io_rate_limit", lbox_cfg_set_snap_io_rate_limit},
+		{"cfg_set_memtx_defrag_threshold", lbox_cfg_set_memtx_defrag_threshold},
+		{"cfg_set_memtx_defrag_budget", lbox_cfg_set_memtx_defrag_budget},
+		{"cfg_set_vinyl_threads", lbox_cfg_set_vinyl_threads},
 		{"cfg_set_read_only", lbox_cfg_set_read_only},
 		{NULL, NULL}
 	};
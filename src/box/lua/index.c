@@ -34,6 +34,7 @@
 #include "box/index.h"
 #include "box/lua/tuple.h"
 #include "box/lua/misc.h" /* lbox_encode_tuple_on_gc() */
+#include "box/tuple_format.h" /* TUPLE_INDEX_BASE */
 
 /** {{{ box.index Lua library: access to spaces and indexes
  */
@@ -224,6 +225,51 @@ lbox_index_count(lua_State *L)
 	return 1;
 }
 
+static int
+lbox_index_aggregate(lua_State *L)
+{
+	if (lua_gettop(L) != 6 || !lua_isnumber(L, 1) || !lua_isnumber(L, 2) ||
+	    !lua_isnumber(L, 3) || !lua_isnumber(L, 5) || !lua_isstring(L, 6)) {
+		return luaL_error(L, "usage index.aggregate(space_id, index_id, "
+		       "iterator, key, field, op)");
+	}
+
+	uint32_t space_id = lua_tointeger(L, 1);
+	uint32_t index_id = lua_tointeger(L, 2);
+	uint32_t iterator = lua_tointeger(L, 3);
+	size_t key_len;
+	const char *key = lbox_encode_tuple_on_gc(L, 4, &key_len);
+	int64_t field = lua_tointeger(L, 5);
+	if (field < TUPLE_INDEX_BASE || field > UINT32_MAX)
+		return luaL_error(L, "index.aggregate: invalid field number");
+	uint32_t fieldno = field - TUPLE_INDEX_BASE;
+	int op = strindex(box_aggregate_op_strs, lua_tostring(L, 6),
+			  box_aggregate_op_MAX);
+
+	box_aggregate_result_t result;
+	ssize_t count = box_index_aggregate(space_id, index_id, iterator,
+					    key, key + key_len, fieldno, op,
+					    &result);
+	if (count == -1)
+		return luaT_error(L);
+	if (count == 0 && op != BOX_AGGREGATE_COUNT && op != BOX_AGGREGATE_SUM) {
+		/* min, max and avg of nothing are undefined */
+		lua_pushnil(L);
+		return 1;
+	}
+	switch (result.type) {
+	case BOX_AGGREGATE_UINT:
+		luaL_pushuint64(L, result.uval);
+		break;
+	case BOX_AGGREGATE_INT:
+		luaL_pushint64(L, result.ival);
+		break;
+	default:
+		lua_pushnumber(L, result.dval);
+	}
+	return 1;
+}
+
 static void
 box_index_init_iterator_types(struct lua_State *L, int idx)
 {
@@ -324,6 +370,7 @@ box_lua_index_init(struct lua_State *L)
 		{"min", lbox_index_min},
 		{"max", lbox_index_max},
 		{"count", lbox_index_count},
+		{"aggregate", lbox_index_aggregate},
 		{"iterator", lbox_index_iterator},
 		{"iterator_next", lbox_iterator_next},
 		{"truncate", lbox_truncate},
@@ -12,6 +12,10 @@ local default_cfg = {
     memtx_memory        = 256 * 1024 *1024,
     memtx_min_tuple_size = 16,
     memtx_max_tuple_size = 1024 * 1024,
+    memtx_defrag_threshold = 0, -- 0 = disabled
+    memtx_defrag_budget = 0.01,
+    memtx_huge_pages    = false,
+    memtx_numa_node     = -1, -- -1 = default memory policy
     slab_alloc_factor   = 1.1,
     work_dir            = nil,
     memtx_dir           = ".",
@@ -26,6 +30,7 @@ local default_cfg = {
     vinyl_range_size          = 1024 * 1024 * 1024,
     vinyl_page_size           = 8 * 1024,
     vinyl_bloom_fpr           = 0.05,
+    vinyl_direct_io           = false,
     log                 = nil,
     log_nonblock        = true,
     log_level           = 5,
@@ -59,6 +64,10 @@ local template_cfg = {
     memtx_memory        = 'number',
     memtx_min_tuple_size  = 'number',
     memtx_max_tuple_size  = 'number',
+    memtx_defrag_threshold = 'number',
+    memtx_defrag_budget   = 'number',
+    memtx_huge_pages      = 'boolean',
+    memtx_numa_node       = 'number',
     slab_alloc_factor   = 'number',
     work_dir            = 'string',
     memtx_dir            = 'string',
@@ -72,6 +81,7 @@ local template_cfg = {
     vinyl_range_size          = 'number',
     vinyl_page_size           = 'number',
     vinyl_bloom_fpr           = 'number',
+    vinyl_direct_io           = 'boolean',
 
     log              = 'string',
     log_nonblock     = 'boolean',
@@ -138,6 +148,9 @@ local dynamic_cfg = {
     readahead               = private.cfg_set_readahead,
     too_long_threshold      = private.cfg_set_too_long_threshold,
     snap_io_rate_limit      = private.cfg_set_snap_io_rate_limit,
+    memtx_defrag_threshold  = private.cfg_set_memtx_defrag_threshold,
+    memtx_defrag_budget     = private.cfg_set_memtx_defrag_budget,
+    vinyl_threads           = private.cfg_set_vinyl_threads,
     read_only               = private.cfg_set_read_only,
     -- snapshot_daemon
     checkpoint_interval     = box.internal.snapshot_daemon.set_checkpoint_interval,
@@ -157,6 +170,7 @@ local dynamic_cfg_skip_at_load = {
     wal_dir_rescan_delay    = true,
     custom_proc_title       = true,
     force_recovery          = true,
+    vinyl_threads           = true,
 }
 
 local function convert_gb(size)
@@ -28,6 +28,10 @@ ffi.cdef[[
     box_iterator_t *
     box_index_iterator(uint32_t space_id, uint32_t index_id, int type,
                        const char *key, const char *key_end);
+    box_iterator_t *
+    box_index_read_view_iterator(uint32_t space_id, uint32_t index_id,
+                                 int type, const char *key,
+                                 const char *key_end);
     int
     box_iterator_next(box_iterator_t *itr, box_tuple_t **result);
     void
@@ -241,6 +245,8 @@ box.schema.space.create = function(name, options)
         user = 'string, number',
         format = 'table',
         temporary = 'boolean',
+        field_map = 'number',
+        field_map_step = 'number',
     }
     local options_defaults = {
         engine = 'memtx',
@@ -282,6 +288,8 @@ box.schema.space.create = function(name, options)
     -- filter out global parameters from the options array
     local space_options = setmetatable({
         temporary = options.temporary and true or nil,
+        field_map = options.field_map,
+        field_map_step = options.field_map_step,
     }, { __serialize = 'map' })
     _space:insert{id, uid, name, options.engine, options.field_count,
         space_options, format}
@@ -394,6 +402,9 @@ box.schema.index.create = function(space_id, name, options)
         range_size = 'number',
         run_count_per_level = 'number',
         run_size_ratio = 'number',
+        memory_limit = 'number',
+        func = 'string',
+        hint = 'boolean',
     }
     check_param_table(options, options_template)
     local options_defaults = {
@@ -426,6 +437,13 @@ box.schema.index.create = function(space_id, name, options)
     check_index_parts(options.parts)
     options.parts = update_index_parts(options.parts)
 
+    if options.func ~= nil then
+        local _func = box.space[box.schema.FUNC_ID]
+        if _func.index.name:get{options.func} == nil then
+            box.error(box.error.NO_SUCH_FUNCTION, options.func)
+        end
+    end
+
     local _index = box.space[box.schema.INDEX_ID]
     if _index.index.name:get{space_id, name} then
         if options.if_not_exists then
@@ -464,6 +482,9 @@ box.schema.index.create = function(space_id, name, options)
             range_size = options.range_size,
             run_count_per_level = options.run_count_per_level,
             run_size_ratio = options.run_size_ratio,
+            memory_limit = options.memory_limit,
+            func = options.func,
+            hint = options.hint,
             lsn = box.info.cluster.signature,
     }
     local field_type_aliases = {
@@ -523,6 +544,7 @@ box.schema.index.alter = function(space_id, index_id, options)
         unique = 'boolean',
         dimension = 'number',
         distance = 'string',
+        hint = 'boolean',
     }
     check_param_table(options, options_template)
 
@@ -592,6 +614,9 @@ box.schema.index.alter = function(space_id, index_id, options)
     if options.distance ~= nil then
         index_opts.distance = options.distance
     end
+    if options.hint ~= nil then
+        index_opts.hint = options.hint
+    end
     if options.parts ~= nil then
         check_index_parts(options.parts)
         options.parts = update_index_parts(options.parts)
@@ -735,6 +760,23 @@ end
 
 internal.check_iterator_type = check_iterator_type -- export for net.box
 
+-- index:pairs() over a consistent read view, see
+-- box_index_read_view_iterator()
+local function read_view_pairs(index, key, opts)
+    local pkey, pkey_end = tuple_encode(key)
+    local itype = check_iterator_type(opts, pkey + 1 >= pkey_end);
+
+    local keybuf = ffi.string(pkey, pkey_end - pkey)
+    local pkeybuf = ffi.cast('const char *', keybuf)
+    local cdata = builtin.box_index_read_view_iterator(index.space_id,
+        index.id, itype, pkeybuf, pkeybuf + #keybuf);
+    if cdata == nil then
+        box.error()
+    end
+    return fun.wrap(iterator_gen, keybuf,
+        ffi.gc(cdata, builtin.box_iterator_free))
+end
+
 function box.schema.space.bless(space)
     local index_mt = {}
     -- __len and __index
@@ -814,6 +856,9 @@ function box.schema.space.bless(space)
     -- iteration
     index_mt.pairs_ffi = function(index, key, opts)
         check_index_arg(index, 'pairs')
+        if type(opts) == 'table' and opts.read_view then
+            return read_view_pairs(index, key, opts)
+        end
         local pkey, pkey_end = tuple_encode(key)
         local itype = check_iterator_type(opts, pkey + 1 >= pkey_end);
 
@@ -829,6 +874,9 @@ function box.schema.space.bless(space)
     end
     index_mt.pairs_luac = function(index, key, opts)
         check_index_arg(index, 'pairs')
+        if type(opts) == 'table' and opts.read_view then
+            return read_view_pairs(index, key, opts)
+        end
         key = keify(key)
         local itype = check_iterator_type(opts, #key == 0);
         local keymp = msgpack.encode(key)
@@ -857,6 +905,19 @@ function box.schema.space.bless(space)
         return internal.count(index.space_id, index.id, itype, key);
     end
 
+    -- aggregate function over a field of matched tuples
+    index_mt.aggregate = function(index, field, op, key, opts)
+        check_index_arg(index, 'aggregate')
+        if type(field) ~= 'number' or type(op) ~= 'string' then
+            box.error(box.error.PROC_LUA,
+                      "Usage: index:aggregate(field, op, [key, [opts]])")
+        end
+        key = keify(key)
+        local itype = check_iterator_type(opts, #key == 0);
+        return internal.aggregate(index.space_id, index.id, itype, key,
+                                  field, op)
+    end
+
     index_mt.get_ffi = function(index, key)
         check_index_arg(index, 'get')
         local key, key_end = tuple_encode(key)
@@ -875,6 +936,19 @@ function box.schema.space.bless(space)
         return internal.get(index.space_id, index.id, key)
     end
 
+    -- get tuples for a batch of keys, missing keys are skipped
+    index_mt.get_many = function(index, keys)
+        check_index_arg(index, 'get_many')
+        if type(keys) ~= 'table' then
+            box.error(box.error.PROC_LUA, "Usage: index:get_many(keys)")
+        end
+        local batch = {}
+        for i, key in ipairs(keys) do
+            batch[i] = keify(key)
+        end
+        return internal.get_many(index.space_id, index.id, batch)
+    end
+
     local function check_select_opts(opts, key_is_nil)
         local offset = 0
         local limit = 4294967295
@@ -976,6 +1050,10 @@ function box.schema.space.bless(space)
         end
         return pk:count(key, opts)
     end
+    space_mt.aggregate = function(space, field, op, key, opts)
+        check_space_arg(space, 'aggregate')
+        return check_primary_index(space):aggregate(field, op, key, opts)
+    end
     space_mt.bsize = function(space)
         check_space_arg(space, 'bsize')
         local s = builtin.space_by_id(space.id)
@@ -990,6 +1068,10 @@ function box.schema.space.bless(space)
         check_space_arg(space, 'get')
         return check_primary_index(space):get(key)
     end
+    space_mt.get_many = function(space, keys)
+        check_space_arg(space, 'get_many')
+        return check_primary_index(space):get_many(keys)
+    end
     space_mt.select = function(space, key, opts)
         check_space_arg(space, 'select')
         return check_primary_index(space):select(key, opts)
@@ -41,6 +41,8 @@
 #include "small/small.h"
 #include "small/quota.h"
 #include "memory.h"
+#include "box/memtx_tuple.h"
+#include "box/memtx_defrag.h"
 
 extern struct small_alloc memtx_alloc;
 extern struct mempool memtx_index_extent_pool;
@@ -215,6 +217,70 @@ lbox_slab_info(struct lua_State *L)
 	lua_pushstring(L, ratio_buf);
 	lua_settable(L, -3);
 
+	/** Huge pages mode the arena got: none, madvise or hugetlb */
+	lua_pushstring(L, "huge_pages");
+	lua_pushstring(L,
+		memtx_huge_pages_strs[memtx_tuple_arena_huge_pages()]);
+	lua_settable(L, -3);
+
+	/** NUMA node the arena is bound to, -1 if not bound */
+	lua_pushstring(L, "numa_node");
+	lua_pushinteger(L, memtx_tuple_arena_numa_node());
+	lua_settable(L, -3);
+
+	return 1;
+}
+
+/**
+ * Memory kept for open consistent read views of memtx indexes,
+ * including the one used by a checkpoint in progress.
+ */
+static int
+lbox_slab_read_view_info(struct lua_State *L)
+{
+	lua_newtable(L);
+
+	lua_pushstring(L, "count");
+	lua_pushnumber(L, memtx_tuple_snapshot_count());
+	lua_settable(L, -3);
+
+	/* Size of tuples deleted but still seen by a read view */
+	lua_pushstring(L, "pinned_size");
+	luaL_pushuint64(L, memtx_tuple_snapshot_pinned_size());
+	lua_settable(L, -3);
+
+	return 1;
+}
+
+/** Statistics of the tuple arena defragmentation. */
+static int
+lbox_slab_defrag_info(struct lua_State *L)
+{
+	struct memtx_defrag_stat stat;
+	memtx_defrag_stat(&stat);
+	lua_newtable(L);
+
+	lua_pushstring(L, "running");
+	lua_pushboolean(L, stat.is_running);
+	lua_settable(L, -3);
+
+	/* Share of free space in tuple slabs */
+	lua_pushstring(L, "ratio");
+	lua_pushnumber(L, memtx_defrag_ratio());
+	lua_settable(L, -3);
+
+	lua_pushstring(L, "passes");
+	luaL_pushuint64(L, stat.passes);
+	lua_settable(L, -3);
+
+	lua_pushstring(L, "moved");
+	luaL_pushuint64(L, stat.moved);
+	lua_settable(L, -3);
+
+	lua_pushstring(L, "moved_size");
+	luaL_pushuint64(L, stat.moved_size);
+	lua_settable(L, -3);
+
 	return 1;
 }
 
@@ -268,6 +334,14 @@ box_lua_slab_init(struct lua_State *L)
 	lua_pushcfunction(L, lbox_slab_check);
 	lua_settable(L, -3);
 
+	lua_pushstring(L, "read_view_info");
+	lua_pushcfunction(L, lbox_slab_read_view_info);
+	lua_settable(L, -3);
+
+	lua_pushstring(L, "defrag_info");
+	lua_pushcfunction(L, lbox_slab_defrag_info);
+	lua_settable(L, -3);
+
 	lua_settable(L, -3); /* box.slab */
 
 	lua_pushstring(L, "runtime");
@@ -168,6 +168,14 @@ lbox_fillspace(struct lua_State *L, struct space *space, int i)
 		if (index_def->type == HASH || index_def->type == TREE) {
 			lua_pushboolean(L, index_def->opts.is_unique);
 			lua_setfield(L, -2, "unique");
+			if (index_def_is_functional(index_def)) {
+				lua_pushstring(L, index_def->opts.func);
+				lua_setfield(L, -2, "func");
+			}
+			if (index_def->type == TREE && !index_def->opts.hint) {
+				lua_pushboolean(L, false);
+				lua_setfield(L, -2, "hint");
+			}
 		} else if (index_def->type == RTREE) {
 			lua_pushnumber(L, index_def->opts.dimension);
 			lua_setfield(L, -2, "dimension");
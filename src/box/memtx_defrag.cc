@@ -0,0 +1,408 @@
+/*
+ * Copyright 2010-2016, Tarantool AUTHORS, please see AUTHORS file.
+ *
+ * Redistribution and use in source and binary forms, with or
+ * without modification, are permitted provided that the following
+ * conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above
+ *    copyright notice, this list of conditions and the
+ *    following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above
+ *    copyright notice, this list of conditions and the following
+ *    disclaimer in the documentation and/or other materials
+ *    provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY AUTHORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+ * TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL
+ * AUTHORS OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+ * INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+ * THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+#include "memtx_defrag.h"
+
+#include "small/small.h"
+#include "msgpuck/msgpuck.h"
+#include "fiber.h"
+#include "clock.h"
+#include "scoped_guard.h"
+#include "schema.h"
+#include "space.h"
+#include "tuple.h"
+#include "memtx_engine.h"
+#include "memtx_space.h"
+#include "memtx_tuple.h"
+
+/** Memtx tuple allocator, defined in memtx_tuple.cc */
+extern struct small_alloc memtx_alloc;
+/** Memtx slab arena, defined in memtx_engine.cc */
+extern struct slab_arena memtx_arena;
+
+enum {
+	/** Number of tuples visited between two checks of the clock. */
+	MEMTX_DEFRAG_BATCH = 64,
+	/**
+	 * Extents to reserve before relocating a tuple, to not
+	 * fail rolling back a partial update of the indexes.
+	 * See RESERVE_EXTENTS_BEFORE_REPLACE in memtx_space.cc.
+	 */
+	MEMTX_DEFRAG_RESERVE_EXTENTS = 16,
+};
+
+/** How often to check fragmentation when idle, in seconds. */
+static const double MEMTX_DEFRAG_CHECK_INTERVAL = 1.0;
+/**
+ * How long to wait before the next pass if the previous one
+ * couldn't move anything, in seconds.
+ */
+static const double MEMTX_DEFRAG_BACKOFF = 60.0;
+
+struct memtx_defrag {
+	/** The defragmentation fiber, started on demand. */
+	struct fiber *fiber;
+	/** Fragmentation which triggers a pass, 0 if disabled. */
+	double threshold;
+	/** Max time between two yields of the fiber, seconds. */
+	double budget;
+	/**
+	 * The space being defragmented. Spaces are visited in
+	 * the order of ids, 0 means the beginning of a pass.
+	 */
+	uint32_t space_id;
+	/**
+	 * Primary key of the last visited tuple of the space,
+	 * with the array header. Empty when the space hasn't been
+	 * visited yet.
+	 */
+	char *key;
+	uint32_t key_size;
+	uint32_t key_capacity;
+	/** Schema version the key was saved at. */
+	uint32_t sc_version;
+	/** Number of moved tuples at the start of the pass. */
+	uint64_t pass_start_moved;
+	/** Don't start a new pass until this time. */
+	double backoff_until;
+	struct memtx_defrag_stat stat;
+};
+
+static struct memtx_defrag defrag = {
+	/* .fiber = */ NULL,
+	/* .threshold = */ 0,
+	/* .budget = */ 0.01,
+};
+
+static int
+memtx_defrag_stats_noop_cb(const struct mempool_stats *stats, void *cb_ctx)
+{
+	(void) stats;
+	(void) cb_ctx;
+	return 0;
+}
+
+double
+memtx_defrag_ratio(void)
+{
+	struct small_stats totals;
+	small_stats(&memtx_alloc, &totals, memtx_defrag_stats_noop_cb, NULL);
+	if (totals.total == 0)
+		return 0;
+	return (double) (totals.total - totals.used) / totals.total;
+}
+
+/**
+ * Check if a pass is worth starting: free space exceeds the
+ * threshold and there is enough of it to release at least
+ * one arena slab, which is the unit of memory quota.
+ */
+static bool
+memtx_defrag_is_needed(void)
+{
+	struct small_stats totals;
+	small_stats(&memtx_alloc, &totals, memtx_defrag_stats_noop_cb, NULL);
+	size_t free = totals.total - totals.used;
+	return free >= memtx_arena.slab_size &&
+	       (double) free > defrag.threshold * totals.total;
+}
+
+/** Forget the position in the current space. */
+static inline void
+memtx_defrag_reset_key(void)
+{
+	defrag.key_size = 0;
+}
+
+/** Remember the primary key of a tuple as the position. */
+static void
+memtx_defrag_save_key(Index *pk, struct tuple *tuple)
+{
+	uint32_t key_size;
+	const char *key = tuple_extract_key(tuple, pk->index_def, &key_size);
+	if (key == NULL)
+		diag_raise();
+	if (key_size > defrag.key_capacity) {
+		char *buf = (char *) realloc(defrag.key, key_size);
+		if (buf == NULL) {
+			tnt_raise(OutOfMemory, key_size, "realloc",
+				  "defragmentation key");
+		}
+		defrag.key = buf;
+		defrag.key_capacity = key_size;
+	}
+	memcpy(defrag.key, key, key_size);
+	defrag.key_size = key_size;
+	defrag.sc_version = sc_version;
+}
+
+/**
+ * Move to the memtx space following the current one in the
+ * order of ids.
+ * @retval true  found the next space.
+ * @retval false the pass is over.
+ */
+static bool
+memtx_defrag_next_space(void)
+{
+	memtx_defrag_reset_key();
+	struct space *space = space_by_id(BOX_SPACE_ID);
+	Index *pk = space ? space_index(space, 0) : NULL;
+	if (pk == NULL)
+		return false;
+	char key[6];
+	assert(mp_sizeof_uint(UINT32_MAX) <= sizeof(key));
+	mp_encode_uint(key, defrag.space_id);
+	struct iterator *it = pk->allocIterator();
+	auto it_guard = make_scoped_guard([=]{ it->free(it); });
+	pk->initIterator(it, ITER_GT, key, 1);
+	struct tuple *tuple = it->next(it);
+	if (tuple == NULL) {
+		defrag.space_id = 0;
+		return false;
+	}
+	defrag.space_id = tuple_field_u32_xc(tuple, 0);
+	return true;
+}
+
+/**
+ * Check if tuples of a space may be relocated: it's a memtx
+ * space with all keys built.
+ */
+static bool
+memtx_defrag_space_is_eligible(struct space *space)
+{
+	if (!space_is_memtx(space) || space->index_count == 0)
+		return false;
+	MemtxSpace *handler = (MemtxSpace *) space->handler;
+	return handler->replace == memtx_replace_all_keys;
+}
+
+/**
+ * Replace a tuple with its copy in an index. A non-unique
+ * index orders equal keys by tuple address, so the copy is not
+ * a duplicate of the original there: it is inserted first and
+ * the original is deleted then, which leaves the index intact
+ * if the insertion fails.
+ */
+static void
+memtx_defrag_replace(Index *index, struct tuple *old_tuple,
+		     struct tuple *new_tuple)
+{
+	if (index->index_def->opts.is_unique) {
+		index->replace(old_tuple, new_tuple, DUP_REPLACE);
+		return;
+	}
+	index->replace(NULL, new_tuple, DUP_INSERT);
+	index->replace(old_tuple, NULL, DUP_REPLACE_OR_INSERT);
+}
+
+/**
+ * Relocate a tuple referenced only by its space.
+ *
+ * The allocator takes memory from the non-full slab with the
+ * lowest address, so a copy of the tuple either lands in a
+ * lower slab than the original, or stays in the same one. Only
+ * moves to a lower arena slab are done: they drain the upper
+ * slabs, which return to the arena once empty.
+ *
+ * @return the tuple stored in the space after the call.
+ */
+static struct tuple *
+memtx_defrag_move(struct space *space, struct tuple *old_tuple)
+{
+	struct tuple_format *format = tuple_format_by_id(old_tuple->format_id);
+	uint32_t bsize;
+	const char *data = tuple_data_range(old_tuple, &bsize);
+	struct tuple *new_tuple = memtx_tuple_new_xc(format, data,
+						     data + bsize);
+	uintptr_t slab_mask = ~((uintptr_t) memtx_arena.slab_size - 1);
+	if (((uintptr_t) new_tuple & slab_mask) >=
+	    ((uintptr_t) old_tuple & slab_mask)) {
+		memtx_tuple_delete(format, new_tuple);
+		return old_tuple;
+	}
+	auto new_tuple_guard = make_scoped_guard([=]{
+		memtx_tuple_delete(format, new_tuple);
+	});
+	memtx_index_extent_reserve(MEMTX_DEFRAG_RESERVE_EXTENTS);
+	/*
+	 * Both tuples have the same key in every index, so
+	 * the new tuple takes the place of the old one.
+	 */
+	uint32_t i = 0;
+	try {
+		for (; i < space->index_count; i++) {
+			memtx_defrag_replace(space->index[i], old_tuple,
+					     new_tuple);
+		}
+	} catch (Exception *e) {
+		for (; i > 0; i--) {
+			memtx_defrag_replace(space->index[i - 1], new_tuple,
+					     old_tuple);
+		}
+		throw;
+	}
+	new_tuple_guard.is_active = false;
+	tuple_ref(new_tuple);
+	tuple_unref(old_tuple);
+	defrag.stat.moved++;
+	defrag.stat.moved_size += bsize;
+	return new_tuple;
+}
+
+/**
+ * Relocate tuples of a space, starting after the saved
+ * position, until the deadline.
+ * @retval true  the space has been fully visited.
+ * @retval false the deadline is reached, the position is saved.
+ */
+static bool
+memtx_defrag_space(struct space *space, double deadline)
+{
+	Index *pk = space->index[0];
+	if (defrag.key_size > 0 && defrag.sc_version != sc_version) {
+		/* The key definition may have changed, start over. */
+		memtx_defrag_reset_key();
+	}
+	struct iterator *it = pk->allocIterator();
+	auto it_guard = make_scoped_guard([=]{ it->free(it); });
+	if (defrag.key_size == 0) {
+		pk->initIterator(it, ITER_ALL, NULL, 0);
+	} else {
+		const char *key = defrag.key;
+		uint32_t part_count = mp_decode_array(&key);
+		pk->initIterator(it, ITER_GT, key, part_count);
+	}
+	struct tuple *tuple;
+	uint32_t count = 0;
+	while ((tuple = it->next(it)) != NULL) {
+		/*
+		 * A tuple used by a statement or a fiber is
+		 * referenced by it and can't be moved.
+		 */
+		if (memtx_tuple_is_mutable(tuple))
+			tuple = memtx_defrag_move(space, tuple);
+		if (++count % MEMTX_DEFRAG_BATCH == 0 &&
+		    clock_monotonic() >= deadline) {
+			memtx_defrag_save_key(pk, tuple);
+			return false;
+		}
+	}
+	return true;
+}
+
+/** Run a pass of defragmentation until the deadline. */
+static void
+memtx_defrag_step(double deadline)
+{
+	while (clock_monotonic() < deadline) {
+		struct space *space = space_by_id(defrag.space_id);
+		if (space != NULL && memtx_defrag_space_is_eligible(space) &&
+		    !memtx_defrag_space(space, deadline))
+			return;
+		if (!memtx_defrag_next_space()) {
+			defrag.stat.is_running = false;
+			defrag.stat.passes++;
+			if (defrag.stat.moved == defrag.pass_start_moved) {
+				defrag.backoff_until = clock_monotonic() +
+						       MEMTX_DEFRAG_BACKOFF;
+			}
+			return;
+		}
+	}
+}
+
+static int
+memtx_defrag_f(va_list ap)
+{
+	(void) ap;
+	while (!fiber_is_cancelled()) {
+		/*
+		 * Deleted tuples can't be freed while there are
+		 * open snapshots, moving them would only waste
+		 * memory.
+		 */
+		if (defrag.threshold == 0 ||
+		    memtx_tuple_snapshot_count() > 0 ||
+		    (!defrag.stat.is_running &&
+		     (clock_monotonic() < defrag.backoff_until ||
+		      !memtx_defrag_is_needed()))) {
+			fiber_sleep(MEMTX_DEFRAG_CHECK_INTERVAL);
+			continue;
+		}
+		if (!defrag.stat.is_running) {
+			defrag.stat.is_running = true;
+			defrag.space_id = 0;
+			defrag.pass_start_moved = defrag.stat.moved;
+			memtx_defrag_reset_key();
+		}
+		try {
+			memtx_defrag_step(clock_monotonic() + defrag.budget);
+		} catch (Exception *e) {
+			e->log();
+			defrag.stat.is_running = false;
+			fiber_gc();
+			fiber_sleep(MEMTX_DEFRAG_CHECK_INTERVAL);
+			continue;
+		}
+		fiber_gc();
+		fiber_sleep(0);
+	}
+	return 0;
+}
+
+int
+memtx_defrag_set_threshold(double threshold)
+{
+	defrag.threshold = threshold;
+	defrag.backoff_until = 0;
+	if (threshold == 0)
+		defrag.stat.is_running = false;
+	if (threshold == 0 || defrag.fiber != NULL)
+		return 0;
+	defrag.fiber = fiber_new("memtx.defrag", memtx_defrag_f);
+	if (defrag.fiber == NULL)
+		return -1;
+	fiber_start(defrag.fiber);
+	return 0;
+}
+
+void
+memtx_defrag_set_budget(double budget)
+{
+	defrag.budget = budget;
+}
+
+void
+memtx_defrag_stat(struct memtx_defrag_stat *stat)
+{
+	*stat = defrag.stat;
+}
@@ -0,0 +1,96 @@
+#ifndef TARANTOOL_BOX_MEMTX_DEFRAG_H_INCLUDED
+#define TARANTOOL_BOX_MEMTX_DEFRAG_H_INCLUDED
+/*
+ * Copyright 2010-2016, Tarantool AUTHORS, please see AUTHORS file.
+ *
+ * Redistribution and use in source and binary forms, with or
+ * without modification, are permitted provided that the following
+ * conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above
+ *    copyright notice, this list of conditions and the
+ *    following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above
+ *    copyright notice, this list of conditions and the following
+ *    disclaimer in the documentation and/or other materials
+ *    provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY AUTHORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+ * TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL
+ * AUTHORS OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+ * INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+ * THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#if defined(__cplusplus)
+extern "C" {
+#endif /* defined(__cplusplus) */
+
+/**
+ * Background defragmentation of the memtx tuple arena.
+ *
+ * The slab allocator never moves tuples, so after churn of
+ * tuples of different sizes many slabs stay partly empty and
+ * keep their memory quota. When the share of free space in the
+ * tuple slabs exceeds a threshold, a fiber walks all memtx
+ * spaces and relocates tuples to lower slabs, updating all
+ * indexes of the space. Emptied slabs return to the arena.
+ */
+
+struct memtx_defrag_stat {
+	/** Number of finished passes over all spaces. */
+	uint64_t passes;
+	/** Number of relocated tuples. */
+	uint64_t moved;
+	/** Total size of relocated tuples, in bytes. */
+	uint64_t moved_size;
+	/** True while a pass is in progress. */
+	bool is_running;
+};
+
+/**
+ * Set the share of free space in tuple slabs, from 0 to 1,
+ * above which a defragmentation pass is started. 0 disables
+ * defragmentation. The defragmentation fiber is started on
+ * the first call with a non-zero threshold.
+ *
+ * @retval  0 success.
+ * @retval -1 failed to start the fiber, diag is set.
+ */
+int
+memtx_defrag_set_threshold(double threshold);
+
+/**
+ * Set the longest time, in seconds, the defragmentation fiber
+ * may run without yielding.
+ */
+void
+memtx_defrag_set_budget(double budget);
+
+/**
+ * Share of free space in the tuple slabs, from 0 to 1:
+ * the fragmentation the threshold is compared with.
+ */
+double
+memtx_defrag_ratio(void);
+
+void
+memtx_defrag_stat(struct memtx_defrag_stat *stat);
+
+#if defined(__cplusplus)
+} /* extern "C" */
+#endif /* defined(__cplusplus) */
+
+#endif /* TARANTOOL_BOX_MEMTX_DEFRAG_H_INCLUDED */
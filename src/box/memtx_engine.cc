@@ -31,7 +31,9 @@
 #include "memtx_engine.h"
 #include "memtx_space.h"
 #include "memtx_tuple.h"
+#include "memtx_defrag.h"
 
+#include "cbus.h"
 #include "coeio.h"
 #include "coeio_file.h"
 #include "scoped_guard.h"
@@ -86,41 +88,176 @@ memtx_end_build_primary_key(struct space *space, void *param)
 }
 
 /**
- * Secondary indexes are built in bulk after all data is
- * recovered. This function enables secondary keys on a space.
- * Data dictionary spaces are an exception, they are fully
- * built right from the start.
+ * Max number of secondary indexes built concurrently after
+ * recovery. Tree indexes, which take most of the build time,
+ * are sorted in coeio threads, so this also limits the number
+ * of threads busy sorting at the same time.
  */
-void
-memtx_build_secondary_keys(struct space *space, void *param)
+enum { MEMTX_BUILD_FIBER_COUNT = 4 };
+
+/**
+ * State of a bulk build of secondary keys of memtx spaces,
+ * shared by all fibers participating in the build.
+ */
+struct memtx_build {
+	MemtxEngine *engine;
+	/** Spaces whose secondary keys are to be built. */
+	struct space **spaces;
+	uint32_t space_count;
+	uint32_t space_alloc;
+	/** Space and index to be built next. */
+	uint32_t next_space;
+	uint32_t next_index;
+	/** Set if building of any index failed. */
+	bool is_failed;
+};
+
+static void
+memtx_build_add_space(struct space *space, void *param)
 {
+	struct memtx_build *build = (struct memtx_build *) param;
 	struct MemtxSpace *handler = (struct MemtxSpace *) space->handler;
-	if (handler->engine != param || space_index(space, 0) == NULL ||
+	if (handler->engine != build->engine || space_index(space, 0) == NULL ||
 	    handler->replace == memtx_replace_all_keys)
 		return;
 
-	if (space->index_id_max > 0) {
-		MemtxIndex *pk = (MemtxIndex *) space->index[0];
-		uint32_t n_tuples = pk->size();
+	if (build->space_count == build->space_alloc) {
+		uint32_t alloc = MAX(build->space_alloc * 2, 16);
+		size_t size = alloc * sizeof(*build->spaces);
+		struct space **spaces = (struct space **)
+			realloc(build->spaces, size);
+		if (spaces == NULL)
+			tnt_raise(OutOfMemory, size, "realloc", "spaces");
+		build->spaces = spaces;
+		build->space_alloc = alloc;
+	}
+	build->spaces[build->space_count++] = space;
 
-		if (n_tuples > 0) {
-			say_info("Building secondary indexes in space '%s'...",
-				 space_name(space));
+	if (space->index_id_max > 0 && space->index[0]->size() > 0) {
+		say_info("Building secondary indexes in space '%s'...",
+			 space_name(space));
+	}
+}
+
+/**
+ * Return the next secondary index to build or NULL if there
+ * are no more. The primary key of the index space is returned
+ * in @a pk.
+ */
+static MemtxIndex *
+memtx_build_next(struct memtx_build *build, MemtxIndex **pk)
+{
+	while (!build->is_failed && build->next_space < build->space_count) {
+		struct space *space = build->spaces[build->next_space];
+		if (space->index_id_max > 0 &&
+		    build->next_index < space->index_count) {
+			*pk = (MemtxIndex *) space->index[0];
+			return (MemtxIndex *) space->index[build->next_index++];
 		}
+		build->next_space++;
+		build->next_index = 1;
+	}
+	return NULL;
+}
 
-		for (uint32_t j = 1; j < space->index_count; j++)
-			index_build((MemtxIndex *) space->index[j], pk);
+static ssize_t
+memtx_tree_sort_build_f(va_list ap)
+{
+	MemtxTree *index = va_arg(ap, MemtxTree *);
+	index->sortBuild();
+	return 0;
+}
 
-		if (n_tuples > 0) {
-			say_info("Space '%s': done", space_name(space));
+static int
+memtx_build_f(va_list ap)
+{
+	struct memtx_build *build = va_arg(ap, struct memtx_build *);
+	MemtxIndex *index, *pk;
+	try {
+		while ((index = memtx_build_next(build, &pk)) != NULL) {
+			if (index->index_def->type != TREE) {
+				index_build(index, pk);
+				continue;
+			}
+			index_build_fill(index, pk);
+			/*
+			 * Sort tuples in a coeio thread so that other
+			 * indexes can be built meanwhile. coio_call()
+			 * disables cancellation and has no timeout, so
+			 * it returns only when the task is complete.
+			 * It fails only if the task couldn't be
+			 * submitted, and then endBuild() sorts the
+			 * tuples in place.
+			 */
+			if (coio_call(memtx_tree_sort_build_f,
+				      (MemtxTree *) index) != 0) {
+				say_warn("failed to sort index '%s' "
+					 "in background", index_name(index));
+			}
+			index->endBuild();
 		}
+	} catch (Exception *e) {
+		build->is_failed = true;
+		return -1;
+	}
+	return 0;
+}
+
+/**
+ * Secondary indexes are built in bulk after all data is
+ * recovered. This function builds secondary keys of all
+ * spaces of the given engine and enables them. Indexes are
+ * built concurrently, with the TX thread only collecting
+ * tuples and installing sorted data into trees.
+ * Data dictionary spaces are an exception, they are fully
+ * built right from the start.
+ */
+static void
+memtx_build_secondary_keys(MemtxEngine *engine)
+{
+	struct memtx_build build;
+	memset(&build, 0, sizeof(build));
+	build.engine = engine;
+	build.next_index = 1;
+	auto guard = make_scoped_guard([&]{ free(build.spaces); });
+
+	space_foreach(memtx_build_add_space, &build);
+
+	struct fiber *fibers[MEMTX_BUILD_FIBER_COUNT];
+	int fiber_count = 0;
+	for (; fiber_count < MEMTX_BUILD_FIBER_COUNT; fiber_count++) {
+		struct fiber *f = fiber_new("memtx.build", memtx_build_f);
+		if (f == NULL) {
+			if (fiber_count == 0)
+				diag_raise();
+			break;
+		}
+		fiber_set_joinable(f, true);
+		fiber_start(f, &build);
+		fibers[fiber_count] = f;
+	}
+	int rc = 0;
+	for (int i = 0; i < fiber_count; i++) {
+		if (fiber_join(fibers[i]) != 0)
+			rc = -1;
+	}
+	if (rc != 0)
+		diag_raise();
+
+	for (uint32_t i = 0; i < build.space_count; i++) {
+		struct space *space = build.spaces[i];
+		struct MemtxSpace *handler = (struct MemtxSpace *)
+			space->handler;
+		handler->replace = memtx_replace_all_keys;
+		if (space->index_id_max > 0 && space->index[0]->size() > 0)
+			say_info("Space '%s': done", space_name(space));
 	}
-	handler->replace = memtx_replace_all_keys;
 }
 
 MemtxEngine::MemtxEngine(const char *snap_dirname, bool force_recovery,
 			 uint64_t tuple_arena_max_size, uint32_t objsize_min,
-			 uint32_t objsize_max, float alloc_factor)
+			 uint32_t objsize_max, float alloc_factor,
+			 bool huge_pages, int numa_node)
 	:Engine("memtx", &memtx_tuple_format_vtab),
 	m_checkpoint(0),
 	m_state(MEMTX_INITIALIZED),
@@ -128,7 +265,7 @@ MemtxEngine::MemtxEngine(const char *snap_dirname, bool force_recovery,
 	m_force_recovery(force_recovery)
 {
 	memtx_tuple_init(tuple_arena_max_size, objsize_min, objsize_max,
-			 alloc_factor);
+			 alloc_factor, huge_pages, numa_node);
 
 	flags = ENGINE_CAN_BE_TEMPORARY;
 	xdir_create(&m_snap_dir, snap_dirname, SNAP, &INSTANCE_UUID);
@@ -143,15 +280,287 @@ MemtxEngine::~MemtxEngine()
 	memtx_tuple_free();
 }
 
+void
+MemtxEngine::setDefragThreshold(double threshold)
+{
+	if (memtx_defrag_set_threshold(threshold) != 0)
+		diag_raise();
+}
+
+void
+MemtxEngine::setDefragBudget(double budget)
+{
+	memtx_defrag_set_budget(budget);
+}
+
 int64_t
 MemtxEngine::lastCheckpoint(struct vclock *vclock)
 {
 	return xdir_last_vclock(&m_snap_dir, vclock);
 }
 
+/* {{{ Snapshot reader */
+
+enum {
+	/** Max number of rows in a batch read from a snapshot. */
+	MEMTX_SNAP_BATCH_ROWS = 1024,
+	/** Size of row bodies at which a batch is considered full. */
+	MEMTX_SNAP_BATCH_SIZE = 1024 * 1024,
+	/** Number of batches the reader may fill in advance. */
+	MEMTX_SNAP_BATCH_COUNT = 4,
+};
+
+/**
+ * Snapshot reader. To speed up recovery, file I/O,
+ * decompression, checksum verification and row header
+ * decoding are done in a separate thread, which reads
+ * a snapshot ahead of TX and passes rows to it in batches
+ * over cbus, so that TX only has to create tuples and insert
+ * them into indexes.
+ */
+struct memtx_snap_reader {
+	/** Path to the snapshot file. */
+	const char *filename;
+	/** Skip corrupted rows instead of failing. */
+	bool force_recovery;
+	/** Instance UUID, set by the reader on opening the file. */
+	struct tt_uuid instance_uuid;
+	/** Set by the reader if the snapshot has an EOF marker. */
+	bool has_eof;
+	/**
+	 * Set by the reader if TX requested to stop reading,
+	 * because it failed to apply a row.
+	 */
+	bool is_stopped;
+	/** Reader thread. */
+	struct cord cord;
+	/** Pipe from the reader to TX. */
+	struct cpipe tx_pipe;
+	/** Pipe from TX to the reader. */
+	struct cpipe reader_pipe;
+	/** TX endpoint accepting batches of rows. */
+	struct cbus_endpoint tx_endpoint;
+	/** Batches received by TX, not yet applied. */
+	struct stailq ready;
+	/** Batches available to the reader for filling. */
+	struct stailq free;
+	/** All batches, allocated and freed by TX. */
+	struct memtx_snap_batch *batches[MEMTX_SNAP_BATCH_COUNT];
+};
+
+/** A batch of rows passed from the snapshot reader to TX. */
+struct memtx_snap_batch {
+	struct cmsg base;
+	struct memtx_snap_reader *reader;
+	/** Link in memtx_snap_reader::ready or ::free. */
+	struct stailq_entry in_list;
+	/** Rows read from the file. */
+	struct xrow_header rows[MEMTX_SNAP_BATCH_ROWS];
+	int row_count;
+	/** Buffer storing bodies of the rows. */
+	char *data;
+	size_t data_size;
+	size_t data_capacity;
+	/** Set for the last batch sent by the reader. */
+	bool is_last;
+	/**
+	 * Set if the reader failed to read the file after
+	 * the rows of this batch. The error is in @diag.
+	 */
+	bool is_error;
+	struct diag diag;
+	/** Set by TX to tell the reader to stop reading. */
+	bool stop;
+};
+
+/** Copy bodies of a row into the batch buffer. */
+static int
+memtx_snap_batch_copy_body(struct memtx_snap_batch *batch,
+			   struct xrow_header *row)
+{
+	size_t size = 0;
+	for (int i = 0; i < row->bodycnt; i++)
+		size += row->body[i].iov_len;
+	if (batch->data_size + size > batch->data_capacity) {
+		size_t capacity = MAX(batch->data_capacity * 2,
+				      batch->data_size + size);
+		uintptr_t old_data = (uintptr_t) batch->data;
+		char *data = (char *) realloc(batch->data, capacity);
+		if (data == NULL) {
+			diag_set(OutOfMemory, capacity,
+				 "realloc", "snapshot batch");
+			return -1;
+		}
+		/* Relocate bodies of the rows already in the batch. */
+		for (int i = 0; i < batch->row_count; i++) {
+			struct xrow_header *r = &batch->rows[i];
+			for (int j = 0; j < r->bodycnt; j++) {
+				uintptr_t offset = (uintptr_t)
+					r->body[j].iov_base - old_data;
+				r->body[j].iov_base = data + offset;
+			}
+		}
+		batch->data = data;
+		batch->data_capacity = capacity;
+	}
+	for (int i = 0; i < row->bodycnt; i++) {
+		char *body = batch->data + batch->data_size;
+		memcpy(body, row->body[i].iov_base, row->body[i].iov_len);
+		row->body[i].iov_base = body;
+		batch->data_size += row->body[i].iov_len;
+	}
+	return 0;
+}
+
+/**
+ * Read rows from a snapshot into a batch until it is full.
+ * Returns true if there are no more rows to read, because
+ * either the end of the file was reached or an error occurred,
+ * in which case the batch is marked with is_error.
+ */
+static bool
+memtx_snap_batch_fill(struct memtx_snap_batch *batch,
+		      struct xlog_cursor *cursor, bool force_recovery)
+{
+	batch->row_count = 0;
+	batch->data_size = 0;
+	while (batch->row_count < MEMTX_SNAP_BATCH_ROWS &&
+	       batch->data_size < MEMTX_SNAP_BATCH_SIZE) {
+		struct xrow_header *row = &batch->rows[batch->row_count];
+		int rc = xlog_cursor_next(cursor, row, force_recovery);
+		if (rc > 0)
+			return true;
+		if (rc < 0 || memtx_snap_batch_copy_body(batch, row) != 0) {
+			batch->is_error = true;
+			diag_move(diag_get(), &batch->diag);
+			return true;
+		}
+		batch->row_count++;
+	}
+	return false;
+}
+
+/** Called in TX on receiving a batch from the reader. */
+static void
+memtx_snap_batch_ready(struct cmsg *msg)
+{
+	struct memtx_snap_batch *batch = (struct memtx_snap_batch *) msg;
+	stailq_add_tail_entry(&batch->reader->ready, batch, in_list);
+}
+
+/** Called in the reader when TX is done with a batch. */
+static void
+memtx_snap_batch_free(struct cmsg *msg)
+{
+	struct memtx_snap_batch *batch = (struct memtx_snap_batch *) msg;
+	struct memtx_snap_reader *reader = batch->reader;
+	if (batch->stop)
+		reader->is_stopped = true;
+	stailq_add_tail_entry(&reader->free, batch, in_list);
+}
+
+static int
+memtx_snap_reader_f(va_list ap)
+{
+	static const struct cmsg_hop route[1] = {
+		{memtx_snap_batch_ready, NULL}
+	};
+	struct memtx_snap_reader *reader =
+		va_arg(ap, struct memtx_snap_reader *);
+
+	struct cbus_endpoint endpoint;
+	cbus_endpoint_create(&endpoint, "snap_reader",
+			     fiber_schedule_cb, fiber());
+	cpipe_create(&reader->tx_pipe, "snap_tx");
+	/* Deliver batches to TX as soon as they are ready. */
+	cpipe_set_max_input(&reader->tx_pipe, 1);
+
+	struct xlog_cursor cursor;
+	bool is_open = (xlog_cursor_open(&cursor, reader->filename) == 0);
+	if (is_open)
+		reader->instance_uuid = cursor.meta.instance_uuid;
+
+	bool is_last = false;
+	while (!is_last) {
+		cbus_process(&endpoint);
+		if (stailq_empty(&reader->free)) {
+			/* Wait for TX to return a batch. */
+			fiber_yield();
+			continue;
+		}
+		struct memtx_snap_batch *batch = stailq_shift_entry(
+				&reader->free, struct memtx_snap_batch, in_list);
+		batch->row_count = 0;
+		if (!is_open) {
+			batch->is_error = true;
+			diag_move(diag_get(), &batch->diag);
+			is_last = true;
+		} else if (reader->is_stopped) {
+			is_last = true;
+		} else {
+			is_last = memtx_snap_batch_fill(batch, &cursor,
+							reader->force_recovery);
+		}
+		batch->is_last = is_last;
+		cmsg_init(&batch->base, route);
+		cpipe_push(&reader->tx_pipe, &batch->base);
+	}
+
+	if (is_open) {
+		reader->has_eof = (cursor.state == XLOG_CURSOR_EOF);
+		xlog_cursor_close(&cursor, false);
+	}
+	cpipe_destroy(&reader->tx_pipe);
+	cbus_endpoint_destroy(&endpoint, cbus_process);
+	return 0;
+}
+
+static void
+memtx_snap_reader_destroy(struct memtx_snap_reader *reader)
+{
+	for (int i = 0; i < MEMTX_SNAP_BATCH_COUNT; i++) {
+		struct memtx_snap_batch *batch = reader->batches[i];
+		if (batch == NULL)
+			continue;
+		diag_destroy(&batch->diag);
+		free(batch->data);
+		free(batch);
+	}
+}
+
+static void
+memtx_snap_reader_create(struct memtx_snap_reader *reader,
+			 const char *filename, bool force_recovery)
+{
+	memset(reader, 0, sizeof(*reader));
+	reader->filename = filename;
+	reader->force_recovery = force_recovery;
+	reader->instance_uuid = INSTANCE_UUID;
+	stailq_create(&reader->ready);
+	stailq_create(&reader->free);
+	for (int i = 0; i < MEMTX_SNAP_BATCH_COUNT; i++) {
+		struct memtx_snap_batch *batch = (struct memtx_snap_batch *)
+			calloc(1, sizeof(*batch));
+		if (batch == NULL) {
+			memtx_snap_reader_destroy(reader);
+			tnt_raise(OutOfMemory, sizeof(*batch),
+				  "calloc", "snapshot batch");
+		}
+		batch->reader = reader;
+		diag_create(&batch->diag);
+		stailq_add_tail_entry(&reader->free, batch, in_list);
+		reader->batches[i] = batch;
+	}
+}
+
+/* }}} */
+
 void
 MemtxEngine::recoverSnapshot()
 {
+	static const struct cmsg_hop route[1] = {
+		{memtx_snap_batch_free, NULL}
+	};
 	struct vclock vclock;
 	if (lastCheckpoint(&vclock) < 0)
 		return;
@@ -163,41 +572,83 @@ MemtxEngine::recoverSnapshot()
 						    NONE);
 
 	say_info("recovering from `%s'", filename);
-	struct xlog_cursor cursor;
-	xlog_cursor_open_xc(&cursor, filename);
-	INSTANCE_UUID = cursor.meta.instance_uuid;
+	struct memtx_snap_reader reader;
+	memtx_snap_reader_create(&reader, filename,
+				 m_snap_dir.force_recovery);
 	auto reader_guard = make_scoped_guard([&]{
-		xlog_cursor_close(&cursor, false);
+		memtx_snap_reader_destroy(&reader);
 	});
 
-	struct xrow_header row;
+	cbus_endpoint_create(&reader.tx_endpoint, "snap_tx",
+			     fiber_schedule_cb, fiber());
+	if (cord_costart(&reader.cord, "snap_reader",
+			 memtx_snap_reader_f, &reader) != 0) {
+		cbus_endpoint_destroy(&reader.tx_endpoint, NULL);
+		diag_raise();
+	}
+	cpipe_create(&reader.reader_pipe, "snap_reader");
+	cpipe_set_max_input(&reader.reader_pipe, 1);
+
+	bool is_first = true;
+	bool is_failed = false;
+	bool is_last = false;
 	uint64_t row_count = 0;
-	while (xlog_cursor_next_xc(&cursor, &row,
-				   m_snap_dir.force_recovery) == 0) {
-		try {
-			recoverSnapshotRow(&row);
-		} catch (ClientError *e) {
-			if (!m_snap_dir.force_recovery)
-				throw;
-			say_error("can't apply row: ");
-			e->log();
+	while (!is_last) {
+		cbus_process(&reader.tx_endpoint);
+		if (stailq_empty(&reader.ready)) {
+			/* Wait for the reader to send a batch. */
+			fiber_yield();
+			continue;
+		}
+		struct memtx_snap_batch *batch = stailq_shift_entry(
+				&reader.ready, struct memtx_snap_batch, in_list);
+		if (is_first) {
+			INSTANCE_UUID = reader.instance_uuid;
+			is_first = false;
+		}
+		for (int i = 0; i < batch->row_count && !is_failed; i++) {
+			try {
+				recoverSnapshotRow(&batch->rows[i]);
+			} catch (ClientError *e) {
+				if (!m_snap_dir.force_recovery) {
+					is_failed = true;
+					break;
+				}
+				say_error("can't apply row: ");
+				e->log();
+			} catch (Exception *e) {
+				is_failed = true;
+				break;
+			}
+			++row_count;
+			if (row_count % 100000 == 0) {
+				say_info("%.1fM rows processed",
+					 row_count / 1000000.);
+				fiber_yield_timeout(0);
+			}
 		}
-		++row_count;
-		if (row_count % 100000 == 0) {
-			say_info("%.1fM rows processed",
-				 row_count / 1000000.);
-			fiber_yield_timeout(0);
+		if (batch->is_error && !is_failed) {
+			diag_move(&batch->diag, diag_get());
+			is_failed = true;
 		}
+		is_last = batch->is_last;
+		/* Return the batch to the reader for reuse. */
+		batch->stop = is_failed;
+		cmsg_init(&batch->base, route);
+		cpipe_push(&reader.reader_pipe, &batch->base);
 	}
+	cpipe_destroy(&reader.reader_pipe);
+	cbus_endpoint_destroy(&reader.tx_endpoint, cbus_process);
+	if (cord_cojoin(&reader.cord) != 0 || is_failed)
+		diag_raise();
 
 	/**
 	 * We should never try to read snapshots with no EOF
 	 * marker - such snapshots are very likely corrupted and
 	 * should not be trusted.
 	 */
-	if (cursor.state != XLOG_CURSOR_EOF)
+	if (!reader.has_eof)
 		panic("snapshot `%s' has no EOF marker", filename);
-
 }
 
 void
@@ -269,7 +720,7 @@ MemtxEngine::beginFinalRecovery()
 		 * unique keys.
 		 */
 		m_state = MEMTX_OK;
-		space_foreach(memtx_build_secondary_keys, this);
+		memtx_build_secondary_keys(this);
 	}
 }
 
@@ -285,7 +736,7 @@ MemtxEngine::endRecovery()
 	if (m_state != MEMTX_OK) {
 		assert(m_state == MEMTX_FINAL_RECOVERY);
 		m_state = MEMTX_OK;
-		space_foreach(memtx_build_secondary_keys, this);
+		memtx_build_secondary_keys(this);
 	}
 }
 
@@ -380,6 +831,28 @@ MemtxEngine::buildSecondaryKey(struct space *old_space,
 	/* Build the new index. */
 	struct tuple *tuple;
 	struct tuple_format *format = new_space->format;
+	if (new_index_def->type == TREE) {
+		/*
+		 * Bulk-load a tree index: collect the tuples,
+		 * sort them and build the tree from the sorted
+		 * array in one pass, which is a lot faster than
+		 * inserting tuples one by one. Uniqueness is
+		 * checked on the sorted array.
+		 */
+		MemtxTree *tree = (MemtxTree *) new_index;
+		tree->beginBuild();
+		tree->reserve(pk->size());
+		while ((tuple = it->next(it))) {
+			if (tuple_validate(format, tuple))
+				diag_raise();
+			tree->buildNext(tuple);
+		}
+		tree->sortBuild();
+		if (new_index_def->opts.is_unique)
+			tree->checkBuildUnique();
+		tree->endBuild();
+		return;
+	}
 	while ((tuple = it->next(it))) {
 		/*
 		 * Check that the tuple is OK according to the
@@ -400,6 +873,18 @@ MemtxEngine::buildSecondaryKey(struct space *old_space,
 void
 MemtxEngine::checkIndexDef(struct space *space, struct index_def *index_def)
 {
+	if (index_def_is_functional(index_def) && index_def->type != TREE) {
+		tnt_raise(ClientError, ER_MODIFY_INDEX,
+			  index_def->name,
+			  space_name(space),
+			  "functional index must be TREE");
+	}
+	if (!index_def->opts.hint && index_def->type != TREE) {
+		tnt_raise(ClientError, ER_MODIFY_INDEX,
+			  index_def->name,
+			  space_name(space),
+			  "hint is only supported by TREE index");
+	}
 	switch (index_def->type) {
 	case HASH:
 		if (! index_def->opts.is_unique) {
@@ -521,6 +1006,16 @@ MemtxEngine::rollbackStatement(struct txn *, struct txn_stmt *stmt)
 	int index_count;
 	struct MemtxSpace *handler = (struct MemtxSpace *) space->handler;
 
+	if (stmt->old_tuple == stmt->new_tuple) {
+		/* The tuple was updated in place. */
+		memtx_tuple_rollback_update(space->format, stmt->new_tuple,
+					    stmt->engine_savepoint);
+		tuple_unref(stmt->new_tuple);
+		stmt->old_tuple = NULL;
+		stmt->new_tuple = NULL;
+		return;
+	}
+
 	/* Only roll back the changes if they were made. */
 	if (stmt->engine_savepoint == NULL)
 		index_count = 0;
@@ -532,14 +1027,20 @@ MemtxEngine::rollbackStatement(struct txn *, struct txn_stmt *stmt)
 		panic("transaction rolled back during snapshot recovery");
 
 	for (int i = 0; i < index_count; i++) {
-		Index *index = space->index[i];
-		index->replace(stmt->new_tuple, stmt->old_tuple, DUP_INSERT);
+		MemtxIndex *index = (MemtxIndex *) space->index[i];
+		index->rollbackReplace(stmt, stmt->old_tuple,
+				       stmt->new_tuple);
 	}
+	memtx_func_keys_release(stmt);
 	/** Rollback change of bsize */
 	space_bsize_rollback(space, stmt->bsize_change);
 
-	if (stmt->new_tuple)
+	if (stmt->new_tuple) {
+		/* The statement reference, see memtx_replace_all_keys(). */
+		if (stmt->engine_savepoint != NULL)
+			tuple_unref(stmt->new_tuple);
 		tuple_unref(stmt->new_tuple);
+	}
 
 	stmt->old_tuple = NULL;
 	stmt->new_tuple = NULL;
@@ -561,8 +1062,18 @@ MemtxEngine::commit(struct txn *txn, int64_t signature)
 	(void) signature;
 	struct txn_stmt *stmt;
 	stailq_foreach_entry(stmt, &txn->stmts, next) {
+		memtx_func_keys_release(stmt);
 		if (stmt->old_tuple)
 			tuple_unref(stmt->old_tuple);
+		/*
+		 * Drop the reference of the statement, the new
+		 * tuple stays referenced by the space. A tuple
+		 * updated in place is both the old and the new one.
+		 */
+		if (stmt->new_tuple != NULL &&
+		    stmt->new_tuple != stmt->old_tuple &&
+		    stmt->engine_savepoint != NULL)
+			tuple_unref(stmt->new_tuple);
 	}
 }
 
@@ -591,8 +1102,157 @@ MemtxEngine::bootstrap()
 		recoverSnapshotRow(&row);
 }
 
+enum {
+	/**
+	 * Max number of blocks of rows the snapshot thread may
+	 * have in flight, i.e. being compressed or waiting to
+	 * be written to the file.
+	 */
+	CHECKPOINT_BLOCK_COUNT = 8,
+};
+
+/**
+ * A block of snapshot rows. Blocks are compressed in coeio
+ * threads while the snapshot thread goes on iterating over
+ * spaces and writing blocks compressed earlier to the file.
+ */
+struct checkpoint_block {
+	struct xlog_block base;
+	/** Fiber compressing the block, NULL if none. */
+	struct fiber *fiber;
+};
+
+/** Snapshot writer, used by the snapshot thread only. */
+struct checkpoint_writer {
+	struct xlog *snap;
+	/**
+	 * Ring of blocks. Blocks are written to the file in
+	 * the order they were filled.
+	 */
+	struct checkpoint_block blocks[CHECKPOINT_BLOCK_COUNT];
+	/** Sequence number of the block being filled. */
+	uint64_t seq;
+	/** Number of rows added to the snapshot so far. */
+	int64_t rows;
+};
+
+static void
+checkpoint_writer_destroy(struct checkpoint_writer *writer, int block_count)
+{
+	/*
+	 * Joining a failed fiber overwrites the current error,
+	 * which may be being propagated at this point.
+	 */
+	struct diag diag;
+	diag_create(&diag);
+	diag_move(diag_get(), &diag);
+	for (int i = 0; i < block_count; i++) {
+		struct checkpoint_block *block = &writer->blocks[i];
+		if (block->fiber != NULL)
+			fiber_join(block->fiber);
+		xlog_block_destroy(&block->base);
+	}
+	diag_move(&diag, diag_get());
+	diag_destroy(&diag);
+}
+
 static void
-checkpoint_write_row(struct xlog *l, struct xrow_header *row)
+checkpoint_writer_create(struct checkpoint_writer *writer, struct xlog *snap)
+{
+	writer->snap = snap;
+	writer->seq = 0;
+	writer->rows = 0;
+	for (int i = 0; i < CHECKPOINT_BLOCK_COUNT; i++) {
+		struct checkpoint_block *block = &writer->blocks[i];
+		if (xlog_block_create(&block->base) != 0) {
+			checkpoint_writer_destroy(writer, i);
+			diag_raise();
+		}
+		block->fiber = NULL;
+	}
+}
+
+static ssize_t
+checkpoint_block_seal_f(va_list ap)
+{
+	struct xlog_block *block = va_arg(ap, struct xlog_block *);
+	return xlog_block_seal(block);
+}
+
+static int
+checkpoint_block_fiber_f(va_list ap)
+{
+	struct xlog_block *block = va_arg(ap, struct xlog_block *);
+	if (coio_call(checkpoint_block_seal_f, block) == 0)
+		return 0;
+	/* coio_call() fails without diag if it can't allocate a task. */
+	if (diag_is_empty(diag_get()))
+		return xlog_block_seal(block);
+	return -1;
+}
+
+/**
+ * Wait for a block to be compressed, write it to the file and
+ * reset it for reuse. Does nothing if the block is empty.
+ */
+static void
+checkpoint_block_write(struct checkpoint_writer *writer,
+		       struct checkpoint_block *block)
+{
+	if (block->base.rows == 0)
+		return;
+	if (block->fiber != NULL) {
+		struct fiber *f = block->fiber;
+		block->fiber = NULL;
+		if (fiber_join(f) != 0)
+			diag_raise();
+	}
+	if (xlog_write_block(writer->snap, &block->base) < 0)
+		diag_raise();
+	xlog_block_reset(&block->base);
+}
+
+/**
+ * Start compressing the block being filled and switch to the
+ * next block, writing the block previously occupying its slot.
+ */
+static void
+checkpoint_writer_submit(struct checkpoint_writer *writer)
+{
+	struct checkpoint_block *block =
+		&writer->blocks[writer->seq % CHECKPOINT_BLOCK_COUNT];
+	if (block->base.rows == 0)
+		return;
+	struct fiber *f = fiber_new("checkpoint.compress",
+				    checkpoint_block_fiber_f);
+	if (f != NULL) {
+		fiber_set_joinable(f, true);
+		block->fiber = f;
+		fiber_start(f, &block->base);
+	} else if (xlog_block_seal(&block->base) != 0) {
+		diag_raise();
+	}
+	writer->seq++;
+	checkpoint_block_write(writer,
+		&writer->blocks[writer->seq % CHECKPOINT_BLOCK_COUNT]);
+}
+
+/** Write all pending blocks to the file in order. */
+static void
+checkpoint_writer_flush(struct checkpoint_writer *writer)
+{
+	checkpoint_writer_submit(writer);
+	for (uint64_t i = 1; i <= CHECKPOINT_BLOCK_COUNT; i++) {
+		checkpoint_block_write(writer,
+			&writer->blocks[(writer->seq + i) %
+					CHECKPOINT_BLOCK_COUNT]);
+	}
+	if (xlog_flush(writer->snap) < 0)
+		diag_raise();
+}
+
+static void
+checkpoint_write_row(struct checkpoint_writer *writer, struct xrow_header *row)
 {
 	static ev_tstamp last = 0;
 	if (last == 0) {
@@ -609,22 +1269,26 @@ checkpoint_write_row(struct xlog *l, struct xrow_header *row)
 	 * WAL. @sa the place which skips old rows in
 	 * recovery_apply_row().
 	 */
-	row->lsn = ++l->rows;
+	row->lsn = ++writer->rows;
 	row->sync = 0; /* don't write sync to wal */
 
-	ssize_t written = xlog_write_row(l, row);
+	struct checkpoint_block *block =
+		&writer->blocks[writer->seq % CHECKPOINT_BLOCK_COUNT];
+	int rc = xlog_block_add_row(&block->base, row);
 	fiber_gc();
-	if (written < 0) {
+	if (rc != 0)
 		diag_raise();
-	}
+	if (xlog_block_is_full(&block->base))
+		checkpoint_writer_submit(writer);
 
-	if (l->rows % 100000 == 0)
-		say_crit("%.1fM rows written", l->rows / 1000000.);
+	if (writer->rows % 100000 == 0)
+		say_crit("%.1fM rows written", writer->rows / 1000000.);
 
 }
 
 static void
-checkpoint_write_tuple(struct xlog *l, uint32_t n, struct tuple *tuple)
+checkpoint_write_tuple(struct checkpoint_writer *writer, uint32_t n,
+		       struct tuple *tuple)
 {
 	struct request_replace_body body;
 	body.m_body = 0x82; /* map of two elements. */
@@ -643,7 +1307,7 @@ checkpoint_write_tuple(struct xlog *l, uint32_t n, struct tuple *tuple)
 	uint32_t bsize;
 	row.body[1].iov_base = (char *) tuple_data_range(tuple, &bsize);
 	row.body[1].iov_len = bsize;
-	checkpoint_write_row(l, &row);
+	checkpoint_write_row(writer, &row);
 }
 
 struct checkpoint_entry {
@@ -731,17 +1395,25 @@ checkpoint_f(va_list ap)
 	auto guard = make_scoped_guard([&]{ xlog_close(&snap, false); });
 	snap.rate_limit = ckpt->snap_io_rate_limit;
 
+	/* Compress blocks of rows in coeio threads. */
+	coeio_enable();
+	struct checkpoint_writer writer;
+	checkpoint_writer_create(&writer, &snap);
+	auto writer_guard = make_scoped_guard([&]{
+		checkpoint_writer_destroy(&writer, CHECKPOINT_BLOCK_COUNT);
+	});
+
 	say_info("saving snapshot `%s'", snap.filename);
 	struct checkpoint_entry *entry;
 	rlist_foreach_entry(entry, &ckpt->entries, link) {
 		struct tuple *tuple;
 		struct iterator *it = entry->iterator;
 		for (tuple = it->next(it); tuple; tuple = it->next(it)) {
-			checkpoint_write_tuple(&snap, space_id(entry->space),
+			checkpoint_write_tuple(&writer, space_id(entry->space),
 					       tuple);
 		}
 	}
-	xlog_flush(&snap);
+	checkpoint_writer_flush(&writer);
 	say_info("done");
 	return 0;
 }
@@ -74,7 +74,7 @@ struct MemtxEngine: public Engine {
 	MemtxEngine(const char *snap_dirname, bool force_recovery,
 		    uint64_t tuple_arena_max_size,
 		    uint32_t objsize_min, uint32_t objsize_max,
-		    float alloc_factor);
+		    float alloc_factor, bool huge_pages, int numa_node);
 	~MemtxEngine();
 	virtual Handler *open() override;
 	virtual void addPrimaryKey(struct space *space) override;
@@ -108,6 +108,10 @@ struct MemtxEngine: public Engine {
 	{
 		m_snap_io_rate_limit = new_limit * 1024 * 1024;
 	}
+	/** Update memtx_defrag_threshold. */
+	void setDefragThreshold(double threshold);
+	/** Update memtx_defrag_budget. */
+	void setDefragBudget(double budget);
 	/**
 	 * Return LSN of the most recent snapshot or -1 if there is
 	 * no snapshot.
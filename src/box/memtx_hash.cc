@@ -36,6 +36,7 @@
 #include "space.h"
 #include "schema.h" /* space_cache_find() */
 #include "errinj.h"
+#include "port.h"
 
 #include "third_party/PMurHash.h"
 
@@ -186,6 +187,35 @@ MemtxHash::findByKey(const char *key, uint32_t part_count) const
 	return ret;
 }
 
+void
+MemtxHash::findByKeys(const char **keys, uint32_t count,
+		      struct port *port) const
+{
+	assert(index_def->opts.is_unique);
+	uint32_t hashes[MEMTX_LOOKUP_BATCH_SIZE];
+	while (count > 0) {
+		uint32_t size = MIN(count, (uint32_t) MEMTX_LOOKUP_BATCH_SIZE);
+		/*
+		 * Hash all keys of the batch and prefetch their
+		 * buckets first, so that the buckets are loaded
+		 * in parallel rather than one miss at a time.
+		 */
+		for (uint32_t i = 0; i < size; i++) {
+			hashes[i] = key_hash(keys[i], index_def);
+			light_index_prefetch(hash_table, hashes[i]);
+		}
+		for (uint32_t i = 0; i < size; i++) {
+			uint32_t k = light_index_find_key(hash_table,
+							  hashes[i], keys[i]);
+			if (k != light_index_end)
+				port_add_tuple(port,
+					       light_index_get(hash_table, k));
+		}
+		keys += size;
+		count -= size;
+	}
+}
+
 struct tuple *
 MemtxHash::replace(struct tuple *old_tuple, struct tuple *new_tuple,
 		   enum dup_replace_mode mode)
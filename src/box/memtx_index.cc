@@ -36,6 +36,9 @@
 #include "schema.h"
 #include "user_def.h"
 #include "space.h"
+#include "memtx_tuple.h"
+#include "scoped_guard.h"
+#include "txn.h"
 
 void
 MemtxIndex::beginBuild()
@@ -55,6 +58,25 @@ void
 MemtxIndex::endBuild()
 {}
 
+void
+MemtxIndex::rollbackReplace(struct txn_stmt *, struct tuple *old_tuple,
+			    struct tuple *new_tuple)
+{
+	replace(new_tuple, old_tuple, DUP_INSERT);
+}
+
+void
+memtx_func_keys_release(struct txn_stmt *stmt)
+{
+	struct memtx_func_key *key = stmt->func_keys;
+	while (key != NULL) {
+		if (!key->is_new)
+			tuple_unref(key->key);
+		key = key->next;
+	}
+	stmt->func_keys = NULL;
+}
+
 struct tuple *
 MemtxIndex::min(const char *key, uint32_t part_count) const
 {
@@ -86,8 +108,17 @@ MemtxIndex::count(enum iterator_type type, const char *key,
 	return count;
 }
 
+uint32_t
+MemtxIndex::skipIterator(struct iterator *it, uint32_t offset) const
+{
+	uint32_t skipped = 0;
+	while (skipped < offset && it->next(it) != NULL)
+		++skipped;
+	return skipped;
+}
+
 void
-index_build(MemtxIndex *index, MemtxIndex *pk)
+index_build_fill(MemtxIndex *index, MemtxIndex *pk)
 {
 	uint32_t n_tuples = pk->size();
 	uint32_t estimated_tuples = n_tuples * 1.2;
@@ -106,6 +137,115 @@ index_build(MemtxIndex *index, MemtxIndex *pk)
 	struct tuple *tuple;
 	while ((tuple = it->next(it)))
 		index->buildNext(tuple);
+}
 
+void
+index_build(MemtxIndex *index, MemtxIndex *pk)
+{
+	index_build_fill(index, pk);
 	index->endBuild();
 }
+
+/** Open read views, to forbid DDL on their spaces. */
+static RLIST_HEAD(read_views);
+
+struct read_view_iterator {
+	struct iterator base;
+	/** Iterator over the frozen index, NULL once closed. */
+	struct iterator *it;
+	MemtxIndex *index;
+	/** Format of the tuple copies returned to the user. */
+	struct tuple_format *format;
+	uint32_t space_id;
+	/** Link in read_views. */
+	struct rlist in_read_views;
+};
+
+static void
+read_view_iterator_close(struct read_view_iterator *it)
+{
+	if (it->it == NULL)
+		return;
+	it->index->destroyReadViewForIterator(it->it);
+	it->it->free(it->it);
+	it->it = NULL;
+	rlist_del_entry(it, in_read_views);
+	tuple_format_ref(it->format, -1);
+	memtx_tuple_end_snapshot();
+}
+
+static struct tuple *
+read_view_iterator_next(struct iterator *iterator)
+{
+	struct read_view_iterator *it =
+		(struct read_view_iterator *) iterator;
+	if (it->it == NULL)
+		return NULL;
+	struct tuple *tuple = it->it->next(it->it);
+	if (tuple == NULL) {
+		/* Don't pin memory after the scan is over. */
+		read_view_iterator_close(it);
+		return NULL;
+	}
+	/*
+	 * The tuple may have been deleted from the space after
+	 * the read view was created. Its header is reused by the
+	 * allocator then (see smfree_delayed()) and only the data
+	 * stays intact, so the user gets a copy.
+	 */
+	uint32_t bsize;
+	const char *data = tuple_data_range(tuple, &bsize);
+	return memtx_tuple_new_xc(it->format, data, data + bsize);
+}
+
+static void
+read_view_iterator_free(struct iterator *iterator)
+{
+	struct read_view_iterator *it =
+		(struct read_view_iterator *) iterator;
+	read_view_iterator_close(it);
+	free(it);
+}
+
+struct iterator *
+memtx_read_view_iterator_new(struct space *space, MemtxIndex *index,
+			     enum iterator_type type, const char *key,
+			     uint32_t part_count)
+{
+	struct read_view_iterator *it = (struct read_view_iterator *)
+		calloc(1, sizeof(*it));
+	if (it == NULL) {
+		tnt_raise(OutOfMemory, sizeof(*it), "malloc",
+			  "struct read_view_iterator");
+	}
+	auto it_guard = make_scoped_guard([=]{ free(it); });
+	struct iterator *index_it = index->allocIterator();
+	auto index_it_guard =
+		make_scoped_guard([=]{ index_it->free(index_it); });
+	index->initIterator(index_it, type, key, part_count);
+	index->createReadViewForIterator(index_it);
+	index_it_guard.is_active = false;
+	it_guard.is_active = false;
+
+	it->base.next = read_view_iterator_next;
+	it->base.free = read_view_iterator_free;
+	it->it = index_it;
+	it->index = index;
+	it->format = space->format;
+	tuple_format_ref(it->format, 1);
+	it->space_id = space_id(space);
+	rlist_add_entry(&read_views, it, in_read_views);
+	memtx_tuple_begin_snapshot();
+	return &it->base;
+}
+
+bool
+memtx_read_view_pins_space(uint32_t space_id)
+{
+	struct read_view_iterator *it;
+	rlist_foreach_entry(it, &read_views, in_read_views) {
+		if (it->space_id == space_id)
+			return true;
+	}
+	return false;
+}
@@ -32,6 +32,18 @@
  */
 #include "index.h"
 
+struct space;
+struct txn_stmt;
+
+enum {
+	/**
+	 * Number of keys looked up together by findByKeys() of
+	 * memtx indexes: enough to overlap cache misses of the
+	 * lookups, small enough to keep their state on stack.
+	 */
+	MEMTX_LOOKUP_BATCH_SIZE = 32
+};
+
 class MemtxIndex: public Index {
 public:
 	MemtxIndex(struct index_def *index_def_arg)
@@ -47,6 +59,15 @@ public:
 				  uint32_t part_count) const override;
 	virtual size_t count(enum iterator_type type, const char *key,
 			     uint32_t part_count) const override;
+	/**
+	 * Skip the first @a offset tuples of an iterator that has
+	 * just been initialized with initIterator(). Return the
+	 * number of tuples actually skipped, which is less than
+	 * @a offset only if the iterator is exhausted, in which
+	 * case the iterator must not be used any more.
+	 */
+	virtual uint32_t skipIterator(struct iterator *it,
+				      uint32_t offset) const;
 
 	inline struct iterator *position() const
 	{
@@ -67,6 +88,14 @@ public:
 	virtual void reserve(uint32_t /* size_hint */);
 	virtual void buildNext(struct tuple *tuple);
 	virtual void endBuild();
+	/**
+	 * Undo replace(@a old_tuple, @a new_tuple) done by the
+	 * statement @a stmt: put @a old_tuple back in place of
+	 * @a new_tuple.
+	 */
+	virtual void rollbackReplace(struct txn_stmt *stmt,
+				     struct tuple *old_tuple,
+				     struct tuple *new_tuple);
 protected:
 	/*
 	 * Pre-allocated iterator to speed up the main case of
@@ -75,8 +104,57 @@ protected:
 	mutable struct iterator *m_position;
 };
 
+/**
+ * A key tuple added to or removed from a functional index by
+ * a statement, so that rollback deletes or puts back the same
+ * key instead of calling the index function again. A removed
+ * key is referenced by the statement until it is committed or
+ * rolled back, an added one is referenced by the index.
+ */
+struct memtx_func_key {
+	/** The next key of the statement. */
+	struct memtx_func_key *next;
+	/** The index the key was added to or removed from. */
+	const MemtxIndex *index;
+	/** The key tuple. */
+	struct tuple *key;
+	/** True if the key was added by the statement. */
+	bool is_new;
+};
+
+/** Unreference the keys removed by the statement. */
+void
+memtx_func_keys_release(struct txn_stmt *stmt);
+
 /** Build this index based on the contents of another index. */
 void
 index_build(MemtxIndex *index, MemtxIndex *pk);
 
+/**
+ * Start building this index based on the contents of another
+ * index: call beginBuild() and feed all tuples of the other
+ * index to buildNext(). The caller is supposed to finish the
+ * build with endBuild().
+ */
+void
+index_build_fill(MemtxIndex *index, MemtxIndex *pk);
+
+/**
+ * Create an iterator over a consistent read view of a memtx
+ * index. The iterator does not see changes made after it was
+ * created and returns copies of the tuples it finds. The read
+ * view is released when the iterator is exhausted or freed.
+ * Tuples deleted meanwhile are kept in memory until then, and
+ * the space can't be altered. Functional indexes don't support
+ * read views.
+ */
+struct iterator *
+memtx_read_view_iterator_new(struct space *space, MemtxIndex *index,
+			     enum iterator_type type, const char *key,
+			     uint32_t part_count);
+
+/** Return true if there is an open read view of the space. */
+bool
+memtx_read_view_pins_space(uint32_t space_id);
+
 #endif /* TARANTOOL_BOX_MEMTX_INDEX_H_INCLUDED */
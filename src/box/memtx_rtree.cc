@@ -161,10 +161,12 @@ MemtxRTree::~MemtxRTree()
 		m_position = NULL;
 	}
 	rtree_destroy(&m_tree);
+	free(m_build_array);
 }
 
 MemtxRTree::MemtxRTree(struct index_def *index_def_arg)
-	: MemtxIndex(index_def_arg)
+	: MemtxIndex(index_def_arg), m_build_array(NULL),
+	  m_build_array_size(0), m_build_array_alloc_size(0)
 {
 	assert(index_def->key_def.part_count == 1);
 	assert(index_def->key_def.parts[0].type == FIELD_TYPE_ARRAY);
@@ -306,3 +308,50 @@ MemtxRTree::beginBuild()
 	rtree_purge(&m_tree);
 }
 
+void
+MemtxRTree::reserve(uint32_t size_hint)
+{
+	if (size_hint <= m_build_array_alloc_size)
+		return;
+	struct tuple **array = (struct tuple **)
+		realloc(m_build_array, size_hint * sizeof(*array));
+	if (array == NULL) {
+		tnt_raise(OutOfMemory, size_hint * sizeof(*array),
+			  "MemtxRTree", "build array");
+	}
+	m_build_array = array;
+	m_build_array_alloc_size = size_hint;
+}
+
+void
+MemtxRTree::buildNext(struct tuple *tuple)
+{
+	/* Check the rectangle now, rtree_build() can't fail on it. */
+	struct rtree_rect rect;
+	extract_rectangle(&rect, tuple, index_def);
+	if (m_build_array_size == m_build_array_alloc_size)
+		reserve(MAX(m_build_array_alloc_size * 3 / 2, 1024));
+	m_build_array[m_build_array_size++] = tuple;
+}
+
+static void
+memtx_rtree_extract_rect(struct rtree_rect *rect, record_t record, void *ctx)
+{
+	extract_rectangle(rect, (struct tuple *)record,
+			  (struct index_def *)ctx);
+}
+
+void
+MemtxRTree::endBuild()
+{
+	if (rtree_build(&m_tree, (record_t *)m_build_array,
+			m_build_array_size, memtx_rtree_extract_rect,
+			index_def) != 0)
+		tnt_raise(OutOfMemory, m_build_array_size * sizeof(record_t),
+			  "MemtxRTree", "build");
+	free(m_build_array);
+	m_build_array = NULL;
+	m_build_array_size = 0;
+	m_build_array_alloc_size = 0;
+}
+
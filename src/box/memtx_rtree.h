@@ -41,6 +41,13 @@ public:
 	~MemtxRTree();
 
 	virtual void beginBuild() override;
+	virtual void reserve(uint32_t size_hint) override;
+	virtual void buildNext(struct tuple *tuple) override;
+	/**
+	 * Bulk-load the tuples accumulated with buildNext()
+	 * with Sort-Tile-Recursive packing.
+	 */
+	virtual void endBuild() override;
 	virtual size_t size() const override;
 	virtual struct tuple *findByKey(const char *key,
 					uint32_t part_count) const override;
@@ -58,6 +65,9 @@ public:
 protected:
 	unsigned m_dimension;
 	struct rtree m_tree;
+	/** Tuples accumulated with buildNext(). */
+	struct tuple **m_build_array;
+	size_t m_build_array_size, m_build_array_alloc_size;
 };
 
 #endif /* TARANTOOL_BOX_MEMTX_RTREE_H_INCLUDED */
@@ -88,6 +88,7 @@ memtx_replace_build_next(struct txn_stmt *stmt, struct space *space,
 	}
 	((MemtxIndex *) space->index[0])->buildNext(stmt->new_tuple);
 	stmt->engine_savepoint = stmt;
+	tuple_ref(stmt->new_tuple);
 	stmt->bsize_change = space_bsize_update(space, NULL, stmt->new_tuple);
 }
 
@@ -102,6 +103,8 @@ memtx_replace_primary_key(struct txn_stmt *stmt, struct space *space,
 	stmt->old_tuple = space->index[0]->replace(stmt->old_tuple,
 						   stmt->new_tuple, mode);
 	stmt->engine_savepoint = stmt;
+	if (stmt->new_tuple != NULL)
+		tuple_ref(stmt->new_tuple);
 	stmt->bsize_change = space_bsize_update(space, stmt->old_tuple, stmt->new_tuple);
 }
 
@@ -223,13 +226,23 @@ memtx_replace_all_keys(struct txn_stmt *stmt, struct space *space,
 	} catch (Exception *e) {
 		/* Rollback all changes */
 		for (; i > 0; i--) {
-			Index *index = space->index[i-1];
-			index->replace(new_tuple, old_tuple, DUP_INSERT);
+			MemtxIndex *index = (MemtxIndex *) space->index[i-1];
+			index->rollbackReplace(stmt, old_tuple, new_tuple);
 		}
 		throw;
 	}
 	stmt->old_tuple = old_tuple;
 	stmt->engine_savepoint = stmt;
+	/*
+	 * The statement references the new tuple until it is
+	 * committed or rolled back, in addition to the space.
+	 * This keeps tuples of transactions waiting for WAL from
+	 * being modified in place or moved, see
+	 * memtx_tuple_is_mutable(): a rollback would put the
+	 * stale tuple pointer back into the indexes.
+	 */
+	if (new_tuple != NULL)
+		tuple_ref(new_tuple);
 	stmt->bsize_change = space_bsize_update(space, old_tuple, new_tuple);
 }
 
@@ -290,6 +303,74 @@ MemtxSpace::prepareDelete(struct txn_stmt *stmt, struct space *space,
 	stmt->old_tuple = pk->findByKey(key, part_count);
 }
 
+/**
+ * Return the bitmask of columns used in the space indexes,
+ * bit 63 - n is set for field n, see tuple_update_execute().
+ * The key of a functional index may depend on any field.
+ */
+static uint64_t
+memtx_space_key_column_mask(struct space *space)
+{
+	uint64_t mask = 0;
+	for (uint32_t i = 0; i < space->index_count; i++) {
+		struct index_def *index_def = space->index[i]->index_def;
+		if (index_def_is_functional(index_def))
+			return UINT64_MAX;
+		struct key_def *key_def = &index_def->key_def;
+		for (uint32_t j = 0; j < key_def->part_count; j++) {
+			uint32_t fieldno = key_def->parts[j].fieldno;
+			if (fieldno >= 64)
+				return UINT64_MAX;
+			mask |= ((uint64_t) 1) << (63 - fieldno);
+		}
+	}
+	return mask;
+}
+
+/**
+ * Try to apply the result of an UPDATE to the old tuple in place
+ * instead of allocating a new tuple and replacing it in all
+ * indexes. This is possible if no indexed field is changed, the
+ * tuple size stays the same, the tuple isn't referenced by
+ * anyone but the space, and there are no on_replace triggers,
+ * which expect distinct old and new tuples. The tuple must also
+ * have the current format of the space: the field map of a
+ * tuple created before an alter may have a different layout.
+ *
+ * On success the old tuple becomes the new tuple of the
+ * statement and the undo record is stored in the statement
+ * engine savepoint, see MemtxEngine::rollbackStatement().
+ *
+ * @retval true  the tuple has been updated in place.
+ * @retval false the update has to be done the regular way.
+ */
+static bool
+memtx_space_update_in_place(struct txn_stmt *stmt, struct space *space,
+			    const char *new_data, uint32_t new_size,
+			    uint64_t column_mask)
+{
+	struct tuple *tuple = stmt->old_tuple;
+	MemtxSpace *handler = (MemtxSpace *) space->handler;
+	if (new_size != tuple->bsize ||
+	    !rlist_empty(&space->on_replace) ||
+	    (handler->replace != memtx_replace_all_keys &&
+	     handler->replace != memtx_replace_primary_key) ||
+	    (column_mask & memtx_space_key_column_mask(space)) != 0 ||
+	    tuple->format_id != tuple_format_id(space->format) ||
+	    !memtx_tuple_is_mutable(tuple))
+		return false;
+	void *undo = memtx_tuple_update_in_place(space->format, tuple,
+						 new_data, new_data + new_size);
+	if (undo == NULL)
+		diag_raise();
+	/* Referenced by the statement, unreferenced on commit. */
+	tuple_ref(tuple);
+	stmt->new_tuple = tuple;
+	stmt->engine_savepoint = undo;
+	stmt->bsize_change = 0;
+	return true;
+}
+
 void
 MemtxSpace::prepareUpdate(struct txn_stmt *stmt, struct space *space,
 			  struct request *request)
@@ -307,15 +388,21 @@ MemtxSpace::prepareUpdate(struct txn_stmt *stmt, struct space *space,
 
 	/* Update the tuple; legacy, request ops are in request->tuple */
 	uint32_t new_size = 0, bsize;
+	uint64_t column_mask = 0;
 	const char *old_data = tuple_data_range(stmt->old_tuple, &bsize);
 	const char *new_data =
 		tuple_update_execute(region_aligned_alloc_cb, &fiber()->gc,
 				     request->tuple, request->tuple_end,
 				     old_data, old_data + bsize,
-				     &new_size, request->index_base, NULL);
+				     &new_size, request->index_base,
+				     &column_mask);
 	if (new_data == NULL)
 		diag_raise();
 
+	if (memtx_space_update_in_place(stmt, space, new_data, new_size,
+					column_mask))
+		return;
+
 	stmt->new_tuple = memtx_tuple_new_xc(space->format, new_data,
 					     new_data + new_size);
 	tuple_ref(stmt->new_tuple);
@@ -440,7 +527,8 @@ MemtxSpace::executeUpdate(struct txn *txn, struct space *space,
 {
 	struct txn_stmt *stmt = txn_current_stmt(txn);
 	prepareUpdate(stmt, space, request);
-	if (stmt->old_tuple)
+	/* Nothing to replace if the tuple was updated in place. */
+	if (stmt->old_tuple && stmt->old_tuple != stmt->new_tuple)
 		this->replace(stmt, space, DUP_REPLACE);
 	return stmt->new_tuple;
 }
@@ -470,7 +558,7 @@ MemtxSpace::createIndex(struct space *space, struct index_def *index_def_arg)
 	case HASH:
 		return new MemtxHash(index_def_arg);
 	case TREE:
-		return new MemtxTree(index_def_arg);
+		return memtx_tree_new(index_def_arg);
 	case RTREE:
 		return new MemtxRTree(index_def_arg);
 	case BITSET:
@@ -528,12 +616,11 @@ MemtxSpace::executeSelect(struct txn *, struct space *space,
 	struct iterator *it = index->position();
 	index->initIterator(it, type, key, part_count);
 
+	if (offset > 0 && index->skipIterator(it, offset) < offset)
+		return;
+
 	struct tuple *tuple;
 	while ((tuple = it->next(it)) != NULL) {
-		if (offset > 0) {
-			offset--;
-			continue;
-		}
 		if (limit == found++)
 			break;
 		port_add_tuple(port, tuple);
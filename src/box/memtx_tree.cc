@@ -29,12 +29,16 @@
  * SUCH DAMAGE.
  */
 #include "memtx_tree.h"
+#include "memtx_tuple.h"
+#include "tuple.h"
 #include "tuple_compare.h"
 #include "space.h"
 #include "schema.h" /* space_cache_find() */
 #include "errinj.h"
 #include "memory.h"
 #include "fiber.h"
+#include "txn.h"
+#include "port.h"
 #include <third_party/qsort_arg.h>
 
 /* {{{ Utilities. *************************************************/
@@ -43,49 +47,193 @@ struct key_data
 {
 	const char *key;
 	uint32_t part_count;
+	/** Comparison hint of the key, valid if part_count > 0. */
+	uint64_t hint;
 };
 
+/**
+ * Compute the comparison hint of a MsgPack field of the given
+ * type. A hint is an order-preserving mapping of field values
+ * to 64-bit integers: if hint(a) < hint(b) then a < b. Equal
+ * hints say nothing, the fields have to be compared then.
+ */
+static uint64_t
+memtx_tree_hint_field(const char *field, enum field_type type)
+{
+	switch (type) {
+	case FIELD_TYPE_UNSIGNED:
+		return mp_decode_uint(&field);
+	case FIELD_TYPE_INTEGER:
+		/*
+		 * Shift the signed range to start from 0. Values
+		 * not fitting in int64_t all share the max hint.
+		 */
+		if (mp_typeof(*field) == MP_INT)
+			return (uint64_t)mp_decode_int(&field) ^ (1ULL << 63);
+		else {
+			uint64_t value = mp_decode_uint(&field);
+			if (value > (uint64_t)INT64_MAX)
+				return UINT64_MAX;
+			return value | (1ULL << 63);
+		}
+	case FIELD_TYPE_STRING: {
+		/* First 8 bytes of the string, big-endian. */
+		uint32_t len = mp_decode_strl(&field);
+		uint64_t hint = 0;
+		for (uint32_t i = 0; i < sizeof(hint); i++) {
+			hint <<= 8;
+			if (i < len)
+				hint |= (unsigned char)field[i];
+		}
+		return hint;
+	}
+	default:
+		/* Not supported, all hints are equal. */
+		return 0;
+	}
+}
+
+/** Return true if there are hints for fields of the given type. */
+static inline bool
+memtx_tree_type_has_hint(enum field_type type)
+{
+	return type == FIELD_TYPE_UNSIGNED || type == FIELD_TYPE_INTEGER ||
+	       type == FIELD_TYPE_STRING;
+}
+
+uint64_t
+memtx_tree_hint(const struct tuple *tuple, struct index_def *index_def)
+{
+	const struct key_part *part = &index_def->key_def.parts[0];
+	if (!memtx_tree_type_has_hint((enum field_type)part->type))
+		return 0;
+	const char *field = tuple_field(tuple, part->fieldno);
+	if (field == NULL)
+		return 0;
+	return memtx_tree_hint_field(field, (enum field_type)part->type);
+}
+
+/** Return the comparison hint of a non-empty key. */
+static uint64_t
+memtx_tree_hint_key(const char *key, struct index_def *index_def)
+{
+	return memtx_tree_hint_field(key, (enum field_type)
+				     index_def->key_def.parts[0].type);
+}
+
+static inline void
+memtx_tree_data_set_hint(memtx_tree_data<true> *data, uint64_t hint)
+{
+	data->hint = hint;
+}
+
+static inline void
+memtx_tree_data_set_hint(memtx_tree_data<false> *data, uint64_t hint)
+{
+	(void)data;
+	(void)hint;
+}
+
+/** Make a tree element out of a tuple. */
+template <bool USE_HINT>
+static inline memtx_tree_data<USE_HINT>
+memtx_tree_data_new(struct tuple *tuple, struct index_def *index_def)
+{
+	memtx_tree_data<USE_HINT> data;
+	data.tuple = tuple;
+	if (USE_HINT)
+		memtx_tree_data_set_hint(&data,
+					 memtx_tree_hint(tuple, index_def));
+	return data;
+}
+
+/** Fill in a search key, computing its hint if it is needed. */
+template <bool USE_HINT>
+static inline void
+memtx_tree_key_data_create(struct key_data *key_data, const char *key,
+			   uint32_t part_count, struct index_def *index_def)
+{
+	key_data->key = key;
+	key_data->part_count = part_count;
+	key_data->hint = USE_HINT && part_count > 0 ?
+			 memtx_tree_hint_key(key, index_def) : 0;
+}
+
+/** Return the tuple a key tuple of a functional index refers to. */
+static inline struct tuple *
+memtx_tree_key_tuple_base(const struct tuple *key_tuple)
+{
+	struct tuple *tuple;
+	memcpy(&tuple, tuple_extra(key_tuple), sizeof(tuple));
+	return tuple;
+}
+
+/** Return the tuple a tree element refers to. */
+template <bool USE_HINT>
+static inline struct tuple *
+memtx_tree_elem_tuple(const memtx_tree_data<USE_HINT> *data,
+		      struct index_def *index_def)
+{
+	if (index_def_is_functional(index_def))
+		return memtx_tree_key_tuple_base(data->tuple);
+	return data->tuple;
+}
+
+template <bool USE_HINT>
 int
-memtx_tree_compare(const tuple *a, const tuple *b, struct index_def *index_def)
+memtx_tree_compare(const memtx_tree_data<USE_HINT> a,
+		   const memtx_tree_data<USE_HINT> b,
+		   struct index_def *index_def)
 {
-	int r = tuple_compare(a, b, &index_def->key_def);
+	if (USE_HINT && a.hint != b.hint)
+		return a.hint < b.hint ? -1 : 1;
+	int r = tuple_compare(a.tuple, b.tuple, &index_def->key_def);
 	if (r == 0 && !index_def->opts.is_unique)
-		r = a < b ? -1 : a > b;
+		r = a.tuple < b.tuple ? -1 : a.tuple > b.tuple;
 	return r;
 }
 
+template <bool USE_HINT>
 int
-memtx_tree_compare_key(const tuple *a, const struct key_data *key_data,
+memtx_tree_compare_key(const memtx_tree_data<USE_HINT> a,
+		       const struct key_data *key_data,
 		       struct index_def *index_def)
 {
-	return tuple_compare_with_key(a, key_data->key,
+	if (USE_HINT && key_data->part_count > 0 && a.hint != key_data->hint)
+		return a.hint < key_data->hint ? -1 : 1;
+	return tuple_compare_with_key(a.tuple, key_data->key,
 				      key_data->part_count, &index_def->key_def);
 }
 
-int
+template <bool USE_HINT>
+static int
 memtx_tree_qcompare(const void* a, const void *b, void *c)
 {
-	return memtx_tree_compare(*(struct tuple **)a,
-		*(struct tuple **)b, (struct index_def *)c);
+	return memtx_tree_compare(*(memtx_tree_data<USE_HINT> *)a,
+		*(memtx_tree_data<USE_HINT> *)b, (struct index_def *)c);
 }
 
 /* {{{ MemtxTree Iterators ****************************************/
+template <bool USE_HINT>
 struct tree_iterator {
 	struct iterator base;
-	const struct memtx_tree *tree;
+	const typename memtx_tree_type<USE_HINT>::tree *tree;
 	struct index_def *index_def;
-	struct memtx_tree_iterator tree_iterator;
+	typename memtx_tree_type<USE_HINT>::iterator tree_iterator;
 	struct key_data key_data;
+	/** Number of elements left to a bounded iterator. */
+	size_t count;
 };
 
 static void
 tree_iterator_free(struct iterator *iterator);
 
-static inline struct tree_iterator *
-tree_iterator(struct iterator *it)
+template <bool USE_HINT>
+static inline struct tree_iterator<USE_HINT> *
+tree_iterator_cast(struct iterator *it)
 {
 	assert(it->free == tree_iterator_free);
-	return (struct tree_iterator *) it;
+	return (struct tree_iterator<USE_HINT> *) it;
 }
 
 static void
@@ -101,161 +249,297 @@ tree_iterator_dummie(struct iterator *iterator)
 	return 0;
 }
 
+template <bool USE_HINT>
 static struct tuple *
 tree_iterator_fwd(struct iterator *iterator)
 {
-	struct tree_iterator *it = tree_iterator(iterator);
-	tuple **res = memtx_tree_iterator_get_elem(it->tree, &it->tree_iterator);
+	struct tree_iterator<USE_HINT> *it =
+		tree_iterator_cast<USE_HINT>(iterator);
+	memtx_tree_data<USE_HINT> *res =
+		memtx_tree_iterator_get_elem(it->tree, &it->tree_iterator);
 	if (!res)
 		return 0;
 	memtx_tree_iterator_next(it->tree, &it->tree_iterator);
-	return *res;
+	return memtx_tree_elem_tuple(res, it->index_def);
 }
 
+template <bool USE_HINT>
 static struct tuple *
 tree_iterator_bwd(struct iterator *iterator)
 {
-	struct tree_iterator *it = tree_iterator(iterator);
-	tuple **res = memtx_tree_iterator_get_elem(it->tree, &it->tree_iterator);
+	struct tree_iterator<USE_HINT> *it =
+		tree_iterator_cast<USE_HINT>(iterator);
+	memtx_tree_data<USE_HINT> *res =
+		memtx_tree_iterator_get_elem(it->tree, &it->tree_iterator);
 	if (!res)
 		return 0;
 	memtx_tree_iterator_prev(it->tree, &it->tree_iterator);
-	return *res;
+	return memtx_tree_elem_tuple(res, it->index_def);
 }
 
+template <bool USE_HINT>
 static struct tuple *
 tree_iterator_fwd_check_equality(struct iterator *iterator)
 {
-	struct tree_iterator *it = tree_iterator(iterator);
-	tuple **res = memtx_tree_iterator_get_elem(it->tree, &it->tree_iterator);
+	struct tree_iterator<USE_HINT> *it =
+		tree_iterator_cast<USE_HINT>(iterator);
+	memtx_tree_data<USE_HINT> *res =
+		memtx_tree_iterator_get_elem(it->tree, &it->tree_iterator);
 	if (!res)
 		return 0;
 	if (memtx_tree_compare_key(*res, &it->key_data, it->index_def) != 0) {
-		it->tree_iterator = memtx_tree_invalid_iterator();
+		it->tree_iterator =
+			memtx_tree_type<USE_HINT>::invalid_iterator();
 		return 0;
 	}
 	memtx_tree_iterator_next(it->tree, &it->tree_iterator);
-	return *res;
+	return memtx_tree_elem_tuple(res, it->index_def);
 }
 
+template <bool USE_HINT>
 static struct tuple *
 tree_iterator_fwd_check_next_equality(struct iterator *iterator)
 {
-	struct tree_iterator *it = tree_iterator(iterator);
-	tuple **res = memtx_tree_iterator_get_elem(it->tree, &it->tree_iterator);
+	struct tree_iterator<USE_HINT> *it =
+		tree_iterator_cast<USE_HINT>(iterator);
+	memtx_tree_data<USE_HINT> *res =
+		memtx_tree_iterator_get_elem(it->tree, &it->tree_iterator);
 	if (!res)
 		return 0;
 	memtx_tree_iterator_next(it->tree, &it->tree_iterator);
-	iterator->next = tree_iterator_fwd_check_equality;
-	return *res;
+	iterator->next = tree_iterator_fwd_check_equality<USE_HINT>;
+	return memtx_tree_elem_tuple(res, it->index_def);
 }
 
+template <bool USE_HINT>
 static struct tuple *
 tree_iterator_bwd_skip_one(struct iterator *iterator)
 {
-	struct tree_iterator *it = tree_iterator(iterator);
+	struct tree_iterator<USE_HINT> *it =
+		tree_iterator_cast<USE_HINT>(iterator);
 	memtx_tree_iterator_prev(it->tree, &it->tree_iterator);
-	iterator->next = tree_iterator_bwd;
-	return tree_iterator_bwd(iterator);
+	iterator->next = tree_iterator_bwd<USE_HINT>;
+	return tree_iterator_bwd<USE_HINT>(iterator);
 }
 
+template <bool USE_HINT>
 static struct tuple *
 tree_iterator_bwd_check_equality(struct iterator *iterator)
 {
-	struct tree_iterator *it = tree_iterator(iterator);
-	tuple **res = memtx_tree_iterator_get_elem(it->tree, &it->tree_iterator);
+	struct tree_iterator<USE_HINT> *it =
+		tree_iterator_cast<USE_HINT>(iterator);
+	memtx_tree_data<USE_HINT> *res =
+		memtx_tree_iterator_get_elem(it->tree, &it->tree_iterator);
 	if (!res)
 		return 0;
 	if (memtx_tree_compare_key(*res, &it->key_data, it->index_def) != 0) {
-		it->tree_iterator = memtx_tree_invalid_iterator();
+		it->tree_iterator =
+			memtx_tree_type<USE_HINT>::invalid_iterator();
 		return 0;
 	}
 	memtx_tree_iterator_prev(it->tree, &it->tree_iterator);
-	return *res;
+	return memtx_tree_elem_tuple(res, it->index_def);
 }
 
+template <bool USE_HINT>
 static struct tuple *
 tree_iterator_bwd_skip_one_check_next_equality(struct iterator *iterator)
 {
-	struct tree_iterator *it = tree_iterator(iterator);
+	struct tree_iterator<USE_HINT> *it =
+		tree_iterator_cast<USE_HINT>(iterator);
 	memtx_tree_iterator_prev(it->tree, &it->tree_iterator);
-	iterator->next = tree_iterator_bwd_check_equality;
-	return tree_iterator_bwd_check_equality(iterator);
+	iterator->next = tree_iterator_bwd_check_equality<USE_HINT>;
+	return tree_iterator_bwd_check_equality<USE_HINT>(iterator);
+}
+
+/*
+ * Bounded iterators return at most it->count elements without
+ * comparing them with the key. They replace equality iterators
+ * in a read view, see createReadViewForIterator().
+ */
+template <bool USE_HINT>
+static struct tuple *
+tree_iterator_fwd_bounded(struct iterator *iterator)
+{
+	struct tree_iterator<USE_HINT> *it =
+		tree_iterator_cast<USE_HINT>(iterator);
+	if (it->count == 0)
+		return 0;
+	it->count--;
+	return tree_iterator_fwd<USE_HINT>(iterator);
+}
+
+template <bool USE_HINT>
+static struct tuple *
+tree_iterator_bwd_bounded(struct iterator *iterator)
+{
+	struct tree_iterator<USE_HINT> *it =
+		tree_iterator_cast<USE_HINT>(iterator);
+	if (it->count == 0)
+		return 0;
+	it->count--;
+	return tree_iterator_bwd<USE_HINT>(iterator);
+}
+
+template <bool USE_HINT>
+static struct tuple *
+tree_iterator_bwd_skip_one_bounded(struct iterator *iterator)
+{
+	struct tree_iterator<USE_HINT> *it =
+		tree_iterator_cast<USE_HINT>(iterator);
+	memtx_tree_iterator_prev(it->tree, &it->tree_iterator);
+	iterator->next = tree_iterator_bwd_bounded<USE_HINT>;
+	return tree_iterator_bwd_bounded<USE_HINT>(iterator);
 }
 /* }}} */
 
 /* {{{ MemtxTree  **********************************************************/
 
-MemtxTree::MemtxTree(struct index_def *index_def_arg)
-	: MemtxIndex(index_def_arg), build_array(0), build_array_size(0),
-	  build_array_alloc_size(0)
+template <bool USE_HINT>
+MemtxTreeImpl<USE_HINT>::MemtxTreeImpl(struct index_def *index_def_arg)
+	: MemtxTree(index_def_arg), build_array(0), build_array_size(0),
+	  build_array_alloc_size(0), build_array_is_sorted(false),
+	  key_format(NULL)
 {
+	if (index_def_is_functional(index_def)) {
+		/*
+		 * Key tuples have the key parts as fields and
+		 * store a pointer to the indexed tuple as extra.
+		 */
+		struct key_def *key_def = &index_def->key_def;
+		key_format = tuple_format_new(&memtx_tuple_format_vtab,
+					      &key_def, 1,
+					      sizeof(struct tuple *));
+		if (key_format == NULL)
+			diag_raise();
+		tuple_format_ref(key_format, 1);
+	}
 	memtx_index_arena_init();
 	memtx_tree_create(&tree, index_def,
 			      memtx_index_extent_alloc,
 			      memtx_index_extent_free, NULL);
 }
 
-MemtxTree::~MemtxTree()
+template <bool USE_HINT>
+MemtxTreeImpl<USE_HINT>::~MemtxTreeImpl()
 {
+	if (key_format != NULL) {
+		/* Release key tuples of the tree and the build array. */
+		tree_iterator_t itr = memtx_tree_iterator_first(&tree);
+		tree_data *data;
+		while ((data = memtx_tree_iterator_get_elem(&tree,
+							    &itr)) != NULL) {
+			tuple_unref(data->tuple);
+			memtx_tree_iterator_next(&tree, &itr);
+		}
+		for (size_t i = 0; i < build_array_size; i++)
+			tuple_unref(build_array[i].tuple);
+	}
 	memtx_tree_destroy(&tree);
 	free(build_array);
+	if (key_format != NULL)
+		tuple_format_ref(key_format, -1);
 }
 
+template <bool USE_HINT>
 size_t
-MemtxTree::size() const
+MemtxTreeImpl<USE_HINT>::size() const
 {
 	return memtx_tree_size(&tree);
 }
 
+template <bool USE_HINT>
 size_t
-MemtxTree::bsize() const
+MemtxTreeImpl<USE_HINT>::bsize() const
 {
 	return memtx_tree_mem_used(&tree);
 }
 
+template <bool USE_HINT>
 struct tuple *
-MemtxTree::random(uint32_t rnd) const
+MemtxTreeImpl<USE_HINT>::random(uint32_t rnd) const
 {
-	struct tuple **res = memtx_tree_random(&tree, rnd);
-	return res ? *res : 0;
+	tree_data *res = memtx_tree_random(&tree, rnd);
+	return res ? memtx_tree_elem_tuple(res, index_def) : 0;
 }
 
+template <bool USE_HINT>
 struct tuple *
-MemtxTree::findByKey(const char *key, uint32_t part_count) const
+MemtxTreeImpl<USE_HINT>::findByKey(const char *key, uint32_t part_count) const
 {
 	assert(index_def->opts.is_unique && part_count == index_def->key_def.part_count);
 
 	struct key_data key_data;
-	key_data.key = key;
-	key_data.part_count = part_count;
-	struct tuple **res = memtx_tree_find(&tree, &key_data);
-	return res ? *res : 0;
+	memtx_tree_key_data_create<USE_HINT>(&key_data, key, part_count,
+					     index_def);
+	tree_data *res = memtx_tree_find(&tree, &key_data);
+	return res ? memtx_tree_elem_tuple(res, index_def) : 0;
 }
 
+template <bool USE_HINT>
+void
+MemtxTreeImpl<USE_HINT>::findByKeys(const char **keys, uint32_t count,
+				    struct port *port) const
+{
+	assert(index_def->opts.is_unique);
+	struct key_data key_data[MEMTX_LOOKUP_BATCH_SIZE];
+	struct key_data *batch[MEMTX_LOOKUP_BATCH_SIZE];
+	tree_data *found[MEMTX_LOOKUP_BATCH_SIZE];
+	uint32_t part_count = index_def->key_def.part_count;
+	while (count > 0) {
+		uint32_t size = MIN(count, (uint32_t) MEMTX_LOOKUP_BATCH_SIZE);
+		for (uint32_t i = 0; i < size; i++) {
+			memtx_tree_key_data_create<USE_HINT>(&key_data[i],
+							     keys[i],
+							     part_count,
+							     index_def);
+			batch[i] = &key_data[i];
+		}
+		/* Descend the tree with all keys of the batch at once. */
+		memtx_tree_find_batch(&tree, batch, size, found);
+		for (uint32_t i = 0; i < size; i++) {
+			if (found[i] == NULL)
+				continue;
+			port_add_tuple(port, memtx_tree_elem_tuple(found[i],
+								   index_def));
+		}
+		keys += size;
+		count -= size;
+	}
+}
+
+template <bool USE_HINT>
 struct tuple *
-MemtxTree::replace(struct tuple *old_tuple, struct tuple *new_tuple,
-		   enum dup_replace_mode mode)
+MemtxTreeImpl<USE_HINT>::replace(struct tuple *old_tuple,
+				 struct tuple *new_tuple,
+				 enum dup_replace_mode mode)
 {
+	if (key_format != NULL)
+		return replaceFunctional(old_tuple, new_tuple, mode);
+
 	uint32_t errcode;
 
 	if (new_tuple) {
-		struct tuple *dup_tuple = NULL;
+		tree_data new_data =
+			memtx_tree_data_new<USE_HINT>(new_tuple, index_def);
+		tree_data dup_data;
+		dup_data.tuple = NULL;
 
 		/* Try to optimistically replace the new_tuple. */
 		int tree_res =
-		memtx_tree_insert(&tree, new_tuple, &dup_tuple);
+		memtx_tree_insert(&tree, new_data, &dup_data);
 		if (tree_res) {
-			tnt_raise(OutOfMemory, BPS_TREE_EXTENT_SIZE,
+			tnt_raise(OutOfMemory, MEMTX_EXTENT_SIZE,
 				  "MemtxTree", "replace");
 		}
 
+		struct tuple *dup_tuple = dup_data.tuple;
 		errcode = replace_check_dup(old_tuple, dup_tuple, mode);
 
 		if (errcode) {
-			memtx_tree_delete(&tree, new_tuple);
+			memtx_tree_delete(&tree, new_data);
 			if (dup_tuple)
-				memtx_tree_insert(&tree, dup_tuple, 0);
+				memtx_tree_insert(&tree, dup_data, 0);
 			struct space *sp = space_cache_find(index_def->space_id);
 			tnt_raise(ClientError, errcode, index_name(this),
 				  space_name(sp));
@@ -264,34 +548,266 @@ MemtxTree::replace(struct tuple *old_tuple, struct tuple *new_tuple,
 			return dup_tuple;
 	}
 	if (old_tuple) {
-		memtx_tree_delete(&tree, old_tuple);
+		memtx_tree_delete(&tree, memtx_tree_data_new<USE_HINT>(old_tuple,
+								       index_def));
 	}
 	return old_tuple;
 }
 
+template <bool USE_HINT>
+struct tuple *
+MemtxTreeImpl<USE_HINT>::extractKey(struct tuple *tuple) const
+{
+	assert(key_format != NULL);
+	uint32_t bsize;
+	const char *data = tuple_data_range(tuple, &bsize);
+	size_t svp = region_used(&fiber()->gc);
+	uint32_t key_size;
+	const char *key = index_extract_func_key(index_def, data,
+						 data + bsize, &key_size);
+	if (key == NULL)
+		diag_raise();
+	/* Validates the key against the index parts. */
+	struct tuple *key_tuple = memtx_tuple_new(key_format, key,
+						  key + key_size);
+	region_truncate(&fiber()->gc, svp);
+	if (key_tuple == NULL)
+		diag_raise();
+	memcpy((char *) tuple_extra(key_tuple), &tuple, sizeof(tuple));
+	return key_tuple;
+}
+
+template <bool USE_HINT>
+typename MemtxTreeImpl<USE_HINT>::tree_data *
+MemtxTreeImpl<USE_HINT>::findKeyTuple(struct tuple *tuple) const
+{
+	assert(key_format != NULL);
+	tree_iterator_t itr;
+	tree_data *data;
+	uint32_t bsize;
+	const char *tuple_data = tuple_data_range(tuple, &bsize);
+	size_t svp = region_used(&fiber()->gc);
+	uint32_t key_size;
+	const char *key = index_extract_func_key(index_def, tuple_data,
+						 tuple_data + bsize,
+						 &key_size);
+	uint32_t part_count = index_def->key_def.part_count;
+	if (key != NULL && mp_decode_array(&key) >= part_count &&
+	    key_validate_parts(index_def, key, part_count) == 0) {
+		struct key_data key_data;
+		memtx_tree_key_data_create<USE_HINT>(&key_data, key,
+						     part_count, index_def);
+		itr = memtx_tree_lower_bound(&tree, &key_data, NULL);
+		while ((data = memtx_tree_iterator_get_elem(&tree,
+							    &itr)) != NULL &&
+		       memtx_tree_compare_key(*data, &key_data,
+					      index_def) == 0) {
+			if (memtx_tree_key_tuple_base(data->tuple) == tuple)
+				goto out;
+			memtx_tree_iterator_next(&tree, &itr);
+		}
+	}
+	/*
+	 * The function failed or returned a key other than the
+	 * one the tuple was inserted with. Look the tuple up with
+	 * a full scan so as not to leave a dangling element.
+	 */
+	diag_clear(diag_get());
+	itr = memtx_tree_iterator_first(&tree);
+	while ((data = memtx_tree_iterator_get_elem(&tree, &itr)) != NULL) {
+		if (memtx_tree_key_tuple_base(data->tuple) == tuple)
+			goto out;
+		memtx_tree_iterator_next(&tree, &itr);
+	}
+out:
+	region_truncate(&fiber()->gc, svp);
+	return data;
+}
+
+/** Record a key added to or removed from a functional index. */
+static inline void
+memtx_func_key_link(struct txn_stmt *stmt, struct memtx_func_key *record,
+		    const MemtxIndex *index, struct tuple *key, bool is_new)
+{
+	record->index = index;
+	record->key = key;
+	record->is_new = is_new;
+	record->next = stmt->func_keys;
+	stmt->func_keys = record;
+}
+
+/**
+ * Pass a key tuple removed from a functional index to the
+ * statement, or drop it if there is no statement.
+ */
+static inline void
+memtx_func_key_remove(struct txn_stmt *stmt, struct memtx_func_key *removed,
+		      const MemtxIndex *index, struct tuple *key)
+{
+	if (removed == NULL) {
+		tuple_unref(key);
+		return;
+	}
+	memtx_func_key_link(stmt, removed, index, key, false);
+}
+
+/**
+ * Unlink and return the record of a key of @a tuple added to
+ * or removed from a functional index by the statement.
+ */
+static inline struct memtx_func_key *
+memtx_func_key_take(struct txn_stmt *stmt, const MemtxIndex *index,
+		    struct tuple *tuple, bool is_new)
+{
+	struct memtx_func_key **link = &stmt->func_keys;
+	while (*link != NULL && ((*link)->index != index ||
+	       (*link)->is_new != is_new ||
+	       memtx_tree_key_tuple_base((*link)->key) != tuple))
+		link = &(*link)->next;
+	struct memtx_func_key *record = *link;
+	if (record != NULL)
+		*link = record->next;
+	return record;
+}
+
+template <bool USE_HINT>
+struct tuple *
+MemtxTreeImpl<USE_HINT>::replaceFunctional(struct tuple *old_tuple,
+					   struct tuple *new_tuple,
+					   enum dup_replace_mode mode)
+{
+	/*
+	 * Allocate the records of the added and removed keys
+	 * before the tree is changed. Only DUP_INSERT of a new
+	 * tuple removes nothing.
+	 */
+	struct txn *txn = in_txn();
+	struct txn_stmt *stmt = txn != NULL ? txn_current_stmt(txn) : NULL;
+	struct memtx_func_key *added = NULL;
+	struct memtx_func_key *removed = NULL;
+	if (stmt != NULL && new_tuple != NULL) {
+		added = region_alloc_object_xc(&fiber()->gc,
+					       struct memtx_func_key);
+	}
+	if (stmt != NULL && (old_tuple != NULL || mode != DUP_INSERT)) {
+		removed = region_alloc_object_xc(&fiber()->gc,
+						 struct memtx_func_key);
+	}
+	if (new_tuple) {
+		struct tuple *new_key = extractKey(new_tuple);
+		tuple_ref(new_key);
+		tree_data new_data =
+			memtx_tree_data_new<USE_HINT>(new_key, index_def);
+		tree_data dup_data;
+		dup_data.tuple = NULL;
+
+		if (memtx_tree_insert(&tree, new_data, &dup_data) != 0) {
+			tuple_unref(new_key);
+			tnt_raise(OutOfMemory, MEMTX_EXTENT_SIZE,
+				  "MemtxTree", "replace");
+		}
+
+		struct tuple *dup_tuple = dup_data.tuple != NULL ?
+			memtx_tree_key_tuple_base(dup_data.tuple) : NULL;
+		uint32_t errcode = replace_check_dup(old_tuple, dup_tuple,
+						     mode);
+		if (errcode) {
+			memtx_tree_delete(&tree, new_data);
+			if (dup_tuple)
+				memtx_tree_insert(&tree, dup_data, 0);
+			tuple_unref(new_key);
+			struct space *sp = space_cache_find(index_def->space_id);
+			tnt_raise(ClientError, errcode, index_name(this),
+				  space_name(sp));
+		}
+		if (added != NULL)
+			memtx_func_key_link(stmt, added, this, new_key, true);
+		if (dup_tuple) {
+			/* The key tuple of the duplicate was replaced. */
+			memtx_func_key_remove(stmt, removed, this,
+					      dup_data.tuple);
+			return dup_tuple;
+		}
+	}
+	if (old_tuple) {
+		tree_data *old_data = findKeyTuple(old_tuple);
+		if (old_data != NULL) {
+			struct tuple *old_key = old_data->tuple;
+			memtx_tree_delete(&tree, *old_data);
+			memtx_func_key_remove(stmt, removed, this, old_key);
+		}
+	}
+	return old_tuple;
+}
+
+template <bool USE_HINT>
+void
+MemtxTreeImpl<USE_HINT>::rollbackReplace(struct txn_stmt *stmt,
+					 struct tuple *old_tuple,
+					 struct tuple *new_tuple)
+{
+	if (key_format == NULL)
+		return MemtxIndex::rollbackReplace(stmt, old_tuple, new_tuple);
+
+	if (new_tuple) {
+		/* Delete the key of the new tuple recorded on insert. */
+		struct memtx_func_key *added =
+			memtx_func_key_take(stmt, this, new_tuple, true);
+		assert(added != NULL);
+		if (added != NULL) {
+			memtx_tree_delete(&tree, memtx_tree_data_new<USE_HINT>(
+						added->key, index_def));
+			tuple_unref(added->key);
+		}
+	}
+	if (old_tuple == NULL)
+		return;
+	/*
+	 * Take the key of the old tuple back from the statement.
+	 * There is no record if the key was not in the index.
+	 */
+	struct memtx_func_key *removed =
+		memtx_func_key_take(stmt, this, old_tuple, false);
+	if (removed == NULL)
+		return;
+	/* The reference is passed to the tree. */
+	struct tuple *old_key = removed->key;
+	tree_data old_data = memtx_tree_data_new<USE_HINT>(old_key, index_def);
+	if (memtx_tree_insert(&tree, old_data, NULL) != 0) {
+		tuple_unref(old_key);
+		tnt_raise(OutOfMemory, MEMTX_EXTENT_SIZE,
+			  "MemtxTree", "replace");
+	}
+}
+
+template <bool USE_HINT>
 struct iterator *
-MemtxTree::allocIterator() const
+MemtxTreeImpl<USE_HINT>::allocIterator() const
 {
-	struct tree_iterator *it = (struct tree_iterator *)
-			calloc(1, sizeof(*it));
+	struct tree_iterator<USE_HINT> *it =
+		(struct tree_iterator<USE_HINT> *) calloc(1, sizeof(*it));
 	if (it == NULL) {
-		tnt_raise(OutOfMemory, sizeof(struct tree_iterator),
+		tnt_raise(OutOfMemory, sizeof(struct tree_iterator<USE_HINT>),
 			  "MemtxTree", "iterator");
 	}
 
 	it->index_def = index_def;
 	it->tree = &tree;
 	it->base.free = tree_iterator_free;
-	it->tree_iterator = memtx_tree_invalid_iterator();
+	it->tree_iterator = memtx_tree_type<USE_HINT>::invalid_iterator();
 	return (struct iterator *) it;
 }
 
+template <bool USE_HINT>
 void
-MemtxTree::initIterator(struct iterator *iterator, enum iterator_type type,
-			const char *key, uint32_t part_count) const
+MemtxTreeImpl<USE_HINT>::initIterator(struct iterator *iterator,
+				      enum iterator_type type,
+				      const char *key,
+				      uint32_t part_count) const
 {
 	assert(part_count == 0 || key != NULL);
-	struct tree_iterator *it = tree_iterator(iterator);
+	struct tree_iterator<USE_HINT> *it =
+		tree_iterator_cast<USE_HINT>(iterator);
 
 	if (part_count == 0) {
 		/*
@@ -305,13 +821,14 @@ MemtxTree::initIterator(struct iterator *iterator, enum iterator_type type,
 		type = iterator_type_is_reverse(type) ? ITER_LE : ITER_GE;
 		key = 0;
 	}
-	it->key_data.key = key;
-	it->key_data.part_count = part_count;
+	memtx_tree_key_data_create<USE_HINT>(&it->key_data, key, part_count,
+					     index_def);
 
 	bool exact = false;
 	if (key == 0) {
 		if (iterator_type_is_reverse(type))
-			it->tree_iterator = memtx_tree_invalid_iterator();
+			it->tree_iterator =
+				memtx_tree_type<USE_HINT>::invalid_iterator();
 		else
 			it->tree_iterator = memtx_tree_iterator_first(&tree);
 	} else {
@@ -332,86 +849,264 @@ MemtxTree::initIterator(struct iterator *iterator, enum iterator_type type,
 
 	switch (type) {
 	case ITER_EQ:
-		it->base.next = tree_iterator_fwd_check_next_equality;
+		it->base.next = tree_iterator_fwd_check_next_equality<USE_HINT>;
 		break;
 	case ITER_REQ:
-		it->base.next = tree_iterator_bwd_skip_one_check_next_equality;
+		it->base.next =
+			tree_iterator_bwd_skip_one_check_next_equality<USE_HINT>;
 		break;
 	case ITER_ALL:
 	case ITER_GE:
-		it->base.next = tree_iterator_fwd;
+		it->base.next = tree_iterator_fwd<USE_HINT>;
 		break;
 	case ITER_GT:
-		it->base.next = tree_iterator_fwd;
+		it->base.next = tree_iterator_fwd<USE_HINT>;
 		break;
 	case ITER_LE:
-		it->base.next = tree_iterator_bwd_skip_one;
+		it->base.next = tree_iterator_bwd_skip_one<USE_HINT>;
 		break;
 	case ITER_LT:
-		it->base.next = tree_iterator_bwd_skip_one;
+		it->base.next = tree_iterator_bwd_skip_one<USE_HINT>;
 		break;
 	default:
 		return Index::initIterator(iterator, type, key, part_count);
 	}
 }
 
+template <bool USE_HINT>
+size_t
+MemtxTreeImpl<USE_HINT>::count(enum iterator_type type, const char *key,
+			       uint32_t part_count) const
+{
+	if (part_count == 0 && type >= 0 && type <= ITER_GT)
+		return memtx_tree_size(&tree);
+	if (part_count == 0)
+		return MemtxIndex::count(type, key, part_count);
+
+	struct key_data key_data;
+	memtx_tree_key_data_create<USE_HINT>(&key_data, key, part_count,
+					     index_def);
+	size_t lower = 0, upper = 0;
+	switch (type) {
+	case ITER_EQ:
+	case ITER_REQ:
+		memtx_tree_lower_bound_get_offset(&tree, &key_data,
+						  NULL, &lower);
+		memtx_tree_upper_bound_get_offset(&tree, &key_data,
+						  NULL, &upper);
+		return upper - lower;
+	case ITER_ALL:
+	case ITER_GE:
+		memtx_tree_lower_bound_get_offset(&tree, &key_data,
+						  NULL, &lower);
+		return memtx_tree_size(&tree) - lower;
+	case ITER_GT:
+		memtx_tree_upper_bound_get_offset(&tree, &key_data,
+						  NULL, &upper);
+		return memtx_tree_size(&tree) - upper;
+	case ITER_LT:
+		memtx_tree_lower_bound_get_offset(&tree, &key_data,
+						  NULL, &lower);
+		return lower;
+	case ITER_LE:
+		memtx_tree_upper_bound_get_offset(&tree, &key_data,
+						  NULL, &upper);
+		return upper;
+	default:
+		return MemtxIndex::count(type, key, part_count);
+	}
+}
+
+template <bool USE_HINT>
+uint32_t
+MemtxTreeImpl<USE_HINT>::skipIterator(struct iterator *iterator,
+				      uint32_t offset) const
+{
+	struct tree_iterator<USE_HINT> *it =
+		tree_iterator_cast<USE_HINT>(iterator);
+	/*
+	 * The iterator is positioned at the bound found by
+	 * initIterator(). Forward iterators return tuples
+	 * starting from the bound, reverse ones - starting
+	 * from the tuple preceding it.
+	 */
+	size_t pos = memtx_tree_iterator_get_offset(&tree, &it->tree_iterator);
+	size_t avail;
+	bool reverse = false;
+	if (iterator->next == tree_iterator_fwd<USE_HINT>) {
+		avail = memtx_tree_size(&tree) - pos;
+	} else if (iterator->next ==
+		   tree_iterator_fwd_check_next_equality<USE_HINT>) {
+		size_t upper;
+		memtx_tree_upper_bound_get_offset(&tree, &it->key_data,
+						  NULL, &upper);
+		avail = upper - pos;
+		iterator->next = tree_iterator_fwd_check_equality<USE_HINT>;
+	} else if (iterator->next == tree_iterator_bwd_skip_one<USE_HINT>) {
+		avail = pos;
+		reverse = true;
+	} else if (iterator->next ==
+		   tree_iterator_bwd_skip_one_check_next_equality<USE_HINT>) {
+		size_t lower;
+		memtx_tree_lower_bound_get_offset(&tree, &it->key_data,
+						  NULL, &lower);
+		avail = pos - lower;
+		reverse = true;
+	} else {
+		return MemtxIndex::skipIterator(iterator, offset);
+	}
+	if (offset >= avail) {
+		iterator->next = tree_iterator_dummie;
+		return avail;
+	}
+	if (reverse)
+		pos -= offset;
+	else
+		pos += offset;
+	it->tree_iterator = memtx_tree_iterator_at(&tree, pos);
+	return offset;
+}
+
+template <bool USE_HINT>
 void
-MemtxTree::beginBuild()
+MemtxTreeImpl<USE_HINT>::beginBuild()
 {
 	assert(memtx_tree_size(&tree) == 0);
+	build_array_is_sorted = true;
 }
 
+template <bool USE_HINT>
 void
-MemtxTree::reserve(uint32_t size_hint)
+MemtxTreeImpl<USE_HINT>::reserve(uint32_t size_hint)
 {
 	if (size_hint < build_array_alloc_size)
 		return;
-	build_array = (struct tuple**)
-		realloc(build_array, size_hint * sizeof(struct tuple *));
+	build_array = (tree_data *)
+		realloc(build_array, size_hint * sizeof(tree_data));
 	build_array_alloc_size = size_hint;
 }
 
+template <bool USE_HINT>
 void
-MemtxTree::buildNext(struct tuple *tuple)
+MemtxTreeImpl<USE_HINT>::buildNext(struct tuple *tuple)
 {
 	if (!build_array) {
-		build_array = (struct tuple**)malloc(BPS_TREE_EXTENT_SIZE);
-		build_array_alloc_size =
-			BPS_TREE_EXTENT_SIZE / sizeof(struct tuple*);
+		build_array = (tree_data *) malloc(MEMTX_EXTENT_SIZE);
+		build_array_alloc_size = MEMTX_EXTENT_SIZE / sizeof(tree_data);
 	}
 	assert(build_array_size <= build_array_alloc_size);
 	if (build_array_size == build_array_alloc_size) {
 		build_array_alloc_size = build_array_alloc_size +
 					 build_array_alloc_size / 2;
-		build_array = (struct tuple**)
+		build_array = (tree_data *)
 			realloc(build_array,
-				build_array_alloc_size *
-				sizeof(struct tuple *));
+				build_array_alloc_size * sizeof(tree_data));
+	}
+	if (key_format != NULL) {
+		tuple = extractKey(tuple);
+		tuple_ref(tuple);
 	}
-	build_array[build_array_size++] = tuple;
+	/*
+	 * Tuples usually come in order when the primary key is
+	 * recovered from a snapshot, because the snapshot is
+	 * written by iterating over the primary key. Check it
+	 * so as not to sort the array in endBuild(). Stop
+	 * checking once an out-of-order tuple is met.
+	 */
+	tree_data data = memtx_tree_data_new<USE_HINT>(tuple, index_def);
+	if (build_array_is_sorted && build_array_size > 0 &&
+	    memtx_tree_compare(build_array[build_array_size - 1], data,
+			       index_def) > 0)
+		build_array_is_sorted = false;
+	build_array[build_array_size++] = data;
 }
 
+template <bool USE_HINT>
 void
-MemtxTree::endBuild()
+MemtxTreeImpl<USE_HINT>::sortBuild()
 {
-	qsort_arg(build_array, build_array_size, sizeof(struct tuple *), memtx_tree_qcompare, index_def);
-	memtx_tree_build(&tree, build_array, build_array_size);
+	if (build_array_is_sorted)
+		return;
+	qsort_arg(build_array, build_array_size, sizeof(tree_data),
+		  memtx_tree_qcompare<USE_HINT>, index_def);
+	build_array_is_sorted = true;
+}
+
+template <bool USE_HINT>
+void
+MemtxTreeImpl<USE_HINT>::checkBuildUnique()
+{
+	assert(build_array_is_sorted);
+	for (size_t i = 1; i < build_array_size; i++) {
+		if (tuple_compare(build_array[i - 1].tuple,
+				  build_array[i].tuple,
+				  &index_def->key_def) == 0) {
+			struct space *sp = space_cache_find(index_def->space_id);
+			tnt_raise(ClientError, ER_TUPLE_FOUND,
+				  index_name(this), space_name(sp));
+		}
+	}
+}
+
+template <bool USE_HINT>
+void
+MemtxTreeImpl<USE_HINT>::endBuild()
+{
+	sortBuild();
+	if (memtx_tree_build(&tree, build_array, build_array_size) != 0)
+		tnt_raise(OutOfMemory, MEMTX_EXTENT_SIZE,
+			  "MemtxTree", "build");
 
 	free(build_array);
 	build_array = 0;
 	build_array_size = 0;
 	build_array_alloc_size = 0;
+	build_array_is_sorted = false;
 }
 
 /**
  * Create a read view for iterator so further index modifications
  * will not affect the iterator iteration.
  */
+template <bool USE_HINT>
 void
-MemtxTree::createReadViewForIterator(struct iterator *iterator)
+MemtxTreeImpl<USE_HINT>::createReadViewForIterator(struct iterator *iterator)
 {
-	struct tree_iterator *it = tree_iterator(iterator);
-	struct memtx_tree *tree = (struct memtx_tree *)it->tree;
+	struct tree_iterator<USE_HINT> *it =
+		tree_iterator_cast<USE_HINT>(iterator);
+	/*
+	 * Tuples deleted after the read view is created are
+	 * freed with smfree_delayed(), which overwrites their
+	 * format id, see memtx_tuple_delete(). So a read view
+	 * must not look at anything but the tuple data: it
+	 * can't compare tuples with the key and it can't find
+	 * the indexed tuple of a key tuple.
+	 */
+	if (key_format != NULL)
+		tnt_raise(UnsupportedIndexFeature, this,
+			  "consistent read view");
+	tree_t *tree = (tree_t *)it->tree;
+	/*
+	 * Bound equality iterators by the number of matching
+	 * elements instead, counted before the tree is frozen.
+	 */
+	if (iterator->next ==
+	    tree_iterator_fwd_check_next_equality<USE_HINT> ||
+	    iterator->next ==
+	    tree_iterator_bwd_skip_one_check_next_equality<USE_HINT>) {
+		size_t lower, upper;
+		memtx_tree_lower_bound_get_offset(tree, &it->key_data,
+						  NULL, &lower);
+		memtx_tree_upper_bound_get_offset(tree, &it->key_data,
+						  NULL, &upper);
+		it->count = upper - lower;
+		if (iterator->next ==
+		    tree_iterator_fwd_check_next_equality<USE_HINT>)
+			iterator->next = tree_iterator_fwd_bounded<USE_HINT>;
+		else
+			iterator->next =
+				tree_iterator_bwd_skip_one_bounded<USE_HINT>;
+	}
 	memtx_tree_iterator_freeze(tree, &it->tree_iterator);
 }
 
@@ -419,10 +1114,25 @@ MemtxTree::createReadViewForIterator(struct iterator *iterator)
  * Destroy a read view of an iterator. Must be called for iterators,
  * for which createReadViewForIterator was called.
  */
+template <bool USE_HINT>
 void
-MemtxTree::destroyReadViewForIterator(struct iterator *iterator)
+MemtxTreeImpl<USE_HINT>::destroyReadViewForIterator(struct iterator *iterator)
 {
-	struct tree_iterator *it = tree_iterator(iterator);
-	struct memtx_tree *tree = (struct memtx_tree *)it->tree;
+	struct tree_iterator<USE_HINT> *it =
+		tree_iterator_cast<USE_HINT>(iterator);
+	tree_t *tree = (tree_t *)it->tree;
 	memtx_tree_iterator_destroy(tree, &it->tree_iterator);
 }
+
+template class MemtxTreeImpl<true>;
+template class MemtxTreeImpl<false>;
+
+MemtxTree *
+memtx_tree_new(struct index_def *index_def)
+{
+	enum field_type type =
+		(enum field_type) index_def->key_def.parts[0].type;
+	if (index_def->opts.hint && memtx_tree_type_has_hint(type))
+		return new MemtxTreeImpl<true>(index_def);
+	return new MemtxTreeImpl<false>(index_def);
+}
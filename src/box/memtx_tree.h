@@ -37,39 +37,207 @@
 struct tuple;
 struct key_data;
 
+/**
+ * Element of a memtx tree: a tuple along with a comparison hint.
+ * The hint is a 64-bit integer derived from the first key part
+ * so that comparing hints of two tuples gives the same result
+ * as comparing the tuples unless the hints are equal, see
+ * memtx_tree_hint(). This allows to skip dereferencing tuples
+ * and decoding MsgPack for most comparisons done on tree descent.
+ *
+ * A hint costs 8 bytes per element, so it is stored only if
+ * the index has the hint option set and the first key part is
+ * of a type that has hints, see memtx_tree_new(). Otherwise
+ * memtx_tree_data<false> is used, which is just a tuple pointer.
+ *
+ * In a functional index the element holds a key tuple instead,
+ * see MemtxTreeImpl::extractKey().
+ */
+template <bool USE_HINT>
+struct memtx_tree_data;
+
+template <>
+struct memtx_tree_data<true> {
+	struct tuple *tuple;
+	uint64_t hint;
+};
+
+template <>
+struct memtx_tree_data<false> {
+	struct tuple *tuple;
+	/** Hints are not stored, all of them are equal. */
+	static const uint64_t hint = 0;
+};
+
+template <bool USE_HINT>
+static inline bool
+operator==(const memtx_tree_data<USE_HINT> &a,
+	   const memtx_tree_data<USE_HINT> &b)
+{
+	return a.tuple == b.tuple;
+}
+
+template <bool USE_HINT>
+static inline bool
+operator!=(const memtx_tree_data<USE_HINT> &a,
+	   const memtx_tree_data<USE_HINT> &b)
+{
+	return a.tuple != b.tuple;
+}
+
+/** Return the comparison hint of a tuple. */
+uint64_t
+memtx_tree_hint(const struct tuple *tuple, struct index_def *index_def);
+
+template <bool USE_HINT>
 int
-memtx_tree_compare(const struct tuple *a, const struct tuple *b, struct index_def *index_def);
+memtx_tree_compare(const memtx_tree_data<USE_HINT> a,
+		   const memtx_tree_data<USE_HINT> b,
+		   struct index_def *index_def);
 
+template <bool USE_HINT>
 int
-memtx_tree_compare_key(const tuple *a, const key_data *b, struct index_def *index_def);
+memtx_tree_compare_key(const memtx_tree_data<USE_HINT> a,
+		       const key_data *b, struct index_def *index_def);
+
+/*
+ * The tree is instantiated twice, for elements with and without
+ * hints. Each instance lives in its own namespace so that both
+ * have the same API names and MemtxTreeImpl can call them
+ * regardless of the element type.
+ */
+#include <string.h>
+#include <stdint.h>
+#include <assert.h>
+#include <stdio.h>
+#include "small/matras.h"
 
 #define BPS_TREE_NAME memtx_tree
 #define BPS_TREE_BLOCK_SIZE (512)
 #define BPS_TREE_EXTENT_SIZE MEMTX_EXTENT_SIZE
 #define BPS_TREE_COMPARE(a, b, arg) memtx_tree_compare(a, b, arg)
 #define BPS_TREE_COMPARE_KEY(a, b, arg) memtx_tree_compare_key(a, b, arg)
-#define bps_tree_elem_t struct tuple *
 #define bps_tree_key_t struct key_data *
 #define bps_tree_arg_t struct index_def *
+#define BPS_INNER_CHILD_CARDS
+
+namespace memtx_hint_tree {
+#define bps_tree_elem_t memtx_tree_data<true>
+#include "salad/bps_tree.h"
+#undef bps_tree_elem_t
+} /* namespace memtx_hint_tree */
 
+namespace memtx_plain_tree {
+#define bps_tree_elem_t memtx_tree_data<false>
 #include "salad/bps_tree.h"
+#undef bps_tree_elem_t
+} /* namespace memtx_plain_tree */
+
+#undef BPS_TREE_NAME
+#undef BPS_TREE_BLOCK_SIZE
+#undef BPS_TREE_EXTENT_SIZE
+#undef BPS_TREE_COMPARE
+#undef BPS_TREE_COMPARE_KEY
+#undef bps_tree_key_t
+#undef bps_tree_arg_t
+#undef BPS_INNER_CHILD_CARDS
+
+/** Tree types for elements with and without hints. */
+template <bool USE_HINT>
+struct memtx_tree_type;
 
+template <>
+struct memtx_tree_type<true> {
+	typedef struct memtx_hint_tree::memtx_tree tree;
+	typedef struct memtx_hint_tree::memtx_tree_iterator iterator;
+	static iterator invalid_iterator()
+	{
+		return memtx_hint_tree::memtx_tree_invalid_iterator();
+	}
+};
+
+template <>
+struct memtx_tree_type<false> {
+	typedef struct memtx_plain_tree::memtx_tree tree;
+	typedef struct memtx_plain_tree::memtx_tree_iterator iterator;
+	static iterator invalid_iterator()
+	{
+		return memtx_plain_tree::memtx_tree_invalid_iterator();
+	}
+};
+
+/**
+ * TREE index. The implementation is MemtxTreeImpl, created
+ * with memtx_tree_new().
+ */
 class MemtxTree: public MemtxIndex {
 public:
-	MemtxTree(struct index_def *index_def);
-	virtual ~MemtxTree() override;
+	MemtxTree(struct index_def *index_def)
+		: MemtxIndex(index_def) {}
+	/**
+	 * Sort tuples accumulated with buildNext(). The function
+	 * only reads the tuples and reorders the build array, so
+	 * it may be called from any thread between the last
+	 * buildNext() and endBuild(), in which case endBuild()
+	 * skips sorting.
+	 */
+	virtual void sortBuild() = 0;
+	/**
+	 * Raise ER_TUPLE_FOUND if the build array contains tuples
+	 * with equal keys. Must be called after sortBuild().
+	 */
+	virtual void checkBuildUnique() = 0;
+};
+
+/**
+ * Create a TREE index. The index stores comparison hints
+ * if the hint option is set and the first key part has
+ * a type with hints.
+ */
+MemtxTree *
+memtx_tree_new(struct index_def *index_def);
+
+template <bool USE_HINT>
+class MemtxTreeImpl: public MemtxTree {
+public:
+	typedef memtx_tree_data<USE_HINT> tree_data;
+	typedef typename memtx_tree_type<USE_HINT>::tree tree_t;
+	typedef typename memtx_tree_type<USE_HINT>::iterator tree_iterator_t;
+
+	MemtxTreeImpl(struct index_def *index_def);
+	virtual ~MemtxTreeImpl() override;
 
 	virtual void beginBuild() override;
 	virtual void reserve(uint32_t size_hint) override;
 	virtual void buildNext(struct tuple *tuple) override;
 	virtual void endBuild() override;
+	virtual void sortBuild() override;
+	virtual void checkBuildUnique() override;
 	virtual size_t size() const override;
 	virtual struct tuple *random(uint32_t rnd) const override;
 	virtual struct tuple *findByKey(const char *key,
 					uint32_t part_count) const override;
+	virtual void findByKeys(const char **keys, uint32_t count,
+				struct port *port) const override;
 	virtual struct tuple *replace(struct tuple *old_tuple,
 				      struct tuple *new_tuple,
 				      enum dup_replace_mode mode) override;
+	/**
+	 * A functional index puts back the key kept by the
+	 * statement, see replaceFunctional().
+	 */
+	virtual void rollbackReplace(struct txn_stmt *stmt,
+				     struct tuple *old_tuple,
+				     struct tuple *new_tuple) override;
+	/**
+	 * Count tuples in O(log n) using subtree cardinalities
+	 * stored in inner blocks of the tree.
+	 */
+	virtual size_t count(enum iterator_type type, const char *key,
+			     uint32_t part_count) const override;
+	/** Position the iterator by offset in O(log n). */
+	virtual uint32_t skipIterator(struct iterator *it,
+				      uint32_t offset) const override;
 
 	virtual size_t bsize() const override;
 	virtual struct iterator *allocIterator() const override;
@@ -89,10 +257,43 @@ public:
 	 */
 	virtual void destroyReadViewForIterator(struct iterator *iterator) override;
 
+	/**
+	 * Compute the key of a tuple in a functional index and
+	 * store it in a new key tuple, which is what the tree
+	 * holds instead of the tuple itself. The key tuple has
+	 * key_format and keeps a pointer to the tuple in its
+	 * extra data, see memtx_tree_key_tuple_base().
+	 * The key tuple is not referenced.
+	 */
+	struct tuple *extractKey(struct tuple *tuple) const;
+	/**
+	 * replace() for a functional index. The key of the
+	 * removed tuple is passed to the current statement, if
+	 * any, and kept until the statement is committed or
+	 * rolled back.
+	 */
+	struct tuple *replaceFunctional(struct tuple *old_tuple,
+					struct tuple *new_tuple,
+					enum dup_replace_mode mode);
+	/** Find the element referring to a tuple in a functional index. */
+	tree_data *findKeyTuple(struct tuple *tuple) const;
+
 // protected:
-	struct memtx_tree tree;
-	struct tuple **build_array;
+	tree_t tree;
+	tree_data *build_array;
 	size_t build_array_size, build_array_alloc_size;
+	/**
+	 * Set if the build array is known to be sorted, either
+	 * because tuples were added in order or because it was
+	 * sorted with sortBuild().
+	 */
+	bool build_array_is_sorted;
+	/**
+	 * Format of key tuples of a functional index, NULL for
+	 * a regular index. Fields of a key tuple are parts of
+	 * the key computed by the index function.
+	 */
+	struct tuple_format *key_format;
 };
 
 #endif /* TARANTOOL_BOX_MEMTX_TREE_H_INCLUDED */
@@ -31,6 +31,13 @@
 
 #include "memtx_tuple.h"
 
+#include <limits.h>
+#include <sys/mman.h>
+#if defined(__linux__)
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif /* defined(__linux__) */
+
 #include "small/small.h"
 #include "small/region.h"
 #include "small/quota.h"
@@ -59,6 +66,17 @@ static struct quota memtx_quota;
 struct small_alloc memtx_alloc; /* used box box.slab.info() */
 
 uint32_t snapshot_version;
+/** Number of open snapshots: a checkpoint and user read views. */
+static uint32_t snapshot_count;
+/** Size of tuples deleted while a snapshot was open. */
+static size_t snapshot_pinned_size;
+
+const char *memtx_huge_pages_strs[] = { "none", "madvise", "hugetlb" };
+
+/** Huge pages mode of the memtx arena. */
+static enum memtx_huge_pages arena_huge_pages = MEMTX_HUGE_PAGES_NONE;
+/** NUMA node the memtx arena is bound to. */
+static int arena_numa_node = -1;
 
 enum {
 	/** Lowest allowed slab_alloc_minimal */
@@ -66,12 +84,42 @@ enum {
 	/** Lowest allowed slab_alloc_maximal */
 	OBJSIZE_MAX_MIN = 16 * 1024,
 	/** Lowest allowed slab size, for mmapped slabs */
-	SLAB_SIZE_MIN = 1024 * 1024
+	SLAB_SIZE_MIN = 1024 * 1024,
+	/** Size of a huge page on x86_64 and aarch64 */
+	HUGE_PAGE_SIZE = 2 * 1024 * 1024,
+	/** Max NUMA node the arena can be bound to */
+	NUMA_NODE_MAX = sizeof(unsigned long) * CHAR_BIT - 1
 };
 
+/**
+ * Bind the preallocated memtx arena to a NUMA node. Pages are
+ * not touched yet, so the policy applies to all of them.
+ */
+static int
+memtx_arena_bind(int numa_node)
+{
+#if defined(__linux__) && defined(SYS_mbind)
+	enum { MPOL_BIND_MODE = 2 };
+	if (numa_node > NUMA_NODE_MAX) {
+		errno = EINVAL;
+		return -1;
+	}
+	unsigned long nodemask = 1UL << numa_node;
+	/* The kernel ignores the last bit of maxnode. */
+	unsigned long maxnode = sizeof(nodemask) * CHAR_BIT + 1;
+	return syscall(SYS_mbind, memtx_arena.arena, memtx_arena.prealloc,
+		       MPOL_BIND_MODE, &nodemask, maxnode, 0);
+#else
+	(void) numa_node;
+	errno = ENOTSUP;
+	return -1;
+#endif
+}
+
 void
 memtx_tuple_init(uint64_t tuple_arena_max_size, uint32_t objsize_min,
-		 uint32_t objsize_max, float alloc_factor)
+		 uint32_t objsize_max, float alloc_factor,
+		 bool huge_pages, int numa_node)
 {
 	/* Apply lowest allowed objsize bounds */
 	if (objsize_min < OBJSIZE_MIN)
@@ -83,6 +131,12 @@ memtx_tuple_init(uint64_t tuple_arena_max_size, uint32_t objsize_min,
 	size_t slab_size = small_round(objsize_max * 4);
 	if (slab_size < SLAB_SIZE_MIN)
 		slab_size = SLAB_SIZE_MIN;
+	/*
+	 * Slabs must consist of whole huge pages, otherwise
+	 * a MAP_HUGETLB mapping can't be aligned and trimmed.
+	 */
+	if (huge_pages && slab_size < HUGE_PAGE_SIZE)
+		slab_size = HUGE_PAGE_SIZE;
 
 	/*
 	 * Ensure that quota is a multiple of slab_size, to
@@ -94,7 +148,20 @@ memtx_tuple_init(uint64_t tuple_arena_max_size, uint32_t objsize_min,
 
 	say_info("mapping %zu bytes for tuple arena...", prealloc);
 
-	if (slab_arena_create(&memtx_arena, &memtx_quota,
+	arena_huge_pages = MEMTX_HUGE_PAGES_NONE;
+#if defined(MAP_HUGETLB)
+	if (huge_pages) {
+		if (slab_arena_create(&memtx_arena, &memtx_quota, prealloc,
+				      slab_size, MAP_PRIVATE | MAP_HUGETLB) == 0)
+			arena_huge_pages = MEMTX_HUGE_PAGES_HUGETLB;
+		else
+			say_syserror("failed to map tuple arena with "
+				     "MAP_HUGETLB, falling back to "
+				     "transparent huge pages");
+	}
+#endif /* defined(MAP_HUGETLB) */
+	if (arena_huge_pages == MEMTX_HUGE_PAGES_NONE &&
+	    slab_arena_create(&memtx_arena, &memtx_quota,
 			      prealloc, slab_size, MAP_PRIVATE)) {
 		if (ENOMEM == errno) {
 			panic("failed to preallocate %zu bytes: "
@@ -106,6 +173,33 @@ memtx_tuple_init(uint64_t tuple_arena_max_size, uint32_t objsize_min,
 				       prealloc);
 		}
 	}
+	if (huge_pages && arena_huge_pages == MEMTX_HUGE_PAGES_NONE) {
+#if defined(MADV_HUGEPAGE)
+		if (madvise(memtx_arena.arena, memtx_arena.prealloc,
+			    MADV_HUGEPAGE) == 0)
+			arena_huge_pages = MEMTX_HUGE_PAGES_MADVISE;
+		else
+			say_syserror("failed to enable transparent huge "
+				     "pages for tuple arena");
+#else
+		say_warn("huge pages are not supported on this platform");
+#endif /* defined(MADV_HUGEPAGE) */
+	}
+	say_info("tuple arena huge pages: %s",
+		 memtx_huge_pages_strs[arena_huge_pages]);
+
+	arena_numa_node = -1;
+	if (numa_node >= 0) {
+		if (memtx_arena_bind(numa_node) == 0) {
+			arena_numa_node = numa_node;
+			say_info("tuple arena is bound to NUMA node %d",
+				 numa_node);
+		} else {
+			say_syserror("failed to bind tuple arena to "
+				     "NUMA node %d", numa_node);
+		}
+	}
+
 	slab_cache_create(&memtx_slab_cache, &memtx_arena);
 	small_alloc_create(&memtx_alloc, &memtx_slab_cache,
 			   objsize_min, alloc_factor);
@@ -116,6 +210,18 @@ memtx_tuple_free(void)
 {
 }
 
+enum memtx_huge_pages
+memtx_tuple_arena_huge_pages(void)
+{
+	return arena_huge_pages;
+}
+
+int
+memtx_tuple_arena_numa_node(void)
+{
+	return arena_numa_node;
+}
+
 struct tuple_format_vtab memtx_tuple_format_vtab = {
 	memtx_tuple_delete,
 };
@@ -188,23 +294,104 @@ memtx_tuple_delete(struct tuple_format *format, struct tuple *tuple)
 	struct memtx_tuple *memtx_tuple =
 		container_of(tuple, struct memtx_tuple, base);
 	if (!memtx_alloc.is_delayed_free_mode ||
-	    memtx_tuple->version == snapshot_version)
+	    memtx_tuple->version == snapshot_version) {
 		smfree(&memtx_alloc, memtx_tuple, total);
-	else
+	} else {
 		smfree_delayed(&memtx_alloc, memtx_tuple, total);
+		snapshot_pinned_size += total;
+	}
+}
+
+bool
+memtx_tuple_is_mutable(struct tuple *tuple)
+{
+	struct memtx_tuple *memtx_tuple =
+		container_of(tuple, struct memtx_tuple, base);
+	/*
+	 * A tuple created before the snapshot was started may
+	 * be read by the snapshot thread, see memtx_tuple_delete().
+	 */
+	return tuple->refs == 1 &&
+	       (!memtx_alloc.is_delayed_free_mode ||
+		memtx_tuple->version == snapshot_version);
+}
+
+void *
+memtx_tuple_update_in_place(struct tuple_format *format, struct tuple *tuple,
+			    const char *data, const char *end)
+{
+	assert(mp_typeof(*data) == MP_ARRAY);
+	assert((size_t)(end - data) == tuple->bsize);
+	(void) end;
+	uint16_t map_size = format->field_map_size;
+	size_t size = map_size + tuple->bsize;
+	/*
+	 * The buffer holds the new field map followed by the
+	 * undo record. The new field map is built aside, so that
+	 * the tuple stays intact if the new data doesn't match
+	 * the format.
+	 */
+	char *buf = (char *) region_aligned_alloc(&fiber()->gc,
+						  map_size + size,
+						  alignof(uint32_t));
+	if (buf == NULL) {
+		diag_set(OutOfMemory, map_size + size, "region",
+			 "tuple undo");
+		return NULL;
+	}
+	uint32_t *field_map = (uint32_t *) (buf + map_size);
+	char *undo = buf + map_size;
+	if (tuple_init_field_map(format, field_map, data) != 0)
+		return NULL;
+
+	char *raw = (char *) tuple_data(tuple) - map_size;
+	memcpy(undo, raw, size);
+	memcpy(raw, buf, map_size);
+	memcpy(raw + map_size, data, tuple->bsize);
+	return undo;
+}
+
+void
+memtx_tuple_rollback_update(struct tuple_format *format, struct tuple *tuple,
+			    void *undo)
+{
+	char *raw = (char *) tuple_data(tuple) - format->field_map_size;
+	memcpy(raw, undo, format->field_map_size + tuple->bsize);
 }
 
 void
 memtx_tuple_begin_snapshot()
 {
+	/*
+	 * Tuples created before this point may be seen by any
+	 * open snapshot, so keep them all until the last one
+	 * is closed.
+	 */
 	snapshot_version++;
-	small_alloc_setopt(&memtx_alloc, SMALL_DELAYED_FREE_MODE, true);
+	if (snapshot_count++ == 0)
+		small_alloc_setopt(&memtx_alloc, SMALL_DELAYED_FREE_MODE, true);
 }
 
 void
 memtx_tuple_end_snapshot()
 {
+	assert(snapshot_count > 0);
+	if (--snapshot_count > 0)
+		return;
 	small_alloc_setopt(&memtx_alloc, SMALL_DELAYED_FREE_MODE, false);
+	snapshot_pinned_size = 0;
+}
+
+uint32_t
+memtx_tuple_snapshot_count(void)
+{
+	return snapshot_count;
+}
+
+size_t
+memtx_tuple_snapshot_pinned_size(void)
+{
+	return snapshot_pinned_size;
 }
 
 box_tuple_t *
@@ -39,12 +39,43 @@
 extern "C" {
 #endif /* defined(__cplusplus) */
 
+/** How the memtx arena is backed by huge pages. */
+enum memtx_huge_pages {
+	/** Regular pages. */
+	MEMTX_HUGE_PAGES_NONE,
+	/** Transparent huge pages requested with madvise(). */
+	MEMTX_HUGE_PAGES_MADVISE,
+	/** Explicit huge pages mapped with MAP_HUGETLB. */
+	MEMTX_HUGE_PAGES_HUGETLB,
+	memtx_huge_pages_MAX
+};
+
+extern const char *memtx_huge_pages_strs[];
+
 /**
  * Initialize memtx_tuple library
+ *
+ * @param huge_pages   try to back the arena with huge pages:
+ *                     MAP_HUGETLB first, transparent huge pages
+ *                     if the former is not available.
+ * @param numa_node    NUMA node to bind the arena memory to,
+ *                     -1 to leave the default policy.
  */
 void
 memtx_tuple_init(uint64_t tuple_arena_max_size, uint32_t objsize_min,
-		 uint32_t objsize_max, float alloc_factor);
+		 uint32_t objsize_max, float alloc_factor,
+		 bool huge_pages, int numa_node);
+
+/** Huge pages mode the memtx arena actually got. */
+enum memtx_huge_pages
+memtx_tuple_arena_huge_pages(void);
+
+/**
+ * NUMA node the memtx arena is bound to, -1 if it is not
+ * bound.
+ */
+int
+memtx_tuple_arena_numa_node(void);
 
 /**
  * Cleanup memtx_tuple library
@@ -66,12 +97,54 @@ memtx_tuple_delete(struct tuple_format *format, struct tuple *tuple);
 /** tuple format vtab for memtx engine. */
 extern struct tuple_format_vtab memtx_tuple_format_vtab;
 
+/**
+ * Check if a memtx tuple may be modified in place: it is
+ * referenced only by the space and it is not part of a
+ * snapshot which is being written.
+ */
+bool
+memtx_tuple_is_mutable(struct tuple *tuple);
+
+/**
+ * Overwrite the data of a memtx tuple with new data of the same
+ * size and rebuild its field map. The old field map and data are
+ * saved on the fiber region to allow rolling the change back with
+ * memtx_tuple_rollback_update().
+ *
+ * @retval not NULL undo record.
+ * @retval NULL     memory or format error, diag is set.
+ */
+void *
+memtx_tuple_update_in_place(struct tuple_format *format, struct tuple *tuple,
+			    const char *data, const char *end);
+
+/**
+ * Restore the field map and data of a tuple modified by
+ * memtx_tuple_update_in_place().
+ */
+void
+memtx_tuple_rollback_update(struct tuple_format *format, struct tuple *tuple,
+			    void *undo);
+
+/**
+ * Open a snapshot of memtx tuples: tuples deleted from now on
+ * are not freed until all open snapshots are closed with
+ * memtx_tuple_end_snapshot(). Snapshots may nest.
+ */
 void
 memtx_tuple_begin_snapshot();
 
 void
 memtx_tuple_end_snapshot();
 
+/** Number of open snapshots (a checkpoint and read views). */
+uint32_t
+memtx_tuple_snapshot_count(void);
+
+/** Size of deleted tuples kept for open snapshots, in bytes. */
+size_t
+memtx_tuple_snapshot_pinned_size(void);
+
 /** \cond public */
 
 /**
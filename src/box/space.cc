@@ -124,14 +124,24 @@ space_new(struct space_def *def, struct rlist *key_list)
 						  sizeof(*keys) * index_count);
 	uint32_t key_no = 0;
 	rlist_foreach_entry(index_def, key_list, link) {
+		/*
+		 * Parts of a functional index don't refer to
+		 * tuple fields, so they don't restrict the format.
+		 */
+		if (index_def_is_functional(index_def))
+			continue;
 		keys[key_no++] = &index_def->key_def;
 	}
-	space->format = tuple_format_new(engine->format, keys, index_count, 0);
+	space->format = tuple_format_new(engine->format, keys, key_no, 0);
 	if (space->format == NULL)
 		diag_raise();
 	space->has_unique_secondary_key = has_unique_secondary_key;
 	tuple_format_ref(space->format, 1);
 	space->format->exact_field_count = def->exact_field_count;
+	if (def->opts.field_map > 0 &&
+	    tuple_format_set_field_map(space->format, def->opts.field_map,
+				       def->opts.field_map_step) != 0)
+		diag_raise();
 	space->index_id_max = index_id_max;
 	/* init space engine instance */
 	space->handler = engine->open();
@@ -477,6 +477,27 @@ field_compare<FIELD_TYPE_STRING>(const char **field_a, const char **field_b)
 	return r;
 }
 
+template <>
+inline int
+field_compare<FIELD_TYPE_INTEGER>(const char **field_a, const char **field_b)
+{
+	return mp_compare_integer(*field_a, *field_b);
+}
+
+template <>
+inline int
+field_compare<FIELD_TYPE_NUMBER>(const char **field_a, const char **field_b)
+{
+	return mp_compare_number(*field_a, *field_b);
+}
+
+template <>
+inline int
+field_compare<FIELD_TYPE_SCALAR>(const char **field_a, const char **field_b)
+{
+	return mp_compare_scalar(*field_a, *field_b);
+}
+
 template <int TYPE>
 static inline int
 field_compare_and_next(const char **field_a, const char **field_b);
@@ -508,6 +529,39 @@ field_compare_and_next<FIELD_TYPE_STRING>(const char **field_a,
 	return r;
 }
 
+template <>
+inline int
+field_compare_and_next<FIELD_TYPE_INTEGER>(const char **field_a,
+					    const char **field_b)
+{
+	int r = mp_compare_integer(*field_a, *field_b);
+	mp_next(field_a);
+	mp_next(field_b);
+	return r;
+}
+
+template <>
+inline int
+field_compare_and_next<FIELD_TYPE_NUMBER>(const char **field_a,
+					   const char **field_b)
+{
+	int r = mp_compare_number(*field_a, *field_b);
+	mp_next(field_a);
+	mp_next(field_b);
+	return r;
+}
+
+template <>
+inline int
+field_compare_and_next<FIELD_TYPE_SCALAR>(const char **field_a,
+					   const char **field_b)
+{
+	int r = mp_compare_scalar(*field_a, *field_b);
+	mp_next(field_a);
+	mp_next(field_b);
+	return r;
+}
+
 /* Tuple comparator */
 namespace /* local symbols */ {
 
@@ -601,6 +655,73 @@ struct TupleCompare<0, TYPE, MORE_TYPES...> {
 					format_a, format_b, field_a, field_b);
 	}
 };
+
+/**
+ * Compare key parts starting from PART. Part types are known at
+ * compile time, field numbers are taken from the key definition
+ * and looked up in the field map.
+ */
+template <int PART, int TYPE, int ...MORE_TYPES>
+struct PartCompare
+{
+	inline static int compare(const struct tuple_format *format_a,
+				  const char *tuple_a,
+				  const uint32_t *field_map_a,
+				  const struct tuple_format *format_b,
+				  const char *tuple_b,
+				  const uint32_t *field_map_b,
+				  const struct key_def *key_def)
+	{
+		int r = PartCompare<PART, TYPE>::
+			compare(format_a, tuple_a, field_map_a,
+				format_b, tuple_b, field_map_b, key_def);
+		if (r != 0)
+			return r;
+		return PartCompare<PART + 1, MORE_TYPES...>::
+			compare(format_a, tuple_a, field_map_a,
+				format_b, tuple_b, field_map_b, key_def);
+	}
+};
+
+template <int PART, int TYPE>
+struct PartCompare<PART, TYPE>
+{
+	inline static int compare(const struct tuple_format *format_a,
+				  const char *tuple_a,
+				  const uint32_t *field_map_a,
+				  const struct tuple_format *format_b,
+				  const char *tuple_b,
+				  const uint32_t *field_map_b,
+				  const struct key_def *key_def)
+	{
+		uint32_t fieldno = key_def->parts[PART].fieldno;
+		const char *field_a = tuple_field_raw(format_a, tuple_a,
+						      field_map_a, fieldno);
+		const char *field_b = tuple_field_raw(format_b, tuple_b,
+						      field_map_b, fieldno);
+		assert(field_a != NULL && field_b != NULL);
+		return field_compare<TYPE>(&field_a, &field_b);
+	}
+};
+
+/**
+ * Comparator for key definitions with arbitrary field numbers,
+ * specialized by part types only.
+ */
+template <int TYPE, int ...MORE_TYPES>
+struct TupleCompareTyped
+{
+	static int compare(const struct tuple *tuple_a,
+			   const struct tuple *tuple_b,
+			   const struct key_def *key_def)
+	{
+		return PartCompare<0, TYPE, MORE_TYPES...>::
+			compare(tuple_format(tuple_a), tuple_data(tuple_a),
+				tuple_field_map(tuple_a),
+				tuple_format(tuple_b), tuple_data(tuple_b),
+				tuple_field_map(tuple_b), key_def);
+	}
+};
 } /* end of anonymous namespace */
 
 struct comparator_signature {
@@ -628,10 +749,51 @@ static const comparator_signature cmp_arr[] = {
 	COMPARATOR(0, FIELD_TYPE_STRING  , 1, FIELD_TYPE_UNSIGNED, 2, FIELD_TYPE_STRING)
 	COMPARATOR(0, FIELD_TYPE_UNSIGNED, 1, FIELD_TYPE_STRING  , 2, FIELD_TYPE_STRING)
 	COMPARATOR(0, FIELD_TYPE_STRING  , 1, FIELD_TYPE_STRING  , 2, FIELD_TYPE_STRING)
+	COMPARATOR(0, FIELD_TYPE_INTEGER)
+	COMPARATOR(0, FIELD_TYPE_NUMBER)
+	COMPARATOR(0, FIELD_TYPE_SCALAR)
+	COMPARATOR(0, FIELD_TYPE_INTEGER , 1, FIELD_TYPE_INTEGER)
+	COMPARATOR(0, FIELD_TYPE_INTEGER , 1, FIELD_TYPE_UNSIGNED)
+	COMPARATOR(0, FIELD_TYPE_INTEGER , 1, FIELD_TYPE_STRING)
+	COMPARATOR(0, FIELD_TYPE_UNSIGNED, 1, FIELD_TYPE_INTEGER)
+	COMPARATOR(0, FIELD_TYPE_STRING  , 1, FIELD_TYPE_INTEGER)
+	COMPARATOR(0, FIELD_TYPE_INTEGER , 1, FIELD_TYPE_INTEGER , 2, FIELD_TYPE_INTEGER)
 };
 
 #undef COMPARATOR
 
+struct typed_comparator_signature {
+	tuple_compare_t f;
+	uint32_t types[4];
+};
+#define TYPED_COMPARATOR(...) \
+	{ TupleCompareTyped<__VA_ARGS__>::compare, { __VA_ARGS__, UINT32_MAX } },
+
+/**
+ * field1 type, field2 type, ... for key definitions not found
+ * in cmp_arr, e.g. ones not starting from the first field.
+ */
+static const typed_comparator_signature cmp_typed_arr[] = {
+	TYPED_COMPARATOR(FIELD_TYPE_UNSIGNED)
+	TYPED_COMPARATOR(FIELD_TYPE_STRING)
+	TYPED_COMPARATOR(FIELD_TYPE_INTEGER)
+	TYPED_COMPARATOR(FIELD_TYPE_NUMBER)
+	TYPED_COMPARATOR(FIELD_TYPE_SCALAR)
+	TYPED_COMPARATOR(FIELD_TYPE_UNSIGNED, FIELD_TYPE_UNSIGNED)
+	TYPED_COMPARATOR(FIELD_TYPE_UNSIGNED, FIELD_TYPE_STRING)
+	TYPED_COMPARATOR(FIELD_TYPE_UNSIGNED, FIELD_TYPE_INTEGER)
+	TYPED_COMPARATOR(FIELD_TYPE_STRING  , FIELD_TYPE_UNSIGNED)
+	TYPED_COMPARATOR(FIELD_TYPE_STRING  , FIELD_TYPE_STRING)
+	TYPED_COMPARATOR(FIELD_TYPE_STRING  , FIELD_TYPE_INTEGER)
+	TYPED_COMPARATOR(FIELD_TYPE_INTEGER , FIELD_TYPE_UNSIGNED)
+	TYPED_COMPARATOR(FIELD_TYPE_INTEGER , FIELD_TYPE_STRING)
+	TYPED_COMPARATOR(FIELD_TYPE_INTEGER , FIELD_TYPE_INTEGER)
+	TYPED_COMPARATOR(FIELD_TYPE_UNSIGNED, FIELD_TYPE_UNSIGNED, FIELD_TYPE_UNSIGNED)
+	TYPED_COMPARATOR(FIELD_TYPE_INTEGER , FIELD_TYPE_INTEGER , FIELD_TYPE_INTEGER)
+};
+
+#undef TYPED_COMPARATOR
+
 tuple_compare_t
 tuple_compare_create(const struct key_def *def) {
 	for (uint32_t k = 0; k < sizeof(cmp_arr) / sizeof(cmp_arr[0]); k++) {
@@ -643,6 +805,16 @@ tuple_compare_create(const struct key_def *def) {
 		if (i == def->part_count && cmp_arr[k].p[i * 2] == UINT32_MAX)
 			return cmp_arr[k].f;
 	}
+	for (uint32_t k = 0;
+	     k < sizeof(cmp_typed_arr) / sizeof(cmp_typed_arr[0]); k++) {
+		uint32_t i = 0;
+		for (; i < def->part_count; i++)
+			if (def->parts[i].type != cmp_typed_arr[k].types[i])
+				break;
+		if (i == def->part_count &&
+		    cmp_typed_arr[k].types[i] == UINT32_MAX)
+			return cmp_typed_arr[k].f;
+	}
 	if (key_def_is_sequential(def))
 		return tuple_compare_sequential;
 	return tuple_compare_slowpath;
@@ -675,6 +847,27 @@ field_compare_with_key<FIELD_TYPE_STRING>(const char **field, const char **key)
 	return r;
 }
 
+template <>
+inline int
+field_compare_with_key<FIELD_TYPE_INTEGER>(const char **field, const char **key)
+{
+	return mp_compare_integer(*field, *key);
+}
+
+template <>
+inline int
+field_compare_with_key<FIELD_TYPE_NUMBER>(const char **field, const char **key)
+{
+	return mp_compare_number(*field, *key);
+}
+
+template <>
+inline int
+field_compare_with_key<FIELD_TYPE_SCALAR>(const char **field, const char **key)
+{
+	return mp_compare_scalar(*field, *key);
+}
+
 template <int TYPE>
 static inline int
 field_compare_with_key_and_next(const char **field_a, const char **field_b);
@@ -706,6 +899,39 @@ field_compare_with_key_and_next<FIELD_TYPE_STRING>(const char **field_a,
 	return r;
 }
 
+template <>
+inline int
+field_compare_with_key_and_next<FIELD_TYPE_INTEGER>(const char **field_a,
+						     const char **field_b)
+{
+	int r = mp_compare_integer(*field_a, *field_b);
+	mp_next(field_a);
+	mp_next(field_b);
+	return r;
+}
+
+template <>
+inline int
+field_compare_with_key_and_next<FIELD_TYPE_NUMBER>(const char **field_a,
+						    const char **field_b)
+{
+	int r = mp_compare_number(*field_a, *field_b);
+	mp_next(field_a);
+	mp_next(field_b);
+	return r;
+}
+
+template <>
+inline int
+field_compare_with_key_and_next<FIELD_TYPE_SCALAR>(const char **field_a,
+						    const char **field_b)
+{
+	int r = mp_compare_scalar(*field_a, *field_b);
+	mp_next(field_a);
+	mp_next(field_b);
+	return r;
+}
+
 /* Tuple with key comparator */
 namespace /* local symbols */ {
 
@@ -798,6 +1024,68 @@ struct TupleCompareWithKey<0, 0, TYPE, MORE_TYPES...>
 	}
 };
 
+/**
+ * Compare key parts starting from PART with a key. Part types
+ * are known at compile time, field numbers are taken from the
+ * key definition and looked up in the field map.
+ */
+template <int PART, int TYPE, int ...MORE_TYPES>
+struct PartCompareWithKey
+{
+	inline static int
+	compare(const struct tuple_format *format, const char *tuple,
+		const uint32_t *field_map, const char *key,
+		uint32_t part_count, const struct key_def *key_def)
+	{
+		int r = PartCompareWithKey<PART, TYPE>::
+			compare(format, tuple, field_map, key,
+				part_count, key_def);
+		if (r != 0 || part_count == PART + 1)
+			return r;
+		mp_next(&key);
+		return PartCompareWithKey<PART + 1, MORE_TYPES...>::
+			compare(format, tuple, field_map, key,
+				part_count, key_def);
+	}
+};
+
+template <int PART, int TYPE>
+struct PartCompareWithKey<PART, TYPE>
+{
+	inline static int
+	compare(const struct tuple_format *format, const char *tuple,
+		const uint32_t *field_map, const char *key,
+		uint32_t, const struct key_def *key_def)
+	{
+		const char *field =
+			tuple_field_raw(format, tuple, field_map,
+					key_def->parts[PART].fieldno);
+		assert(field != NULL);
+		return field_compare_with_key<TYPE>(&field, &key);
+	}
+};
+
+/**
+ * Comparator for key definitions with arbitrary field numbers,
+ * specialized by part types only.
+ */
+template <int TYPE, int ...MORE_TYPES>
+struct TupleCompareWithKeyTyped
+{
+	static int
+	compare(const struct tuple *tuple, const char *key,
+		uint32_t part_count, const struct key_def *key_def)
+	{
+		/* Part count can be 0 in wildcard searches. */
+		if (part_count == 0)
+			return 0;
+		return PartCompareWithKey<0, TYPE, MORE_TYPES...>::
+			compare(tuple_format(tuple), tuple_data(tuple),
+				tuple_field_map(tuple), key,
+				part_count, key_def);
+	}
+};
+
 } /* end of anonymous namespace */
 
 struct comparator_with_key_signature
@@ -823,10 +1111,49 @@ static const comparator_with_key_signature cmp_wk_arr[] = {
 	KEY_COMPARATOR(1, FIELD_TYPE_STRING  , 2, FIELD_TYPE_UNSIGNED)
 	KEY_COMPARATOR(1, FIELD_TYPE_UNSIGNED, 2, FIELD_TYPE_STRING)
 	KEY_COMPARATOR(1, FIELD_TYPE_STRING  , 2, FIELD_TYPE_STRING)
+
+	KEY_COMPARATOR(0, FIELD_TYPE_INTEGER , 1, FIELD_TYPE_INTEGER , 2, FIELD_TYPE_INTEGER)
+	KEY_COMPARATOR(0, FIELD_TYPE_INTEGER , 1, FIELD_TYPE_UNSIGNED)
+	KEY_COMPARATOR(0, FIELD_TYPE_INTEGER , 1, FIELD_TYPE_STRING)
+	KEY_COMPARATOR(0, FIELD_TYPE_UNSIGNED, 1, FIELD_TYPE_INTEGER)
+	KEY_COMPARATOR(0, FIELD_TYPE_STRING  , 1, FIELD_TYPE_INTEGER)
+	KEY_COMPARATOR(0, FIELD_TYPE_NUMBER)
+	KEY_COMPARATOR(0, FIELD_TYPE_SCALAR)
 };
 
 #undef KEY_COMPARATOR
 
+struct typed_comparator_with_key_signature
+{
+	tuple_compare_with_key_t f;
+	uint32_t types[4];
+};
+
+#define TYPED_KEY_COMPARATOR(...) \
+	{ TupleCompareWithKeyTyped<__VA_ARGS__>::compare, \
+	  { __VA_ARGS__, UINT32_MAX } },
+
+static const typed_comparator_with_key_signature cmp_wk_typed_arr[] = {
+	TYPED_KEY_COMPARATOR(FIELD_TYPE_UNSIGNED)
+	TYPED_KEY_COMPARATOR(FIELD_TYPE_STRING)
+	TYPED_KEY_COMPARATOR(FIELD_TYPE_INTEGER)
+	TYPED_KEY_COMPARATOR(FIELD_TYPE_NUMBER)
+	TYPED_KEY_COMPARATOR(FIELD_TYPE_SCALAR)
+	TYPED_KEY_COMPARATOR(FIELD_TYPE_UNSIGNED, FIELD_TYPE_UNSIGNED)
+	TYPED_KEY_COMPARATOR(FIELD_TYPE_UNSIGNED, FIELD_TYPE_STRING)
+	TYPED_KEY_COMPARATOR(FIELD_TYPE_UNSIGNED, FIELD_TYPE_INTEGER)
+	TYPED_KEY_COMPARATOR(FIELD_TYPE_STRING  , FIELD_TYPE_UNSIGNED)
+	TYPED_KEY_COMPARATOR(FIELD_TYPE_STRING  , FIELD_TYPE_STRING)
+	TYPED_KEY_COMPARATOR(FIELD_TYPE_STRING  , FIELD_TYPE_INTEGER)
+	TYPED_KEY_COMPARATOR(FIELD_TYPE_INTEGER , FIELD_TYPE_UNSIGNED)
+	TYPED_KEY_COMPARATOR(FIELD_TYPE_INTEGER , FIELD_TYPE_STRING)
+	TYPED_KEY_COMPARATOR(FIELD_TYPE_INTEGER , FIELD_TYPE_INTEGER)
+	TYPED_KEY_COMPARATOR(FIELD_TYPE_UNSIGNED, FIELD_TYPE_UNSIGNED, FIELD_TYPE_UNSIGNED)
+	TYPED_KEY_COMPARATOR(FIELD_TYPE_INTEGER , FIELD_TYPE_INTEGER , FIELD_TYPE_INTEGER)
+};
+
+#undef TYPED_KEY_COMPARATOR
+
 tuple_compare_with_key_t
 tuple_compare_with_key_create(const struct key_def *def)
 {
@@ -844,6 +1171,17 @@ tuple_compare_with_key_create(const struct key_def *def)
 		if (i == def->part_count)
 			return cmp_wk_arr[k].f;
 	}
+	for (uint32_t k = 0;
+	     k < sizeof(cmp_wk_typed_arr) / sizeof(cmp_wk_typed_arr[0]);
+	     k++) {
+		uint32_t i = 0;
+		for (; i < def->part_count; i++)
+			if (def->parts[i].type != cmp_wk_typed_arr[k].types[i])
+				break;
+		if (i == def->part_count &&
+		    cmp_wk_typed_arr[k].types[i] == UINT32_MAX)
+			return cmp_wk_typed_arr[k].f;
+	}
 	if (key_def_is_sequential(def))
 		return tuple_compare_with_key_sequential;
 	return tuple_compare_with_key_slowpath;
@@ -182,6 +182,9 @@ tuple_format_alloc(struct key_def **keys, uint16_t key_count)
 	format->id = FORMAT_ID_NIL;
 	format->field_count = field_count;
 	format->exact_field_count = 0;
+	format->field_map_step = 0;
+	format->field_map_count = 0;
+	format->field_map_slot = 0;
 	return format;
 }
 
@@ -233,6 +236,34 @@ tuple_format_dup(const struct tuple_format *src)
 	return format;
 }
 
+int
+tuple_format_set_field_map(struct tuple_format *format,
+			   uint32_t field_count, uint32_t step)
+{
+	assert(step > 0);
+	assert(format->field_map_step == 0);
+	/* The first field is always simply accessible. */
+	uint32_t count = field_count > 0 ? (field_count - 1) / step : 0;
+	if (count == 0)
+		return 0;
+	uint32_t slot_count = format->field_map_size / sizeof(uint32_t);
+	size_t field_map_size = (slot_count + count) * sizeof(uint32_t);
+	if (field_map_size + format->extra_size > UINT16_MAX) {
+		/** tuple->data_offset is 16 bits */
+		diag_set(ClientError, ER_INDEX_FIELD_COUNT_LIMIT,
+			 slot_count + count);
+		return -1;
+	}
+	/* A format without keys is never used to create tuples. */
+	if (format->field_count == 0)
+		return 0;
+	format->field_map_step = step;
+	format->field_map_count = count;
+	format->field_map_slot = -(int32_t) slot_count - 1;
+	format->field_map_size = field_map_size;
+	return 0;
+}
+
 /** @sa declaration for details. */
 int
 tuple_init_field_map(const struct tuple_format *format, uint32_t *field_map,
@@ -265,15 +296,33 @@ tuple_init_field_map(const struct tuple_format *format, uint32_t *field_map,
 				 TUPLE_INDEX_BASE))
 		return -1;
 	mp_next(&pos);
+	/*
+	 * Fields mapped regardless of indexes, which exist in
+	 * this tuple, see tuple_format_set_field_map().
+	 */
+	uint32_t map_end = format->field_map_count * format->field_map_step + 1;
+	if (map_end > field_count)
+		map_end = field_count;
+	uint32_t next_mapped = format->field_map_step;
+	int32_t map_slot = format->field_map_slot;
+	uint32_t end = MAX(format->field_count, map_end);
 	/* other fields...*/
-	for (uint32_t i = 1; i < format->field_count; i++) {
-		mp_type = mp_typeof(*pos);
-		if (key_mp_type_validate(format->fields[i].type, mp_type,
-					 ER_FIELD_TYPE, i + TUPLE_INDEX_BASE))
-			return -1;
-		if (format->fields[i].offset_slot != TUPLE_OFFSET_SLOT_NIL)
-			field_map[format->fields[i].offset_slot] =
-				(uint32_t) (pos - tuple);
+	for (uint32_t i = 1; i < end; i++) {
+		if (i < format->field_count) {
+			mp_type = mp_typeof(*pos);
+			if (key_mp_type_validate(format->fields[i].type,
+						 mp_type, ER_FIELD_TYPE,
+						 i + TUPLE_INDEX_BASE))
+				return -1;
+			if (format->fields[i].offset_slot !=
+			    TUPLE_OFFSET_SLOT_NIL)
+				field_map[format->fields[i].offset_slot] =
+					(uint32_t) (pos - tuple);
+		}
+		if (i == next_mapped && i < map_end) {
+			field_map[map_slot--] = (uint32_t) (pos - tuple);
+			next_mapped += format->field_map_step;
+		}
 		mp_next(&pos);
 	}
 	return 0;
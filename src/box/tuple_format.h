@@ -141,6 +141,19 @@ struct tuple_format {
 	 * fields. If set, each tuple must have exactly this number of fields.
 	 */
 	uint32_t exact_field_count;
+	/**
+	 * Distance between the fields which have offsets in the
+	 * field map regardless of indexes, 0 if there are none.
+	 * Offset of field i * field_map_step, 0 < i <=
+	 * field_map_count, is stored at
+	 * field_map[field_map_slot - i + 1].
+	 * \sa tuple_format_set_field_map()
+	 */
+	uint32_t field_map_step;
+	/** The number of such offsets. */
+	uint32_t field_map_count;
+	/** Offset slot of field field_map_step. */
+	int32_t field_map_slot;
 	/* Length of 'fields' array. */
 	uint32_t field_count;
 	/* Formats of the fields */
@@ -208,6 +221,28 @@ tuple_format_new(struct tuple_format_vtab *vtab, struct key_def **keys,
 struct tuple_format *
 tuple_format_dup(const struct tuple_format *src);
 
+/**
+ * Store offsets of the leading fields of tuples in the field
+ * map, not only offsets of the indexed fields, so that these
+ * fields are accessed without decoding all the fields before
+ * them. Must be called before any tuple of the format is
+ * created.
+ *
+ * @param format      Tuple format.
+ * @param field_count The number of leading fields to map.
+ * @param step        Store the offset of every step-th field
+ *                    only. A field is then found by skipping
+ *                    less than step fields after the closest
+ *                    mapped one, at the cost of step times
+ *                    smaller field map.
+ *
+ * @retval  0 Success.
+ * @retval -1 The field map is too big.
+ */
+int
+tuple_format_set_field_map(struct tuple_format *format,
+			   uint32_t field_count, uint32_t step);
+
 /**
  * Returns the total size of tuple metadata of this format.
  * See @link struct tuple @endlink for explanation of tuple layout.
@@ -302,12 +337,25 @@ tuple_field_raw(const struct tuple_format *format, const char *tuple,
 			return tuple + field_map[offset_slot];
 	}
 	ERROR_INJECT(ERRINJ_TUPLE_FIELD, return NULL);
-	uint32_t field_count = mp_decode_array(&tuple);
+	const char *pos = tuple;
+	uint32_t field_count = mp_decode_array(&pos);
 	if (unlikely(field_no >= field_count))
 		return NULL;
-	for (uint32_t k = 0; k < field_no; k++)
-		mp_next(&tuple);
-	return tuple;
+	uint32_t k = 0;
+	if (format->field_map_step != 0) {
+		/* Start from the closest mapped field. */
+		uint32_t i = field_no / format->field_map_step;
+		if (i > format->field_map_count)
+			i = format->field_map_count;
+		if (i > 0) {
+			pos = tuple + field_map[format->field_map_slot -
+						(int32_t) i + 1];
+			k = i * format->field_map_step;
+		}
+	}
+	for (; k < field_no; k++)
+		mp_next(&pos);
+	return pos;
 }
 
 #if defined(__cplusplus)
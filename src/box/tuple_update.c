@@ -1004,9 +1004,12 @@ update_read_ops(struct tuple_update *update, const char *expr,
 		if (column_mask != UINT64_MAX) {
 			/*
 			 * The optimization is only used if update
-			 * doesn't touch outside range [0..63]
+			 * doesn't touch outside range [0..63].
+			 * Negative field numbers are counted from
+			 * the end of the tuple, so the field is not
+			 * known yet.
 			 */
-			if (op->field_no > 63) {
+			if (op->field_no < 0 || op->field_no > 63) {
 				column_mask = UINT64_MAX;
 			} else {
 				/*
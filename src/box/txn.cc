@@ -84,6 +84,7 @@ txn_stmt_new(struct txn *txn)
 	stmt->new_tuple = NULL;
 	stmt->bsize_change = 0;
 	stmt->engine_savepoint = NULL;
+	stmt->func_keys = NULL;
 	stmt->row = NULL;
 
 	stailq_add_tail_entry(&txn->stmts, stmt, next);
@@ -44,6 +44,7 @@ extern struct rmean *rmean_box;
 struct space;
 struct tuple;
 struct xrow_header;
+struct memtx_func_key;
 
 /**
  * A single statement of a multi-statement
@@ -61,6 +62,11 @@ struct txn_stmt {
 	ptrdiff_t bsize_change; /* saved result of space_bsize_update(..) call */
 	/** Engine savepoint for the start of this statement. */
 	void *engine_savepoint;
+	/**
+	 * Keys removed from functional memtx indexes, kept until
+	 * the statement is committed or rolled back.
+	 */
+	struct memtx_func_key *func_keys;
 	/** Redo info: the binary log row */
 	struct xrow_header *row;
 };
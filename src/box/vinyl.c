@@ -37,6 +37,7 @@
 #include "vy_cache.h"
 
 #include <dirent.h>
+#include <fcntl.h>
 
 #include <bit/bit.h>
 #include <small/rlist.h>
@@ -116,6 +117,8 @@ struct vy_conf {
 	uint64_t cache;
 	/* bloom filter false positive rate */
 	double bloom_fpr;
+	/* write run files bypassing the OS page cache */
+	bool direct_io;
 };
 
 struct vy_env {
@@ -343,6 +346,95 @@ vy_stat_tx_write_rate(struct vy_stat *s)
 	return rmean_mean(s->rmean, VY_STAT_TX_WRITE);
 }
 
+/**
+ * Per-index read statistics. Unlike global averages collected
+ * in struct vy_stat, these are kept as histograms so that one
+ * can tell how many runs and pages an index read has to touch
+ * and pick run_count_per_level or bloom_fpr accordingly.
+ */
+struct vy_index_stat {
+	/** Latency of point lookups (get), in microseconds. */
+	struct histogram *get_latency;
+	/** Latency of range scans (cursor lifetime), in microseconds. */
+	struct histogram *scan_latency;
+	/** Number of runs searched per read request. */
+	struct histogram *lookup_runs;
+	/** Number of pages read from disk per read request. */
+	struct histogram *lookup_pages;
+	/** Number of run searches avoided using bloom filter. */
+	uint64_t bloom_reflections;
+	/** Number of bytes read from disk. */
+	uint64_t disk_bytes;
+	/** Number of bytes returned to the user. */
+	uint64_t returned_bytes;
+};
+
+static int
+vy_index_stat_create(struct vy_index_stat *s)
+{
+	static int64_t latency_buckets[] = {
+		1, 2, 5, 10, 20, 50, 100, 200, 500,
+		1000, 2000, 5000, 10000, 20000, 50000,
+		100000, 200000, 500000, 1000000,
+	};
+	static int64_t lookup_buckets[] = {
+		0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 15, 20, 25, 50, 100,
+	};
+
+	memset(s, 0, sizeof(*s));
+	s->get_latency = histogram_new(latency_buckets,
+				       lengthof(latency_buckets));
+	if (s->get_latency == NULL)
+		goto fail;
+	s->scan_latency = histogram_new(latency_buckets,
+					lengthof(latency_buckets));
+	if (s->scan_latency == NULL)
+		goto fail;
+	s->lookup_runs = histogram_new(lookup_buckets,
+				       lengthof(lookup_buckets));
+	if (s->lookup_runs == NULL)
+		goto fail;
+	s->lookup_pages = histogram_new(lookup_buckets,
+					lengthof(lookup_buckets));
+	if (s->lookup_pages == NULL)
+		goto fail;
+	return 0;
+fail:
+	diag_set(OutOfMemory, sizeof(struct histogram), "malloc",
+		 "struct histogram");
+	histogram_delete(s->get_latency);
+	histogram_delete(s->scan_latency);
+	histogram_delete(s->lookup_runs);
+	return -1;
+}
+
+static void
+vy_index_stat_destroy(struct vy_index_stat *s)
+{
+	histogram_delete(s->get_latency);
+	histogram_delete(s->scan_latency);
+	histogram_delete(s->lookup_runs);
+	histogram_delete(s->lookup_pages);
+}
+
+/**
+ * Account a finished read request.
+ * @param s        Index statistics.
+ * @param latency  Histogram to update with the request latency.
+ * @param start    Request start time, clock_monotonic().
+ * @param run_stat Run iterator statistics of the request.
+ */
+static void
+vy_index_stat_read(struct vy_index_stat *s, struct histogram *latency,
+		   double start, const struct vy_iterator_stat *run_stat)
+{
+	histogram_collect(latency, (clock_monotonic() - start) * 1000000);
+	histogram_collect(s->lookup_runs, run_stat->lookup_count);
+	histogram_collect(s->lookup_pages, run_stat->read_count);
+	s->bloom_reflections += run_stat->bloom_reflections;
+	s->disk_bytes += run_stat->read_bytes;
+}
+
 /**
  * Apply the UPSERT statement to the REPLACE, UPSERT or DELETE statement.
  * If the second statement is
@@ -621,6 +713,8 @@ struct vy_index {
 	uint64_t used;
 	/** Histogram of number of runs in range. */
 	struct histogram *run_hist;
+	/** Read statistics. */
+	struct vy_index_stat stat;
 	/**
 	 * Reference counter. Used to postpone index drop
 	 * until all pending operations have completed.
@@ -675,6 +769,12 @@ struct vy_index {
 
 	/** Member of env->indexes. */
 	struct rlist link;
+	/**
+	 * Member of vy_scheduler::over_limit_indexes if the
+	 * index uses more memory than its memory_limit option
+	 * allows, otherwise empty.
+	 */
+	struct rlist in_over_limit;
 	/**
 	 * Incremented for each change of the range list,
 	 * to invalidate iterators.
@@ -932,6 +1032,8 @@ struct vy_read_iterator {
 	struct tuple *curr_stmt;
 	/* is lazy search started */
 	bool search_started;
+	/* usage statistics of run iterators */
+	struct vy_iterator_stat run_stat;
 };
 
 /**
@@ -991,6 +1093,8 @@ struct vy_cursor {
 	int n_reads;
 	/** Cursor creation time, used for statistics. */
 	ev_tstamp start;
+	/** Cursor creation time, clock_monotonic(), for index statistics. */
+	double start_time;
 	/**
 	 * All open cursors are registered in a transaction
 	 * they belong to. When the transaction ends, the cursor
@@ -1429,6 +1533,23 @@ vy_run_unref(struct vy_run *run)
 	return false;
 }
 
+/**
+ * Advise the OS to drop cached pages of a run file. Compacted
+ * runs are not removed from disk until garbage collection, so
+ * without this their pages would linger in the page cache and
+ * evict pages of runs still used for reads.
+ */
+static void
+vy_run_drop_cache(struct vy_run *run)
+{
+#ifdef HAVE_POSIX_FADVISE
+	if (run->fd >= 0)
+		posix_fadvise(run->fd, 0, 0, POSIX_FADV_DONTNEED);
+#else
+	(void) run;
+#endif /* HAVE_POSIX_FADVISE */
+}
+
 enum vy_file_type {
 	VY_FILE_INDEX,
 	VY_FILE_RUN,
@@ -2322,6 +2443,8 @@ error_page_index:
 
 /**
  * Write statements from the iterator to a new run file.
+ * If @direct_io is set, the file is written with O_DIRECT
+ * so as not to pollute the OS page cache.
  *
  *  @retval 0, curr_stmt != NULL: all is ok, the iterator is not finished
  *  @retval 0, curr_stmt == NULL: all is ok, the iterator finished
@@ -2332,7 +2455,8 @@ vy_run_write_data(struct vy_run *run, const char *dirpath,
 		  struct vy_write_iterator *wi, struct tuple **curr_stmt,
 		  const char *end_key, struct bloom_spectrum *bs,
 		  const struct index_def *index_def,
-		  const struct index_def *user_index_def, const char **max_key)
+		  const struct index_def *user_index_def, const char **max_key,
+		  bool direct_io)
 {
 	assert(curr_stmt != NULL);
 	assert(*curr_stmt != NULL);
@@ -2349,6 +2473,8 @@ vy_run_write_data(struct vy_run *run, const char *dirpath,
 	};
 	if (xlog_create(&data_xlog, path, &meta) < 0)
 		return -1;
+	if (direct_io && xlog_set_direct_io(&data_xlog) != 0)
+		goto err;
 
 	/*
 	 * Read from the iterator until it's exhausted or
@@ -3133,7 +3259,8 @@ vy_range_write_run(struct vy_range *range, struct vy_write_iterator *wi,
 	bloom_spectrum_create(&bs, max_output_count, bloom_fpr, runtime.quota);
 
 	if (vy_run_write_data(run, index->path, wi, stmt, range->end, &bs,
-			      index_def, user_index_def, max_key) != 0)
+			      index_def, user_index_def, max_key,
+			      index->env->conf->direct_io) != 0)
 		return -1;
 
 	bloom_spectrum_choose(&bs, &run->info.bloom);
@@ -4481,6 +4608,8 @@ vy_task_compact_complete(struct vy_task *task)
 	n = task->run_count;
 	rlist_foreach_entry_safe(run, &range->runs, in_range, tmp) {
 		vy_range_remove_run(range, run);
+		if (index->env->conf->direct_io)
+			vy_run_drop_cache(run);
 		vy_run_unref(run);
 		if (--n == 0)
 			break;
@@ -4640,20 +4769,49 @@ heap_compact_less(struct heap_node *a, struct heap_node *b)
 
 #include "salad/heap.h"
 
+/** A vinyl worker thread. */
+struct vy_worker {
+	struct cord cord;
+	/** Scheduler this worker takes tasks from. */
+	struct vy_scheduler *scheduler;
+	/** Link in vy_scheduler::workers. */
+	struct rlist in_pool;
+	/** Link in vy_scheduler::retired_workers. */
+	struct stailq_entry in_retired;
+};
+
 struct vy_scheduler {
 	pthread_mutex_t        mutex;
 	struct vy_env    *env;
 	heap_t dump_heap;
 	heap_t compact_heap;
 
-	struct cord *worker_pool;
+	/** List of all worker threads, linked by vy_worker::in_pool. */
+	struct rlist workers;
 	struct fiber *scheduler;
 	struct ev_loop *loop;
-	/** Total number of worker threads. */
+	/** Number of worker threads that accept new tasks. */
 	int worker_pool_size;
+	/**
+	 * Max number of worker threads, set by vinyl_threads.
+	 * The pool grows up to this limit when there is dump or
+	 * compaction backlog and shrinks back to
+	 * VY_WORKER_POOL_MIN when workers stay idle.
+	 */
+	int worker_pool_max;
 	/** Number worker threads that are currently idle. */
 	int workers_available;
 	bool is_worker_pool_running;
+	/**
+	 * Number of idle workers asked to exit, but that have
+	 * not noticed it yet. Protected by the mutex.
+	 */
+	int workers_to_retire;
+	/**
+	 * Workers that have exited and need to be joined by
+	 * the scheduler. Protected by the mutex.
+	 */
+	struct stailq retired_workers;
 
 	/**
 	 * There is a pending task for workers in the pool,
@@ -4699,6 +4857,13 @@ struct vy_scheduler {
 	 * Older mems are closer to the tail of the list.
 	 */
 	struct rlist dirty_mems;
+	/**
+	 * Indexes that exceeded their memory_limit option,
+	 * linked by vy_index::in_over_limit. An index is added
+	 * on commit and removed by the scheduler once its memory
+	 * usage drops below the limit.
+	 */
+	struct rlist over_limit_indexes;
 	/** Min LSN over all in-memory indexes. */
 	int64_t mem_min_lsn;
 	/**
@@ -4715,12 +4880,25 @@ struct vy_scheduler {
 #define VY_SCHEDULER_TIMEOUT_MIN		1
 #define VY_SCHEDULER_TIMEOUT_MAX		60
 
+/**
+ * Min number of worker threads: one for compaction and one
+ * reserved for dumps, see vy_schedule().
+ */
+#define VY_WORKER_POOL_MIN			2
+/**
+ * Number of seconds the scheduler waits for an event before
+ * retiring an idle worker thread.
+ */
+#define VY_WORKER_IDLE_TIMEOUT			10
+
 static void
 vy_scheduler_start_workers(struct vy_scheduler *scheduler);
 static void
 vy_scheduler_stop_workers(struct vy_scheduler *scheduler);
 static int
 vy_scheduler_f(va_list va);
+static int
+vy_worker_f(va_list va);
 
 static void
 vy_scheduler_quota_cb(enum vy_quota_event event, void *arg)
@@ -4764,6 +4942,7 @@ vy_scheduler_new(struct vy_env *env)
 	tt_pthread_mutex_init(&scheduler->mutex, NULL);
 	diag_create(&scheduler->diag);
 	rlist_create(&scheduler->dirty_mems);
+	rlist_create(&scheduler->over_limit_indexes);
 	scheduler->mem_min_lsn = INT64_MAX;
 	scheduler->checkpoint_lsn = -1;
 	ipc_cond_create(&scheduler->checkpoint_cond);
@@ -4771,6 +4950,10 @@ vy_scheduler_new(struct vy_env *env)
 	vy_compact_heap_create(&scheduler->compact_heap);
 	vy_dump_heap_create(&scheduler->dump_heap);
 	tt_pthread_cond_init(&scheduler->worker_cond, NULL);
+	rlist_create(&scheduler->workers);
+	stailq_create(&scheduler->retired_workers);
+	scheduler->worker_pool_max = cfg_geti("vinyl_threads");
+	assert(scheduler->worker_pool_max >= VY_WORKER_POOL_MIN);
 	scheduler->loop = loop();
 	ev_async_init(&scheduler->scheduler_async, vy_scheduler_async_cb);
 	ipc_cond_create(&scheduler->scheduler_cond);
@@ -4841,42 +5024,94 @@ vy_scheduler_remove_range(struct vy_scheduler *scheduler,
 }
 
 /**
- * Create a task for dumping a range. The new task is returned
- * in @ptask. If there's no range that needs to be dumped @ptask
- * is set to NULL.
+ * Find an index that uses more memory than allowed by its
+ * memory_limit option and return its biggest range that is
+ * not being dumped already. Return NULL if there is no such
+ * index. Only indexes on the over_limit_indexes list are
+ * looked at, those that fit in their limit again are removed
+ * from the list.
+ */
+static struct vy_range *
+vy_scheduler_peek_index_dump(struct vy_scheduler *scheduler)
+{
+	struct vy_index *index, *tmp;
+	rlist_foreach_entry_safe(index, &scheduler->over_limit_indexes,
+				 in_over_limit, tmp) {
+		int64_t limit = index->index_def->opts.memory_limit;
+		if (limit == 0 || index->used <= (uint64_t)limit) {
+			rlist_del(&index->in_over_limit);
+			continue;
+		}
+		struct vy_range *range, *victim = NULL;
+		for (range = vy_range_tree_first(&index->tree); range != NULL;
+		     range = vy_range_tree_next(&index->tree, range)) {
+			/* Skip ranges that are being processed. */
+			if (range->in_dump.pos == UINT32_MAX)
+				continue;
+			if (victim == NULL || range->used > victim->used)
+				victim = range;
+		}
+		if (victim != NULL && victim->used > 0)
+			return victim;
+	}
+	return NULL;
+}
+
+/**
+ * Return the range to dump next or NULL if there is nothing
+ * to dump. @dump_lsn is set to the max LSN of statements that
+ * need to be dumped.
  *
  * We only dump a range if it needs to be snapshotted or the quota
  * on memory usage is exceeded. In either case, the oldest range
  * is selected, because dumping it will free the maximal amount of
  * memory due to log structured design of the memory allocator.
- *
- * Returns 0 on success, -1 on failure.
+ * Otherwise, ranges of indexes that exceed their own memory_limit
+ * are dumped, see vy_scheduler_peek_index_dump().
  */
-static int
-vy_scheduler_peek_dump(struct vy_scheduler *scheduler, struct vy_task **ptask)
+static struct vy_range *
+vy_scheduler_peek_dump_range(struct vy_scheduler *scheduler,
+			     int64_t *dump_lsn)
 {
-retry:
-	*ptask = NULL;
+	*dump_lsn = INT64_MAX;
 	struct heap_node *pn = vy_dump_heap_top(&scheduler->dump_heap);
 	if (pn == NULL)
-		return 0; /* nothing to do */
+		return NULL; /* nothing to do */
 	struct vy_range *range = container_of(pn, struct vy_range, in_dump);
 	if (range->used == 0)
-		return 0; /* nothing to do */
-	int64_t dump_lsn = INT64_MAX;
+		return NULL; /* nothing to do */
 	if (scheduler->checkpoint_lsn != -1) {
 		/*
 		 * Snapshot is in progress. To make a consistent
 		 * snapshot, we only dump statements inserted before
 		 * the WAL checkpoint.
 		 */
-		dump_lsn = scheduler->checkpoint_lsn;
-		if (range->min_lsn > dump_lsn)
-			return 0;
-	} else {
-		if (!vy_quota_is_exceeded(&scheduler->env->quota))
-			return 0; /* nothing to do */
+		*dump_lsn = scheduler->checkpoint_lsn;
+		if (range->min_lsn > *dump_lsn)
+			return NULL;
+	} else if (!vy_quota_is_exceeded(&scheduler->env->quota)) {
+		range = vy_scheduler_peek_index_dump(scheduler);
 	}
+	return range;
+}
+
+/**
+ * Create a task for dumping a range. The new task is returned
+ * in @ptask. If there's no range that needs to be dumped @ptask
+ * is set to NULL, see vy_scheduler_peek_dump_range().
+ *
+ * Returns 0 on success, -1 on failure.
+ */
+static int
+vy_scheduler_peek_dump(struct vy_scheduler *scheduler, struct vy_task **ptask)
+{
+retry:
+	*ptask = NULL;
+	int64_t dump_lsn;
+	struct vy_range *range = vy_scheduler_peek_dump_range(scheduler,
+							      &dump_lsn);
+	if (range == NULL)
+		return 0; /* nothing to do */
 	if (vy_task_dump_new(&scheduler->task_pool,
 			     range, dump_lsn, ptask) != 0)
 		return -1;
@@ -4886,14 +5121,33 @@ retry:
 }
 
 /**
- * Create a task for compacting a range. The new task is returned
- * in @ptask. If there's no range that needs to be compacted @ptask
- * is set to NULL.
+ * Return the range to compact next or NULL if there is nothing
+ * to compact.
  *
  * We compact ranges that have more runs in a level than specified
  * by run_count_per_level configuration option. Among those runs we
  * give preference to those ranges whose compaction will reduce
  * read amplification most.
+ */
+static struct vy_range *
+vy_scheduler_peek_compact_range(struct vy_scheduler *scheduler)
+{
+	/* Do not schedule compaction until snapshot is complete. */
+	if (scheduler->checkpoint_lsn != -1)
+		return NULL;
+	struct heap_node *pn = vy_compact_heap_top(&scheduler->compact_heap);
+	if (pn == NULL)
+		return NULL; /* nothing to do */
+	struct vy_range *range = container_of(pn, struct vy_range, in_compact);
+	if (range->compact_priority == 0)
+		return NULL; /* nothing to do */
+	return range;
+}
+
+/**
+ * Create a task for compacting a range. The new task is returned
+ * in @ptask. If there's no range that needs to be compacted @ptask
+ * is set to NULL, see vy_scheduler_peek_compact_range().
  *
  * Returns 0 on success, -1 on failure.
  */
@@ -4903,14 +5157,8 @@ vy_scheduler_peek_compact(struct vy_scheduler *scheduler,
 {
 retry:
 	*ptask = NULL;
-	/* Do not schedule compaction until snapshot is complete. */
-	if (scheduler->checkpoint_lsn != -1)
-		return 0;
-	struct heap_node *pn = vy_compact_heap_top(&scheduler->compact_heap);
-	if (pn == NULL)
-		return 0; /* nothing to do */
-	struct vy_range *range = container_of(pn, struct vy_range, in_compact);
-	if (range->compact_priority == 0)
+	struct vy_range *range = vy_scheduler_peek_compact_range(scheduler);
+	if (range == NULL)
 		return 0; /* nothing to do */
 	if (vy_task_compact_new(&scheduler->task_pool, range, ptask) != 0)
 		return -1;
@@ -4991,6 +5239,108 @@ fail:
 	return -1;
 }
 
+/**
+ * Return true if there is dump or compaction work that cannot
+ * be scheduled because there are not enough idle workers.
+ */
+static bool
+vy_scheduler_has_backlog(struct vy_scheduler *scheduler)
+{
+	int64_t dump_lsn;
+	if (vy_scheduler_peek_dump_range(scheduler, &dump_lsn) != NULL)
+		return true;
+	/* Compaction needs a spare worker, see vy_schedule(). */
+	return scheduler->workers_available <= 1 &&
+	       vy_scheduler_peek_compact_range(scheduler) != NULL;
+}
+
+/** Start a new worker thread and add it to the pool. */
+static int
+vy_scheduler_add_worker(struct vy_scheduler *scheduler)
+{
+	struct vy_worker *worker = calloc(1, sizeof(*worker));
+	if (worker == NULL) {
+		diag_set(OutOfMemory, sizeof(*worker), "calloc",
+			 "struct vy_worker");
+		return -1;
+	}
+	worker->scheduler = scheduler;
+	if (cord_costart(&worker->cord, "vinyl.worker",
+			 vy_worker_f, worker) != 0) {
+		free(worker);
+		return -1;
+	}
+	rlist_add_tail_entry(&scheduler->workers, worker, in_pool);
+	scheduler->worker_pool_size++;
+	scheduler->workers_available++;
+	return 0;
+}
+
+/**
+ * Ask an idle worker thread to exit. The worker is joined
+ * by vy_scheduler_join_retired_workers() as soon as it
+ * notices the request.
+ */
+static void
+vy_scheduler_retire_worker(struct vy_scheduler *scheduler)
+{
+	assert(scheduler->workers_available > 0);
+	tt_pthread_mutex_lock(&scheduler->mutex);
+	scheduler->workers_to_retire++;
+	pthread_cond_broadcast(&scheduler->worker_cond);
+	tt_pthread_mutex_unlock(&scheduler->mutex);
+	scheduler->worker_pool_size--;
+	scheduler->workers_available--;
+}
+
+/** Join and free worker threads that have exited. */
+static void
+vy_scheduler_join_retired_workers(struct vy_scheduler *scheduler)
+{
+	struct stailq retired;
+	stailq_create(&retired);
+	tt_pthread_mutex_lock(&scheduler->mutex);
+	stailq_concat(&retired, &scheduler->retired_workers);
+	tt_pthread_mutex_unlock(&scheduler->mutex);
+
+	struct vy_worker *worker, *next;
+	stailq_foreach_entry_safe(worker, next, &retired, in_retired) {
+		cord_join(&worker->cord);
+		rlist_del_entry(worker, in_pool);
+		free(worker);
+	}
+}
+
+/**
+ * Grow the worker pool if there is backlog, or shrink it
+ * if it exceeds the configured limit. @timed_out is set if
+ * the scheduler has been idle for VY_WORKER_IDLE_TIMEOUT.
+ */
+static void
+vy_scheduler_adjust_workers(struct vy_scheduler *scheduler, bool timed_out)
+{
+	vy_scheduler_join_retired_workers(scheduler);
+
+	/* vinyl_threads may have been decreased at runtime. */
+	while (scheduler->worker_pool_size > scheduler->worker_pool_max &&
+	       scheduler->workers_available > 0)
+		vy_scheduler_retire_worker(scheduler);
+
+	/* Retire one worker per idle period, keep the dump reserve. */
+	if (timed_out &&
+	    scheduler->worker_pool_size > VY_WORKER_POOL_MIN &&
+	    scheduler->workers_available > 1)
+		vy_scheduler_retire_worker(scheduler);
+
+	if (scheduler->workers_available <= 1 &&
+	    scheduler->worker_pool_size < scheduler->worker_pool_max &&
+	    vy_scheduler_has_backlog(scheduler) &&
+	    vy_scheduler_add_worker(scheduler) != 0) {
+		diag_log();
+		say_warn("failed to start a vinyl worker thread");
+	}
+}
+
 static int
 vy_scheduler_f(va_list va)
 {
@@ -5026,6 +5376,8 @@ vy_scheduler_f(va_list va)
 
 	vy_scheduler_start_workers(scheduler);
 
+	bool timed_out = false;
+	double idle_timeout;
 	while (scheduler->scheduler != NULL) {
 		struct stailq output_queue;
 		struct vy_task *task, *next;
@@ -5072,6 +5424,9 @@ vy_scheduler_f(va_list va)
 		/* Throttle for a while if a task failed. */
 		if (tasks_failed > 0)
 			goto error;
+		/* Grow or shrink the pool depending on the backlog. */
+		vy_scheduler_adjust_workers(scheduler, timed_out);
+		timed_out = false;
 		/* All worker threads are busy. */
 		if (scheduler->workers_available == 0)
 			goto wait;
@@ -5119,7 +5474,13 @@ error:
 		continue;
 wait:
 		/* Wait for changes */
-		ipc_cond_wait(&scheduler->scheduler_cond);
+		idle_timeout = VY_WORKER_IDLE_TIMEOUT;
+		ERROR_INJECT_U64(ERRINJ_VY_WORKER_IDLE_TIMEOUT,
+				 errinj_getu64(ERRINJ_VY_WORKER_IDLE_TIMEOUT) != 0,
+				 {idle_timeout = 0.001 * errinj_getu64(ERRINJ_VY_WORKER_IDLE_TIMEOUT);});
+		if (ipc_cond_wait_timeout(&scheduler->scheduler_cond,
+					  idle_timeout) != 0)
+			timed_out = true;
 	}
 
 	return 0;
@@ -5128,12 +5489,23 @@ wait:
 static int
 vy_worker_f(va_list va)
 {
-	struct vy_scheduler *scheduler = va_arg(va, struct vy_scheduler *);
+	struct vy_worker *worker = va_arg(va, struct vy_worker *);
+	struct vy_scheduler *scheduler = worker->scheduler;
 	coeio_enable();
 	struct vy_task *task = NULL;
 
 	tt_pthread_mutex_lock(&scheduler->mutex);
 	while (scheduler->is_worker_pool_running) {
+		/* Exit if the scheduler shrinks the pool */
+		if (scheduler->workers_to_retire > 0 &&
+		    stailq_empty(&scheduler->input_queue)) {
+			scheduler->workers_to_retire--;
+			stailq_add_tail_entry(&scheduler->retired_workers,
+					      worker, in_retired);
+			ev_async_send(scheduler->loop,
+				      &scheduler->scheduler_async);
+			break;
+		}
 		/* Wait for a task */
 		if (stailq_empty(&scheduler->input_queue)) {
 			/* Wake scheduler up if there are no more tasks */
@@ -5148,6 +5520,11 @@ vy_worker_f(va_list va)
 		tt_pthread_mutex_unlock(&scheduler->mutex);
 		assert(task != NULL);
 
+		/* Hold the worker busy while the injection is set. */
+		ERROR_INJECT(ERRINJ_VY_TASK_DELAY, {
+			while (errinj_getb(ERRINJ_VY_TASK_DELAY))
+				usleep(10000);
+		});
 		/* Execute task */
 		uint64_t start = ev_now(loop());
 		task->status = task->ops->execute(task);
@@ -5171,22 +5548,20 @@ vy_scheduler_start_workers(struct vy_scheduler *scheduler)
 {
 	assert(!scheduler->is_worker_pool_running);
 
-	/* Start worker threads */
+	/*
+	 * Start with the minimal number of worker threads,
+	 * more are added on demand, see vy_scheduler_adjust_workers().
+	 */
 	scheduler->is_worker_pool_running = true;
-	scheduler->worker_pool_size = cfg_geti("vinyl_threads");
-	/* One thread is reserved for dumps, see vy_schedule(). */
-	assert(scheduler->worker_pool_size >= 2);
-	scheduler->workers_available = scheduler->worker_pool_size;
+	scheduler->worker_pool_size = 0;
+	scheduler->workers_available = 0;
+	scheduler->workers_to_retire = 0;
 	stailq_create(&scheduler->input_queue);
 	stailq_create(&scheduler->output_queue);
-	scheduler->worker_pool = (struct cord *)
-		calloc(scheduler->worker_pool_size, sizeof(struct cord));
-	if (scheduler->worker_pool == NULL)
-		panic("failed to allocate vinyl worker pool");
 	ev_async_start(scheduler->loop, &scheduler->scheduler_async);
-	for (int i = 0; i < scheduler->worker_pool_size; i++) {
-		cord_costart(&scheduler->worker_pool[i], "vinyl.worker",
-			     vy_worker_f, scheduler);
+	for (int i = 0; i < VY_WORKER_POOL_MIN; i++) {
+		if (vy_scheduler_add_worker(scheduler) != 0)
+			panic("failed to start vinyl worker thread");
 	}
 }
 
@@ -5206,12 +5581,17 @@ vy_scheduler_stop_workers(struct vy_scheduler *scheduler)
 	tt_pthread_mutex_unlock(&scheduler->mutex);
 
 	/* Wait for worker threads to exit. */
-	for (int i = 0; i < scheduler->worker_pool_size; i++)
-		cord_join(&scheduler->worker_pool[i]);
+	struct vy_worker *worker, *next_worker;
+	rlist_foreach_entry_safe(worker, &scheduler->workers, in_pool,
+				 next_worker) {
+		cord_join(&worker->cord);
+		free(worker);
+	}
+	rlist_create(&scheduler->workers);
+	stailq_create(&scheduler->retired_workers);
 	ev_async_stop(scheduler->loop, &scheduler->scheduler_async);
-	free(scheduler->worker_pool);
-	scheduler->worker_pool = NULL;
 	scheduler->worker_pool_size = 0;
+	scheduler->workers_to_retire = 0;
 
 	/* Abort all pending tasks. */
 	struct vy_task *task, *next;
@@ -5362,6 +5742,7 @@ vy_conf_new()
 	conf->memory_limit = cfg_getd("vinyl_memory");
 	conf->cache = cfg_getd("vinyl_cache");
 	conf->bloom_fpr = cfg_getd("vinyl_bloom_fpr");
+	conf->direct_io = cfg_geti("vinyl_direct_io");
 
 	conf->path = strdup(cfg_gets("vinyl_dir"));
 	if (conf->path == NULL) {
@@ -5540,6 +5921,16 @@ vy_info_append_performance(struct vy_env *env, struct vy_info_handler *h)
 	vy_info_table_end(h);
 }
 
+static void
+vy_info_append_scheduler(struct vy_env *env, struct vy_info_handler *h)
+{
+	struct vy_scheduler *scheduler = env->scheduler;
+	vy_info_table_begin(h, "scheduler");
+	vy_info_append_u32(h, "workers", scheduler->worker_pool_size);
+	vy_info_append_u32(h, "workers_max", scheduler->worker_pool_max);
+	vy_info_table_end(h);
+}
+
 static void
 vy_info_append_metric(struct vy_env *env, struct vy_info_handler *h)
 {
@@ -5548,6 +5939,27 @@ vy_info_append_metric(struct vy_env *env, struct vy_info_handler *h)
 	vy_info_table_end(h);
 }
 
+static void
+vy_info_append_index_stat(struct vy_info_handler *h, const char *name,
+			  struct vy_index_stat *stat)
+{
+	char buf[1024];
+
+	vy_info_table_begin(h, name);
+	histogram_snprint(buf, sizeof(buf), stat->get_latency);
+	vy_info_append_str(h, "get_latency", buf);
+	histogram_snprint(buf, sizeof(buf), stat->scan_latency);
+	vy_info_append_str(h, "scan_latency", buf);
+	histogram_snprint(buf, sizeof(buf), stat->lookup_runs);
+	vy_info_append_str(h, "lookup_runs", buf);
+	histogram_snprint(buf, sizeof(buf), stat->lookup_pages);
+	vy_info_append_str(h, "lookup_pages", buf);
+	vy_info_append_u64(h, "bloom_reflect_count", stat->bloom_reflections);
+	vy_info_append_u64(h, "disk_bytes", stat->disk_bytes);
+	vy_info_append_u64(h, "returned_bytes", stat->returned_bytes);
+	vy_info_table_end(h);
+}
+
 static void
 vy_info_append_indices(struct vy_env *env, struct vy_info_handler *h)
 {
@@ -5559,6 +5971,8 @@ vy_info_append_indices(struct vy_env *env, struct vy_info_handler *h)
 		vy_info_table_begin(h, i->name);
 		vy_info_append_u64(h, "range_size", i->index_def->opts.range_size);
 		vy_info_append_u64(h, "page_size", i->index_def->opts.page_size);
+		vy_info_append_u64(h, "memory_limit",
+				   i->index_def->opts.memory_limit);
 		vy_info_append_u64(h, "memory_used", i->used);
 		vy_info_append_u64(h, "size", i->size);
 		vy_info_append_u64(h, "count", i->stmt_count);
@@ -5568,6 +5982,7 @@ vy_info_append_indices(struct vy_env *env, struct vy_info_handler *h)
 		vy_info_append_u32(h, "run_avg", i->run_count / i->range_count);
 		histogram_snprint(buf, sizeof(buf), i->run_hist);
 		vy_info_append_str(h, "run_histogram", buf);
+		vy_info_append_index_stat(h, "read", &i->stat);
 		vy_info_table_end(h);
 	}
 	vy_info_table_end(h);
@@ -5581,6 +5996,7 @@ vy_info_gather(struct vy_env *env, struct vy_info_handler *h)
 	vy_info_append_memory(env, h);
 	vy_info_append_metric(env, h);
 	vy_info_append_performance(env, h);
+	vy_info_append_scheduler(env, h);
 }
 
 /** }}} Introspection */
@@ -5697,6 +6113,7 @@ vy_index_drop(struct vy_index *index)
 	 */
 	index->is_dropped = true;
 	rlist_del(&index->link);
+	rlist_del(&index->in_over_limit);
 	index->space = NULL;
 	vy_index_unref(index);
 
@@ -5835,6 +6252,9 @@ vy_index_new(struct vy_env *e, struct index_def *user_index_def,
 	if (index->run_hist == NULL)
 		goto fail_run_hist;
 
+	if (vy_index_stat_create(&index->stat) != 0)
+		goto fail_stat;
+
 	if (user_index_def->iid > 0) {
 		/**
 		 * Calculate the bitmask of columns used in this
@@ -5857,6 +6277,7 @@ vy_index_new(struct vy_env *e, struct index_def *user_index_def,
 	vy_range_tree_new(&index->tree);
 	index->version = 1;
 	rlist_create(&index->link);
+	rlist_create(&index->in_over_limit);
 	read_set_new(&index->read_set);
 	index->space = space;
 	index->user_index_def = user_index_def;
@@ -5867,6 +6288,8 @@ vy_index_new(struct vy_env *e, struct index_def *user_index_def,
 	return index;
 
 fail_cache_init:
+	vy_index_stat_destroy(&index->stat);
+fail_stat:
 	histogram_delete(index->run_hist);
 fail_run_hist:
 	free(index->name);
@@ -5953,6 +6376,7 @@ vy_commit_alter_space(struct space *old_space, struct space *new_space)
 static void
 vy_index_delete(struct vy_index *index)
 {
+	rlist_del(&index->in_over_limit);
 	read_set_iter(&index->read_set, NULL, read_set_delete_cb, NULL);
 	vy_range_tree_iter(&index->tree, NULL, vy_range_tree_free_cb, index);
 	free(index->name);
@@ -5964,6 +6388,7 @@ vy_index_delete(struct vy_index *index)
 		index_def_delete(index->index_def);
 	index_def_delete(index->user_index_def);
 	histogram_delete(index->run_hist);
+	vy_index_stat_destroy(&index->stat);
 	vy_cache_delete(index->cache);
 	tuple_format_ref(index->space_format, -1);
 	TRASH(index);
@@ -6286,6 +6711,7 @@ vy_index_get(struct vy_tx *tx, struct vy_index *index, const char *key,
 	if (vykey == NULL)
 		return -1;
 	ev_tstamp start  = ev_now(loop());
+	double start_time = clock_monotonic();
 	int64_t vlsn = INT64_MAX;
 	const int64_t *vlsn_ptr = &vlsn;
 	if (tx != NULL)
@@ -6300,10 +6726,14 @@ vy_index_get(struct vy_tx *tx, struct vy_index *index, const char *key,
 		goto error;
 	}
 	tuple_unref(vykey);
-	if (*result != NULL)
+	if (*result != NULL) {
 		tuple_ref(*result);
+		index->stat.returned_bytes += tuple_bsize(*result);
+	}
 	vy_read_iterator_close(&itr);
 	vy_stat_get(e->stat, start);
+	vy_index_stat_read(&index->stat, index->stat.get_latency,
+			   start_time, &itr.run_stat);
 	return 0;
 error:
 	tuple_unref(vykey);
@@ -7235,6 +7665,7 @@ vy_commit(struct vy_env *e, struct vy_tx *tx, int64_t lsn)
 	 * Sic: the loop below must not yield after recovery.
 	 */
 	uint64_t write_count = 0;
+	bool index_limit_exceeded = false;
 	const struct tuple *delete = NULL, *replace = NULL;
 	enum vy_status status = e->status;
 	MAYBE_UNUSED uint32_t current_space_id = 0;
@@ -7267,6 +7698,13 @@ vy_commit(struct vy_env *e, struct vy_tx *tx, int64_t lsn)
 		if (vy_tx_write(index, v->mem, stmt, region_stmt, status) != 0)
 			return -1;
 		write_count++;
+		int64_t limit = index->index_def->opts.memory_limit;
+		if (limit > 0 && index->used > (uint64_t)limit &&
+		    rlist_empty(&index->in_over_limit)) {
+			rlist_add_tail(&e->scheduler->over_limit_indexes,
+				       &index->in_over_limit);
+			index_limit_exceeded = true;
+		}
 	}
 
 	uint32_t count = 0;
@@ -7282,6 +7720,9 @@ vy_commit(struct vy_env *e, struct vy_tx *tx, int64_t lsn)
 	TRASH(tx);
 	free(tx);
 
+	/* Dump indexes exceeding memory_limit, see vy_scheduler_peek_dump(). */
+	if (index_limit_exceeded && status == VINYL_ONLINE)
+		ipc_cond_signal(&e->scheduler->scheduler_cond);
 	vy_quota_use(quota, write_size);
 	return 0;
 }
@@ -7479,6 +7920,21 @@ vy_env_delete(struct vy_env *e)
 	free(e);
 }
 
+void
+vy_set_worker_pool_size(struct vy_env *env, int size)
+{
+	struct vy_scheduler *scheduler = env->scheduler;
+	assert(size >= VY_WORKER_POOL_MIN);
+	scheduler->worker_pool_max = size;
+	/*
+	 * Let the scheduler grow or shrink the pool. Do not wake
+	 * it up if workers have not been started yet, because the
+	 * first wakeup starts them, see vy_scheduler_f().
+	 */
+	if (scheduler->is_worker_pool_running)
+		ipc_cond_signal(&scheduler->scheduler_cond);
+}
+
 /** }}} Environment */
 
 /** {{{ Recovery */
@@ -7985,6 +8441,7 @@ vy_run_iterator_load_page(struct vy_run_iterator *itr, uint32_t page_no,
 	struct vy_page *page = vy_page_new(page_info);
 	if (page == NULL)
 		return -1;
+	size_t read_size = page_info->size;
 
 	/* Read page data from the disk */
 	int rc;
@@ -8062,6 +8519,9 @@ vy_run_iterator_load_page(struct vy_run_iterator *itr, uint32_t page_no,
 	/* Iterator is never used from multiple fibers */
 	assert(vy_run_iterator_cache_get(itr, page_no) == NULL);
 
+	itr->stat->read_count++;
+	itr->stat->read_bytes += read_size;
+
 	/* Update cache */
 	vy_run_iterator_cache_put(itr, page, page_no);
 
@@ -9959,7 +10419,7 @@ vy_read_iterator_add_disk(struct vy_read_iterator *itr)
 {
 	assert(itr->curr_range != NULL);
 	assert(itr->curr_range->shadow == NULL);
-	struct vy_iterator_stat *stat = &itr->index->env->stat->run_stat;
+	struct vy_iterator_stat *stat = &itr->run_stat;
 	struct vy_run *run;
 	struct tuple_format *format = itr->index->surrogate_format;
 	/*
@@ -10021,6 +10481,7 @@ vy_read_iterator_open(struct vy_read_iterator *itr, struct vy_index *index,
 	itr->search_started = false;
 	itr->curr_stmt = NULL;
 	itr->curr_range = NULL;
+	memset(&itr->run_stat, 0, sizeof(itr->run_stat));
 }
 
 /**
@@ -10245,6 +10706,7 @@ vy_read_iterator_close(struct vy_read_iterator *itr)
 
 	if (itr->search_started)
 		vy_merge_iterator_close(&itr->merge_iterator);
+	vy_iterator_stat_add(&itr->index->env->stat->run_stat, &itr->run_stat);
 }
 
 /* }}} Iterator over index */
@@ -10738,6 +11200,7 @@ vy_cursor_new(struct vy_tx *tx, struct vy_index *index, const char *key,
 	}
 	c->tx = tx;
 	c->start = tx->start;
+	c->start_time = clock_monotonic();
 	c->need_check_eq = false;
 	enum iterator_type iterator_type;
 	switch (type) {
@@ -10810,13 +11273,18 @@ vy_cursor_next(struct vy_cursor *c, struct tuple **result)
 	 */
 	if (def->iid == 0)
 		tuple_ref(vyresult);
-	return *result != NULL ? 0 : -1;
+	if (*result == NULL)
+		return -1;
+	index->stat.returned_bytes += tuple_bsize(*result);
+	return 0;
 }
 
 void
 vy_cursor_delete(struct vy_cursor *c)
 {
 	vy_read_iterator_close(&c->iterator);
+	vy_index_stat_read(&c->index->stat, c->index->stat.scan_latency,
+			   c->start_time, &c->iterator.run_stat);
 	struct vy_env *e = c->env;
 	if (c->tx != NULL) {
 		if (c->tx == &c->tx_autocommit) {
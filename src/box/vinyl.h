@@ -64,6 +64,13 @@ vy_env_new(void);
 void
 vy_env_delete(struct vy_env *e);
 
+/**
+ * Set the max number of vinyl worker threads (vinyl_threads).
+ * The pool is resized by the scheduler lazily.
+ */
+void
+vy_set_worker_pool_size(struct vy_env *env, int size);
+
 /*
  * Recovery
  */
@@ -171,6 +171,18 @@ VinylEngine::checkIndexDef(struct space *space, struct index_def *index_def)
 		          index_def->name,
 		          space_name(space));
 	}
+	if (index_def_is_functional(index_def)) {
+		tnt_raise(ClientError, ER_MODIFY_INDEX,
+			  index_def->name,
+			  space_name(space),
+			  "vinyl does not support functional indexes");
+	}
+	if (!index_def->opts.hint) {
+		tnt_raise(ClientError, ER_MODIFY_INDEX,
+			  index_def->name,
+			  space_name(space),
+			  "vinyl does not support hint option");
+	}
 }
 
 void
@@ -289,3 +301,9 @@ VinylEngine::backup(struct vclock *vclock, engine_backup_cb cb, void *arg)
 {
 	return vy_backup(env, vclock, cb, arg);
 }
+
+void
+VinylEngine::setWorkerPoolSize(int size)
+{
+	vy_set_worker_pool_size(env, size);
+}
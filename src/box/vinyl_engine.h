@@ -64,6 +64,8 @@ struct VinylEngine: public Engine {
 	virtual void collectGarbage(int64_t lsn) override;
 	virtual int backup(struct vclock *vclock,
 			   engine_backup_cb cb, void *arg) override;
+	/** Set the max number of worker threads. */
+	void setWorkerPoolSize(int size);
 public:
 	struct vy_env *env;
 };
@@ -31,12 +31,15 @@
 #include "vy_log.h"
 
 #include <assert.h>
+#include <errno.h>
 #include <limits.h>
 #include <stdbool.h>
 #include <stddef.h>
 #include <stdint.h>
+#include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <unistd.h>
 
 #include <msgpuck/msgpuck.h>
 #include <small/region.h>
@@ -46,6 +49,7 @@
 #include "coeio.h"
 #include "diag.h"
 #include "errcode.h"
+#include "errinj.h"
 #include "fiber.h"
 #include "iproto_constants.h" /* IPROTO_INSERT */
 #include "latch.h"
@@ -130,6 +134,19 @@ struct vy_recovery;
  */
 enum { VY_LOG_TX_BUF_SIZE = 64 };
 
+enum {
+	/**
+	 * Min number of records appended to the log since it was
+	 * last rotated or compacted to trigger compaction.
+	 */
+	VY_LOG_COMPACT_MIN_RECORDS = 10000,
+	/**
+	 * Compact the log when records appended to it outnumber
+	 * live objects by this factor.
+	 */
+	VY_LOG_COMPACT_RATIO = 4,
+};
+
 /** Metadata log object. */
 struct vy_log {
 	/** The directory where log files are stored. */
@@ -164,6 +181,15 @@ struct vy_log {
 	int tx_end;
 	/** Records awaiting to be written to disk. */
 	struct vy_log_record tx_buf[VY_LOG_TX_BUF_SIZE];
+	/**
+	 * Number of objects written to the current log file
+	 * when it was created, see vy_log_maybe_compact().
+	 */
+	int64_t snapshot_size;
+	/** Number of records appended to the current log file. */
+	int64_t tail_size;
+	/** Set while the log is being compacted. */
+	bool is_compacting;
 };
 static struct vy_log vy_log;
 
@@ -629,6 +655,7 @@ vy_log_flush(void)
 		return -1;
 
 	/* Success. Reset the buffer. */
+	vy_log.tail_size += vy_log.tx_end;
 	vy_log.tx_end = 0;
 	return 0;
 }
@@ -683,6 +710,9 @@ vy_log_bootstrap(void)
 	return rc;
 }
 
+static int64_t
+vy_recovery_size(struct vy_recovery *recovery);
+
 struct vy_recovery *
 vy_log_begin_recovery(const struct vclock *vclock)
 {
@@ -711,6 +741,8 @@ vy_log_begin_recovery(const struct vclock *vclock)
 
 	vy_log.next_range_id = recovery->range_id_max + 1;
 	vy_log.next_run_id = recovery->run_id_max + 1;
+	vy_log.snapshot_size = vy_recovery_size(recovery);
+	vy_log.tail_size = 0;
 
 	vy_log.recovery = recovery;
 	vclock_copy(&vy_log.last_checkpoint, vclock);
@@ -857,6 +889,7 @@ vy_log_rotate(const struct vclock *vclock)
 
 	/* Do actual work from coeio so as not to stall tx thread. */
 	int rc = coio_call(vy_log_rotate_f, recovery, vclock);
+	int64_t snapshot_size = vy_recovery_size(recovery);
 	vy_recovery_delete(recovery);
 	if (rc < 0) {
 		latch_unlock(&vy_log.latch);
@@ -870,6 +903,8 @@ vy_log_rotate(const struct vclock *vclock)
 	wal_rotate_vy_log();
 	vclock_copy(&vy_log.prev_checkpoint, &vy_log.last_checkpoint);
 	vclock_copy(&vy_log.last_checkpoint, vclock);
+	vy_log.snapshot_size = snapshot_size;
+	vy_log.tail_size = 0;
 
 	/* Add the new vclock to the xdir so that we can track it. */
 	xdir_add_vclock(&vy_log.dir, new_vclock);
@@ -902,7 +937,13 @@ vy_log_collect_garbage(int64_t signature)
 	 * it is still needed for backups.
 	 */
 	signature = MIN(signature, vclock_sum(&vy_log.prev_checkpoint));
+	/*
+	 * Files are removed from the xdir index, which may be
+	 * being read by vy_log_compact_f() at the same time.
+	 */
+	latch_lock(&vy_log.latch);
 	coio_call(vy_log_collect_garbage_f, signature);
+	latch_unlock(&vy_log.latch);
 }
 
 const char *
@@ -937,6 +978,9 @@ vy_log_tx_begin(void)
  * buffer on failure, so that the next transaction will retry to write
  * them to disk.
  */
+static void
+vy_log_maybe_compact(void);
+
 static int
 vy_log_tx_do_commit(bool no_discard)
 {
@@ -963,6 +1007,8 @@ out:
 	say_debug("%s(no_discard=%d): %s", __func__, no_discard,
 		  rc == 0 ? "success" : "fail");
 	latch_unlock(&vy_log.latch);
+	if (rc == 0)
+		vy_log_maybe_compact();
 	return rc;
 }
 
@@ -1439,17 +1485,15 @@ vy_recovery_process_record(struct vy_recovery *recovery,
 	return rc;
 }
 
-static ssize_t
-vy_recovery_new_f(va_list ap)
+/** Allocate an empty recovery context. */
+static struct vy_recovery *
+vy_recovery_alloc(void)
 {
-	int64_t recovery_signature = va_arg(ap, int64_t);
-	struct vy_recovery **p_recovery = va_arg(ap, struct vy_recovery **);
-
 	struct vy_recovery *recovery = malloc(sizeof(*recovery));
 	if (recovery == NULL) {
 		diag_set(OutOfMemory, sizeof(*recovery),
 			 "malloc", "struct vy_recovery");
-		goto fail;
+		return NULL;
 	}
 
 	recovery->index_hash = NULL;
@@ -1465,22 +1509,23 @@ vy_recovery_new_f(va_list ap)
 	    recovery->range_hash == NULL ||
 	    recovery->run_hash == NULL) {
 		diag_set(OutOfMemory, 0, "mh_i64ptr_new", "mh_i64ptr_t");
-		goto fail_free;
-	}
-
-	struct vclock vclock;
-	if (xdir_last_vclock(&vy_log.dir, &vclock) < 0) {
-		/* No log file, nothing to do. */
-		goto out;
+		vy_recovery_delete(recovery);
+		return NULL;
 	}
+	return recovery;
+}
 
-	struct xlog_cursor cursor;
-	if (xdir_open_cursor(&vy_log.dir, vclock_sum(&vclock), &cursor) < 0)
-		goto fail_free;
-
+/**
+ * Replay records having signatures < @recovery_signature
+ * read from @cursor. Return 0 on success, -1 on failure.
+ */
+static int
+vy_recovery_load(struct vy_recovery *recovery, struct xlog_cursor *cursor,
+		 int64_t recovery_signature)
+{
 	int rc;
 	struct xrow_header row;
-	while ((rc = xlog_cursor_next(&cursor, &row, true)) == 0) {
+	while ((rc = xlog_cursor_next(cursor, &row, true)) == 0) {
 		struct vy_log_record record;
 		rc = vy_log_record_decode(&record, &row);
 		if (rc < 0)
@@ -1491,20 +1536,47 @@ vy_recovery_new_f(va_list ap)
 		if (rc < 0)
 			break;
 	}
-	if (rc < 0)
-		goto fail_close;
+	return rc < 0 ? -1 : 0;
+}
 
-	xlog_cursor_close(&cursor, false);
-out:
-	*p_recovery = recovery;
-	return 0;
+/**
+ * Load a recovery context from the last log file.
+ * See vy_recovery_new().
+ */
+static struct vy_recovery *
+vy_recovery_new_from_log(int64_t recovery_signature)
+{
+	struct vy_recovery *recovery = vy_recovery_alloc();
+	if (recovery == NULL)
+		return NULL;
 
-fail_close:
+	struct vclock vclock;
+	if (xdir_last_vclock(&vy_log.dir, &vclock) < 0) {
+		/* No log file, nothing to do. */
+		return recovery;
+	}
+
+	struct xlog_cursor cursor;
+	if (xdir_open_cursor(&vy_log.dir, vclock_sum(&vclock), &cursor) < 0)
+		goto fail;
+	int rc = vy_recovery_load(recovery, &cursor, recovery_signature);
 	xlog_cursor_close(&cursor, false);
-fail_free:
-	vy_recovery_delete(recovery);
+	if (rc < 0)
+		goto fail;
+	return recovery;
 fail:
-	return -1;
+	vy_recovery_delete(recovery);
+	return NULL;
+}
+
+static ssize_t
+vy_recovery_new_f(va_list ap)
+{
+	int64_t recovery_signature = va_arg(ap, int64_t);
+	struct vy_recovery **p_recovery = va_arg(ap, struct vy_recovery **);
+
+	*p_recovery = vy_recovery_new_from_log(recovery_signature);
+	return *p_recovery != NULL ? 0 : -1;
 }
 
 struct vy_recovery *
@@ -1698,3 +1770,561 @@ vy_recovery_iterate(struct vy_recovery *recovery, bool include_deleted,
 	}
 	return 0;
 }
+
+/** Return the number of objects stored in a recovery context. */
+static int64_t
+vy_recovery_size(struct vy_recovery *recovery)
+{
+	return mh_size(recovery->index_hash) +
+	       mh_size(recovery->range_hash) +
+	       mh_size(recovery->run_hash);
+}
+
+/** Return the number of entries in a list. */
+static int
+vy_recovery_list_size(struct rlist *list)
+{
+	int size = 0;
+	for (struct rlist *link = list->next; link != list; link = link->next)
+		size++;
+	return size;
+}
+
+/** Return true if two vinyl runs are recovered in the same state. */
+static bool
+vy_run_recovery_info_equal(struct vy_run_recovery_info *a,
+			   struct vy_run_recovery_info *b)
+{
+	return a->id == b->id && a->is_deleted == b->is_deleted &&
+	       a->signature == b->signature;
+}
+
+/** Return true if two vinyl ranges are recovered in the same state. */
+static bool
+vy_range_recovery_info_equal(struct vy_range_recovery_info *a,
+			     struct vy_range_recovery_info *b)
+{
+	if (a->is_deleted != b->is_deleted ||
+	    a->signature != b->signature)
+		return false;
+	const char *a_end, *b_end;
+	a_end = a->begin;
+	b_end = b->begin;
+	mp_next(&a_end);
+	mp_next(&b_end);
+	if (a_end - a->begin != b_end - b->begin ||
+	    memcmp(a->begin, b->begin, a_end - a->begin) != 0)
+		return false;
+	a_end = a->end;
+	b_end = b->end;
+	mp_next(&a_end);
+	mp_next(&b_end);
+	if (a_end - a->end != b_end - b->end ||
+	    memcmp(a->end, b->end, a_end - a->end) != 0)
+		return false;
+	/* Runs must go in the same order. */
+	struct rlist *a_link = a->runs.next, *b_link = b->runs.next;
+	while (a_link != &a->runs && b_link != &b->runs) {
+		if (!vy_run_recovery_info_equal(
+			rlist_entry(a_link, struct vy_run_recovery_info,
+				    in_range),
+			rlist_entry(b_link, struct vy_run_recovery_info,
+				    in_range)))
+			return false;
+		a_link = a_link->next;
+		b_link = b_link->next;
+	}
+	return a_link == &a->runs && b_link == &b->runs;
+}
+
+/**
+ * Check that two recovery contexts describe the same set of
+ * indexes, ranges, and runs. The order of ranges in an index
+ * and the order of incomplete runs do not matter.
+ */
+static bool
+vy_recovery_equal(struct vy_recovery *a, struct vy_recovery *b)
+{
+	if (mh_size(a->index_hash) != mh_size(b->index_hash) ||
+	    mh_size(a->range_hash) != mh_size(b->range_hash) ||
+	    mh_size(a->run_hash) != mh_size(b->run_hash))
+		return false;
+	mh_int_t i;
+	mh_foreach(a->index_hash, i) {
+		struct vy_index_recovery_info *a_index, *b_index;
+		a_index = mh_i64ptr_node(a->index_hash, i)->val;
+		b_index = vy_recovery_lookup_index(b, a_index->index_lsn);
+		if (b_index == NULL ||
+		    a_index->index_id != b_index->index_id ||
+		    a_index->space_id != b_index->space_id ||
+		    a_index->is_dropped != b_index->is_dropped ||
+		    a_index->signature != b_index->signature ||
+		    strcmp(a_index->path, b_index->path) != 0)
+			return false;
+		struct vy_range_recovery_info *a_range, *b_range;
+		if (vy_recovery_list_size(&a_index->ranges) !=
+		    vy_recovery_list_size(&b_index->ranges))
+			return false;
+		rlist_foreach_entry(a_range, &a_index->ranges, in_index) {
+			b_range = vy_recovery_lookup_range(b, a_range->id);
+			if (b_range == NULL ||
+			    !vy_range_recovery_info_equal(a_range, b_range))
+				return false;
+		}
+		struct vy_run_recovery_info *a_run, *b_run;
+		if (vy_recovery_list_size(&a_index->incomplete_runs) !=
+		    vy_recovery_list_size(&b_index->incomplete_runs))
+			return false;
+		rlist_foreach_entry(a_run, &a_index->incomplete_runs,
+				    in_incomplete) {
+			b_run = vy_recovery_lookup_run(b, a_run->id);
+			if (b_run == NULL ||
+			    !vy_run_recovery_info_equal(a_run, b_run))
+				return false;
+		}
+	}
+	return true;
+}
+
+/** Write a log record to an xlog, used by vy_log_compact(). */
+static int
+vy_log_compact_write(struct xlog *xlog, const struct vy_log_record *record)
+{
+	say_debug("%s: %s", __func__, vy_log_record_str(record));
+	return vy_log_rotate_cb_func(record, xlog);
+}
+
+/** Return true if @run is linked in @range. */
+static bool
+vy_range_recovery_info_has_run(struct vy_range_recovery_info *range,
+			       struct vy_run_recovery_info *run)
+{
+	struct vy_run_recovery_info *it;
+	rlist_foreach_entry(it, &range->runs, in_range) {
+		if (it == run)
+			return true;
+	}
+	return false;
+}
+
+/**
+ * Write records that turn range @old_range of recovery context
+ * @old into range @new_range of recovery context @new. All
+ * records get @signature.
+ *
+ * Since the log was recovered from the file we are compacting,
+ * the only change possible for a range that exists in both
+ * contexts is appending newer runs, deleting runs, moving runs
+ * out to other ranges (coalescing), and deleting the range
+ * itself. Anything else is reported as an error.
+ */
+static int
+vy_log_compact_range(struct xlog *xlog, int64_t signature, int64_t index_lsn,
+		     struct vy_recovery *old, struct vy_recovery *new,
+		     struct vy_range_recovery_info *old_range,
+		     struct vy_range_recovery_info *new_range)
+{
+	struct vy_log_record record;
+	struct vy_run_recovery_info *run, *old_run;
+	const char *tmp;
+
+	record.signature = signature;
+	record.index_lsn = index_lsn;
+	record.range_id = new_range->id;
+
+	if (old_range == NULL) {
+		record.type = VY_LOG_INSERT_RANGE;
+		record.range_begin = tmp = new_range->begin;
+		if (mp_decode_array(&tmp) == 0)
+			record.range_begin = NULL;
+		record.range_end = tmp = new_range->end;
+		if (mp_decode_array(&tmp) == 0)
+			record.range_end = NULL;
+		record.is_level_zero = new_range->is_level_zero;
+		if (vy_log_compact_write(xlog, &record) != 0)
+			return -1;
+	}
+
+	/*
+	 * Runs that stayed in the range since the last checkpoint
+	 * must be the oldest ones, newer runs go first in the list.
+	 * Find the first run that is not new and check that the
+	 * rest of the list matches the old one.
+	 */
+	struct rlist *new_link = new_range->runs.next;
+	struct rlist *new_end = &new_range->runs;
+	if (old_range != NULL) {
+		struct rlist *old_link = old_range->runs.next;
+		while (new_link != &new_range->runs) {
+			run = rlist_entry(new_link, struct vy_run_recovery_info,
+					  in_range);
+			old_run = vy_recovery_lookup_run(old, run->id);
+			if (old_run != NULL &&
+			    vy_range_recovery_info_has_run(old_range, old_run))
+				break;
+			new_link = new_link->next;
+		}
+		new_end = new_link;
+		while (old_link != &old_range->runs) {
+			old_run = rlist_entry(old_link,
+					struct vy_run_recovery_info, in_range);
+			old_link = old_link->next;
+			run = vy_recovery_lookup_run(new, old_run->id);
+			if (run == NULL ||
+			    !vy_range_recovery_info_has_run(new_range, run))
+				continue; /* forgotten or moved out */
+			if (new_link == &new_range->runs ||
+			    run != rlist_entry(new_link,
+					struct vy_run_recovery_info, in_range))
+				goto inconsistent;
+			new_link = new_link->next;
+			if (old_run->is_deleted && !run->is_deleted)
+				goto inconsistent;
+			if (run->is_deleted && !old_run->is_deleted) {
+				record.type = VY_LOG_DELETE_RUN;
+				record.run_id = run->id;
+				if (vy_log_compact_write(xlog, &record) != 0)
+					return -1;
+			}
+		}
+		if (new_link != &new_range->runs)
+			goto inconsistent;
+	}
+
+	/* Insert new runs in the chronological order. */
+	for (new_link = new_end->prev; new_link != &new_range->runs;
+	     new_link = new_link->prev) {
+		run = rlist_entry(new_link, struct vy_run_recovery_info,
+				  in_range);
+		old_run = vy_recovery_lookup_run(old, run->id);
+		if (old_run != NULL && old_run->is_deleted)
+			goto inconsistent;
+		record.type = VY_LOG_INSERT_RUN;
+		record.run_id = run->id;
+		if (vy_log_compact_write(xlog, &record) != 0)
+			return -1;
+		if (run->is_deleted) {
+			record.type = VY_LOG_DELETE_RUN;
+			if (vy_log_compact_write(xlog, &record) != 0)
+				return -1;
+		}
+	}
+
+	if (new_range->is_deleted &&
+	    (old_range == NULL || !old_range->is_deleted)) {
+		record.type = VY_LOG_DELETE_RANGE;
+		if (vy_log_compact_write(xlog, &record) != 0)
+			return -1;
+	}
+	return 0;
+
+inconsistent:
+	diag_set(ClientError, ER_VINYL, "unexpected vinyl range state");
+	return -1;
+}
+
+/**
+ * Write records that turn index @old_index of recovery context
+ * @old into index @new_index of recovery context @new. Either
+ * of the indexes may be NULL. All records get @signature.
+ */
+static int
+vy_log_compact_index(struct xlog *xlog, int64_t signature,
+		     struct vy_recovery *old, struct vy_recovery *new,
+		     struct vy_index_recovery_info *old_index,
+		     struct vy_index_recovery_info *new_index)
+{
+	if (old_index == NULL) {
+		/* The index was created after the last checkpoint. */
+		return vy_recovery_do_iterate_index(new_index, true,
+						    vy_log_rotate_cb_func, xlog);
+	}
+
+	int64_t index_lsn = old_index->index_lsn;
+	struct vy_range_recovery_info *range, *old_range;
+	struct vy_run_recovery_info *run, *old_run;
+	struct vy_log_record record;
+	record.signature = signature;
+	record.index_lsn = index_lsn;
+
+	if (new_index != NULL) {
+		/* Preserve the order of new ranges. */
+		rlist_foreach_entry_reverse(range, &new_index->ranges,
+					    in_index) {
+			old_range = vy_recovery_lookup_range(old, range->id);
+			if (vy_log_compact_range(xlog, signature, index_lsn,
+						 old, new, old_range,
+						 range) != 0)
+				return -1;
+		}
+		rlist_foreach_entry_reverse(run, &new_index->incomplete_runs,
+					    in_incomplete) {
+			old_run = vy_recovery_lookup_run(old, run->id);
+			record.run_id = run->id;
+			if (old_run == NULL) {
+				record.type = VY_LOG_PREPARE_RUN;
+				if (vy_log_compact_write(xlog, &record) != 0)
+					return -1;
+			}
+			if (run->is_deleted &&
+			    (old_run == NULL || !old_run->is_deleted)) {
+				record.type = VY_LOG_DELETE_RUN;
+				if (vy_log_compact_write(xlog, &record) != 0)
+					return -1;
+			}
+		}
+	}
+
+	/* Delete ranges that were freed after the last checkpoint. */
+	rlist_foreach_entry(old_range, &old_index->ranges, in_index) {
+		if (old_range->is_deleted ||
+		    vy_recovery_lookup_range(new, old_range->id) != NULL)
+			continue;
+		record.type = VY_LOG_DELETE_RANGE;
+		record.range_id = old_range->id;
+		if (vy_log_compact_write(xlog, &record) != 0)
+			return -1;
+	}
+
+	if (!old_index->is_dropped &&
+	    (new_index == NULL || new_index->is_dropped)) {
+		record.type = VY_LOG_DROP_INDEX;
+		if (vy_log_compact_write(xlog, &record) != 0)
+			return -1;
+	}
+	return 0;
+}
+
+/**
+ * Write a compacted metadata log to @xlog. First, the state
+ * as of the last checkpoint (@old) is written, so that records
+ * having signatures < @signature still produce the same
+ * recovery context. Then records that bring it to the current
+ * state (@new) are appended with @signature.
+ */
+static int
+vy_log_compact_write_all(struct xlog *xlog, int64_t signature,
+			 struct vy_recovery *old, struct vy_recovery *new)
+{
+	if (vy_recovery_iterate(old, true, vy_log_rotate_cb_func, xlog) < 0)
+		return -1;
+
+	struct vy_log_record record;
+	record.type = VY_LOG_FORGET_RUN;
+	record.signature = signature;
+
+	mh_int_t i;
+	/* Forget runs first so that their ranges can be freed. */
+	mh_foreach(old->run_hash, i) {
+		record.run_id = mh_i64ptr_node(old->run_hash, i)->key;
+		if (vy_recovery_lookup_run(new, record.run_id) != NULL)
+			continue;
+		if (vy_log_compact_write(xlog, &record) != 0)
+			return -1;
+	}
+	mh_foreach(new->index_hash, i) {
+		struct vy_index_recovery_info *index;
+		index = mh_i64ptr_node(new->index_hash, i)->val;
+		if (vy_log_compact_index(xlog, signature, old, new,
+				vy_recovery_lookup_index(old, index->index_lsn),
+				index) != 0)
+			return -1;
+	}
+	mh_foreach(old->index_hash, i) {
+		struct vy_index_recovery_info *index;
+		index = mh_i64ptr_node(old->index_hash, i)->val;
+		if (vy_recovery_lookup_index(new, index->index_lsn) != NULL)
+			continue;
+		if (vy_log_compact_index(xlog, signature, old, new,
+					 index, NULL) != 0)
+			return -1;
+	}
+	return 0;
+}
+
+/**
+ * Check that the compacted log file @path produces the same
+ * recovery contexts as the original one.
+ */
+static int
+vy_log_compact_check(const char *path, int64_t signature,
+		     struct vy_recovery *old, struct vy_recovery *new)
+{
+	struct vy_recovery *check[2] = { NULL, NULL };
+	int64_t check_signature[2] = { signature, INT64_MAX };
+	struct vy_recovery *expected[2] = { old, new };
+	int rc = -1;
+
+	for (int i = 0; i < 2; i++) {
+		struct xlog_cursor cursor;
+		check[i] = vy_recovery_alloc();
+		if (check[i] == NULL)
+			goto out;
+		if (xlog_cursor_open(&cursor, path) < 0)
+			goto out;
+		int load_rc = vy_recovery_load(check[i], &cursor,
+					       check_signature[i]);
+		xlog_cursor_close(&cursor, false);
+		if (load_rc < 0)
+			goto out;
+		if (!vy_recovery_equal(check[i], expected[i])) {
+			diag_set(ClientError, ER_VINYL,
+				 "compacted metadata log does not match "
+				 "the original one");
+			goto out;
+		}
+	}
+	rc = 0;
+out:
+	for (int i = 0; i < 2; i++) {
+		if (check[i] != NULL)
+			vy_recovery_delete(check[i]);
+	}
+	return rc;
+}
+
+static ssize_t
+vy_log_compact_f(va_list ap)
+{
+	const struct vclock *vclock = va_arg(ap, const struct vclock *);
+	int64_t *p_size = va_arg(ap, int64_t *);
+	int64_t signature = vclock_sum(vclock);
+	struct vy_recovery *old = NULL, *new = NULL;
+	char path[PATH_MAX], tmp_name[PATH_MAX], tmp_path[PATH_MAX];
+	struct xlog xlog;
+	int rc = -1;
+
+	snprintf(path, sizeof(path), "%s",
+		 xdir_format_filename(&vy_log.dir, signature, NONE));
+	snprintf(tmp_name, sizeof(tmp_name), "%s.compact", path);
+
+	struct vclock last_vclock;
+	if (xdir_last_vclock(&vy_log.dir, &last_vclock) < 0 ||
+	    vclock_sum(&last_vclock) != signature) {
+		diag_set(ClientError, ER_VINYL,
+			 "metadata log does not match last checkpoint");
+		goto out;
+	}
+
+	/* Load the state as of the last checkpoint and the current one. */
+	old = vy_recovery_new_from_log(signature);
+	if (old == NULL)
+		goto out;
+	new = vy_recovery_new_from_log(INT64_MAX);
+	if (new == NULL)
+		goto out;
+
+	struct xlog_meta meta;
+	snprintf(meta.filetype, sizeof(meta.filetype), "%s",
+		 vy_log.dir.filetype);
+	meta.instance_uuid = *vy_log.dir.instance_uuid;
+	vclock_copy(&meta.vclock, vclock);
+
+	/* Remove the file left from a failed compaction, if any. */
+	snprintf(tmp_path, sizeof(tmp_path), "%s.inprogress", tmp_name);
+	if (unlink(tmp_path) < 0 && errno != ENOENT)
+		say_syserror("failed to delete file '%s'", tmp_path);
+	if (xlog_create(&xlog, tmp_name, &meta) < 0)
+		goto out;
+	if (vy_log_compact_write_all(&xlog, signature, old, new) < 0 ||
+	    xlog_flush(&xlog) < 0) {
+		xlog_close(&xlog, false);
+		goto out_unlink;
+	}
+	if (xlog_close(&xlog, false) < 0) {
+		diag_set(SystemError, "failed to write file '%s'", tmp_path);
+		goto out_unlink;
+	}
+
+	if (vy_log_compact_check(tmp_path, signature, old, new) < 0)
+		goto out_unlink;
+
+	/* Atomically replace the current log file. */
+	if (rename(tmp_path, path) != 0) {
+		diag_set(SystemError, "failed to rename '%s' file", tmp_path);
+		goto out_unlink;
+	}
+	*p_size = vy_recovery_size(new);
+	rc = 0;
+	goto out;
+
+out_unlink:
+	if (unlink(tmp_path) < 0)
+		say_syserror("failed to delete file '%s'", tmp_path);
+out:
+	if (old != NULL)
+		vy_recovery_delete(old);
+	if (new != NULL)
+		vy_recovery_delete(new);
+	return rc;
+}
+
+int
+vy_log_compact(void)
+{
+	assert(vy_log.recovery == NULL);
+	say_debug("%s", __func__);
+
+	/*
+	 * Lock out all concurrent log writers while we are
+	 * rewriting the log, see also vy_log_rotate().
+	 */
+	latch_lock(&vy_log.latch);
+
+	int64_t size = 0;
+	int rc = vy_log_flush();
+	if (rc == 0) {
+		/* Do actual work from coeio so as not to stall tx thread. */
+		rc = coio_call(vy_log_compact_f, &vy_log.last_checkpoint,
+			       &size);
+	}
+	if (rc == 0) {
+		/*
+		 * Reopen the log file on the next write, as
+		 * the old one was replaced.
+		 */
+		wal_rotate_vy_log();
+		say_info("compacted metadata log: %lld records replaced "
+			 "with %lld", (long long)(vy_log.snapshot_size +
+						  vy_log.tail_size),
+			 (long long)size);
+		vy_log.snapshot_size = size;
+		vy_log.tail_size = 0;
+	} else {
+		say_error("failed to compact metadata log: %s",
+			  diag_last_error(diag_get())->errmsg);
+	}
+
+	latch_unlock(&vy_log.latch);
+	return rc;
+}
+
+static int
+vy_log_compact_fiber_f(va_list ap)
+{
+	(void)ap;
+	vy_log_compact();
+	vy_log.is_compacting = false;
+	return 0;
+}
+
+static void
+vy_log_maybe_compact(void)
+{
+	if (vy_log.is_compacting || vy_log.recovery != NULL)
+		return;
+	bool force = false;
+	ERROR_INJECT_ONCE(ERRINJ_VY_LOG_COMPACT, force = true);
+	if (!force && (vy_log.tail_size < VY_LOG_COMPACT_MIN_RECORDS ||
+		       vy_log.tail_size < VY_LOG_COMPACT_RATIO *
+					  vy_log.snapshot_size))
+		return;
+	struct fiber *f = fiber_new("vinyl.log_compact",
+				    vy_log_compact_fiber_f);
+	if (f == NULL) {
+		diag_log();
+		return;
+	}
+	vy_log.is_compacting = true;
+	fiber_start(f);
+}
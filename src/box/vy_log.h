@@ -199,6 +199,23 @@ vy_log_open(struct xlog *xlog);
 int
 vy_log_rotate(const struct vclock *vclock);
 
+/**
+ * Compact the current metadata log file in place. This function
+ * rewrites the file so that it contains records required to
+ * recover the state as of the last checkpoint followed by records
+ * required to bring it to the current state, discarding records
+ * cancelling each other. The new file is checked to produce the
+ * same recovery contexts before it replaces the old one.
+ *
+ * The log is compacted automatically in the background when
+ * the number of records appended to it since it was rotated
+ * grows too large compared to the number of live objects.
+ *
+ * Returns 0 on success, -1 on failure.
+ */
+int
+vy_log_compact(void);
+
 /**
  * Remove metadata log files that are not needed to recover
  * from the snapshot with the given signature or newer.
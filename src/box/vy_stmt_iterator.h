@@ -122,8 +122,26 @@ struct vy_iterator_stat {
 	size_t step_count;
 	/* Number of searches avoided using bloom filter */
 	size_t bloom_reflections;
+	/* Number of pages read from disk */
+	size_t read_count;
+	/* Number of bytes read from disk (compressed) */
+	size_t read_bytes;
 };
 
+/**
+ * Add usage statistics accumulated in @src to @dst.
+ */
+static inline void
+vy_iterator_stat_add(struct vy_iterator_stat *dst,
+		     const struct vy_iterator_stat *src)
+{
+	dst->lookup_count += src->lookup_count;
+	dst->step_count += src->step_count;
+	dst->bloom_reflections += src->bloom_reflections;
+	dst->read_count += src->read_count;
+	dst->read_bytes += src->read_bytes;
+}
+
 #if defined(__cplusplus)
 } /* extern "C" */
 #endif /* defined(__cplusplus) */
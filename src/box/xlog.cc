@@ -77,6 +77,13 @@ enum {
 	 * Maybe this should be a configuration option.
 	 */
 	XLOG_TX_COMPRESS_THRESHOLD = 2 * 1024,
+	/**
+	 * Alignment of buffers, file offsets and sizes of
+	 * writes issued to a file open with O_DIRECT.
+	 */
+	XLOG_DIO_ALIGN = 4096,
+	/** Size of the staging buffer for O_DIRECT writes. */
+	XLOG_DIO_BUF_SIZE = 1024 * 1024,
 };
 
 const struct type type_XlogError = make_type("XlogError", &type_Exception);
@@ -705,10 +712,189 @@ xlog_destroy(struct xlog *xlog)
 	obuf_destroy(&xlog->obuf);
 	obuf_destroy(&xlog->zbuf);
 	ZSTD_freeCCtx(xlog->zctx);
+	free(xlog->dio_buf);
 	TRASH(xlog);
 	xlog->fd = -1;
 }
 
+/**
+ * Write whole XLOG_DIO_ALIGN blocks accumulated in the direct
+ * I/O buffer to disk. If @flush_tail is set, the unaligned tail
+ * is written as well, padded with zeros, and the padding is cut
+ * off with ftruncate(). The tail is retained in the buffer in
+ * order to be rewritten along with the data appended later.
+ *
+ * @retval 0 for ok
+ * @retval -1 for error
+ */
+static int
+xlog_dio_flush(struct xlog *log, bool flush_tail)
+{
+	size_t len = log->dio_used & ~((size_t)XLOG_DIO_ALIGN - 1);
+	size_t tail = log->dio_used - len;
+	if (flush_tail && tail > 0) {
+		memset(log->dio_buf + log->dio_used, 0, XLOG_DIO_ALIGN - tail);
+		len += XLOG_DIO_ALIGN;
+	}
+	if (len == 0)
+		return 0;
+	if (fio_pwriten(log->fd, log->dio_buf, len, log->dio_offset) < 0) {
+		diag_set(SystemError, "failed to write to '%s' file",
+			 log->filename);
+		return -1;
+	}
+	if (flush_tail && tail > 0) {
+		if (ftruncate(log->fd, log->dio_offset + log->dio_used) != 0) {
+			diag_set(SystemError, "failed to truncate '%s' file",
+				 log->filename);
+			return -1;
+		}
+		len -= XLOG_DIO_ALIGN;
+	}
+	if (len > 0) {
+		memmove(log->dio_buf, log->dio_buf + len, tail);
+		log->dio_offset += len;
+		log->dio_used = tail;
+	}
+	return 0;
+}
+
+/**
+ * Append data to the file. In the direct I/O mode the data is
+ * copied to the aligned staging buffer, which is written to disk
+ * as it fills up.
+ *
+ * @retval >= 0 the number of bytes written
+ * @retval -1 for error
+ */
+static ssize_t
+xlog_writev(struct xlog *log, struct iovec *iov, int iovcnt)
+{
+	if (log->dio_buf == NULL) {
+		ssize_t written = fio_writevn(log->fd, iov, iovcnt);
+		if (written < 0)
+			diag_set(SystemError, "failed to write to '%s' file",
+				 log->filename);
+		return written;
+	}
+	ssize_t written = 0;
+	for (int i = 0; i < iovcnt; i++) {
+		const char *data = (const char *)iov[i].iov_base;
+		size_t len = iov[i].iov_len;
+		while (len > 0) {
+			size_t n = MIN(len, XLOG_DIO_BUF_SIZE - log->dio_used);
+			memcpy(log->dio_buf + log->dio_used, data, n);
+			log->dio_used += n;
+			data += n;
+			len -= n;
+			written += n;
+			if (log->dio_used == (size_t)XLOG_DIO_BUF_SIZE &&
+			    xlog_dio_flush(log, false) != 0)
+				return -1;
+		}
+	}
+	return written;
+}
+
+/**
+ * Drop data written past the given file offset, e.g. after
+ * a failed write. In the direct I/O mode the staging buffer
+ * is reloaded so that it ends exactly at @offset.
+ */
+static int
+xlog_truncate(struct xlog *log, off_t offset)
+{
+	if (ftruncate(log->fd, offset) != 0)
+		return -1;
+	if (log->dio_buf == NULL)
+		return lseek(log->fd, offset, SEEK_SET) < 0 ? -1 : 0;
+	off_t block = offset & ~((off_t)XLOG_DIO_ALIGN - 1);
+	if (block >= log->dio_offset &&
+	    offset <= log->dio_offset + (off_t)log->dio_used) {
+		/* The data is still in the buffer. */
+		memmove(log->dio_buf, log->dio_buf + (block - log->dio_offset),
+			offset - block);
+	} else if (offset > block &&
+		   fio_pread(log->fd, log->dio_buf, XLOG_DIO_ALIGN,
+			     block) < offset - block) {
+		return -1;
+	}
+	log->dio_offset = block;
+	log->dio_used = offset - block;
+	return 0;
+}
+
+int
+xlog_set_direct_io(struct xlog *xlog)
+{
+	assert(xlog->dio_buf == NULL);
+	assert(xlog->offset < XLOG_DIO_ALIGN);
+#ifdef O_DIRECT
+	int flags = fcntl(xlog->fd, F_GETFL);
+	if (flags < 0) {
+		diag_set(SystemError, "%s: fcntl failed", xlog->filename);
+		return -1;
+	}
+	char *buf;
+	if (posix_memalign((void **)&buf, XLOG_DIO_ALIGN,
+			   XLOG_DIO_BUF_SIZE) != 0) {
+		diag_set(OutOfMemory, XLOG_DIO_BUF_SIZE, "posix_memalign",
+			 "xlog direct i/o buffer");
+		return -1;
+	}
+	if (fcntl(xlog->fd, F_SETFL, flags | O_DIRECT) != 0) {
+		/* E.g. tmpfs doesn't support O_DIRECT. */
+		say_warn("%s: direct I/O is not supported, "
+			 "falling back to buffered I/O", xlog->filename);
+		free(buf);
+		return 0;
+	}
+	/*
+	 * The meta has already been written to the file.
+	 * Load it to the buffer so that the first block is
+	 * rewritten as a whole.
+	 */
+	if (xlog->offset > 0 &&
+	    fio_pread(xlog->fd, buf, XLOG_DIO_ALIGN, 0) < xlog->offset) {
+		diag_set(SystemError, "%s: failed to read xlog meta",
+			 xlog->filename);
+		fcntl(xlog->fd, F_SETFL, flags);
+		free(buf);
+		return -1;
+	}
+	xlog->dio_buf = buf;
+	xlog->dio_offset = 0;
+	xlog->dio_used = xlog->offset;
+	/* Data bypasses the page cache, no need to free it. */
+	xlog->free_cache = false;
+#endif /* O_DIRECT */
+	return 0;
+}
+
+/**
+ * Write out the direct I/O buffer and switch the file
+ * descriptor back to the buffered mode, so that the file
+ * can be read without alignment restrictions.
+ */
+static int
+xlog_dio_finish(struct xlog *log)
+{
+	if (log->dio_buf == NULL)
+		return 0;
+	int rc = xlog_dio_flush(log, true);
+#ifdef O_DIRECT
+	int flags = fcntl(log->fd, F_GETFL);
+	if (flags < 0 || fcntl(log->fd, F_SETFL, flags & ~O_DIRECT) != 0) {
+		diag_set(SystemError, "%s: fcntl failed", log->filename);
+		rc = -1;
+	}
+#endif /* O_DIRECT */
+	free(log->dio_buf);
+	log->dio_buf = NULL;
+	log->dio_used = 0;
+	return rc;
+}
+
 int
 xlog_create(struct xlog *xlog, const char *name,
 	    const struct xlog_meta *meta)
@@ -885,6 +1071,39 @@ xdir_create_xlog(struct xdir *dir, struct xlog *xlog,
 	return 0;
 }
 
+/**
+ * Populate the fixheader of an xlog transaction.
+ *
+ * @param fixheader  XLOG_FIXHEADER_SIZE bytes to fill
+ * @param magic      row_marker or zrow_marker
+ * @param len        size of the transaction data
+ * @param crc32c     checksum of the transaction data
+ */
+static void
+xlog_tx_encode_fixheader(char *fixheader, log_magic_t magic,
+			 size_t len, uint32_t crc32c)
+{
+	*(log_magic_t *)fixheader = magic;
+	char *data = fixheader + sizeof(log_magic_t);
+	data = mp_encode_uint(data, len);
+	/* Encode crc32 for previous row */
+	data = mp_encode_uint(data, 0);
+	/* Encode crc32 for current row */
+	data = mp_encode_uint(data, crc32c);
+	/*
+	 * Encode a padding, to ensure the resulting
+	 * fixheader always has the same size.
+	 */
+	ssize_t padding = XLOG_FIXHEADER_SIZE - (data - fixheader);
+	if (padding > 0) {
+		data = mp_encode_strl(data, padding - 1);
+		if (padding > 1) {
+			memset(data, 0, padding - 1);
+			data += padding - 1;
+		}
+	}
+}
+
 /**
  * Write a sequence of uncompressed xrow objects.
  *
@@ -899,14 +1118,6 @@ xlog_tx_write_plain(struct xlog *log)
 	 * now populate it with data.
 	 */
 	char *fixheader = (char *)log->obuf.iov[0].iov_base;
-	*(log_magic_t *)fixheader = row_marker;
-	char *data = fixheader + sizeof(log_magic_t);
-
-	data = mp_encode_uint(data,
-			      obuf_size(&log->obuf) - XLOG_FIXHEADER_SIZE);
-	/* Encode crc32 for previous row */
-	data = mp_encode_uint(data, 0);
-	/* Encode crc32 for current row */
 	uint32_t crc32c = 0;
 	struct iovec *iov;
 	size_t offset = XLOG_FIXHEADER_SIZE;
@@ -916,31 +1127,18 @@ xlog_tx_write_plain(struct xlog *log)
 				    iov->iov_len - offset);
 		offset = 0;
 	}
-	data = mp_encode_uint(data, crc32c);
-	/*
-	 * Encode a padding, to ensure the resulting
-	 * fixheader always has the same size.
-	 */
-	ssize_t padding = XLOG_FIXHEADER_SIZE - (data - fixheader);
-	if (padding > 0) {
-		data = mp_encode_strl(data, padding - 1);
-		if (padding > 1) {
-			memset(data, 0, padding - 1);
-			data += padding - 1;
-		}
-	}
+	xlog_tx_encode_fixheader(fixheader, row_marker,
+				 obuf_size(&log->obuf) - XLOG_FIXHEADER_SIZE,
+				 crc32c);
 
 	ERROR_INJECT(ERRINJ_WAL_WRITE_DISK, {
 		diag_set(ClientError, ER_INJECTION, "xlog write injection");
 		return -1;
 	});
 
-	ssize_t written = fio_writevn(log->fd, log->obuf.iov, log->obuf.pos + 1);
-	if (written < 0) {
-		diag_set(SystemError, "failed to write to '%s' file",
-			 log->filename);
+	ssize_t written = xlog_writev(log, log->obuf.iov, log->obuf.pos + 1);
+	if (written < 0)
 		return -1;
-	}
 	return obuf_size(&log->obuf);
 }
 
@@ -998,25 +1196,9 @@ xlog_tx_write_zstd(struct xlog *log)
 		offset = 0;
 	}
 
-	*(log_magic_t *)fixheader = zrow_marker;
-	char *data;
-	data = fixheader + sizeof(log_magic_t);
-	data = mp_encode_uint(data,
-			      obuf_size(&log->zbuf) - XLOG_FIXHEADER_SIZE);
-	/* Encode crc32 for previous row */
-	data = mp_encode_uint(data, 0);
-	/* Encode crc32 for current row */
-	data = mp_encode_uint(data, crc32c);
-	/* Encode padding */
-	ssize_t padding;
-	padding = XLOG_FIXHEADER_SIZE - (data - fixheader);
-	if (padding > 0) {
-		data = mp_encode_strl(data, padding - 1);
-		if (padding > 1) {
-			memset(data, 0, padding - 1);
-			data += padding - 1;
-		}
-	}
+	xlog_tx_encode_fixheader(fixheader, zrow_marker,
+				 obuf_size(&log->zbuf) - XLOG_FIXHEADER_SIZE,
+				 crc32c);
 
 	ERROR_INJECT(ERRINJ_WAL_WRITE_DISK, {
 		diag_set(ClientError, ER_INJECTION, "xlog write injection");
@@ -1025,13 +1207,9 @@ xlog_tx_write_zstd(struct xlog *log)
 	});
 	ssize_t written;
 
-	written = fio_writevn(log->fd, log->zbuf.iov,
-			      log->zbuf.pos + 1);
-	if (written < 0) {
-		diag_set(SystemError, "failed to write to '%s' file",
-			 log->filename);
+	written = xlog_writev(log, log->zbuf.iov, log->zbuf.pos + 1);
+	if (written < 0)
 		goto error;
-	}
 	obuf_reset(&log->zbuf);
 	return written;
 error:
@@ -1045,37 +1223,12 @@ error:
 #define SYNC_ROUND_UP(size)	(SYNC_ROUND_DOWN(size + SYNC_MASK))
 
 /**
- * Writes xlog batch to file
+ * Sync data written to an xlog file if the sync interval
+ * is exceeded and throttle writes according to the rate limit.
  */
-static ssize_t
-xlog_tx_write(struct xlog *log)
+static void
+xlog_tx_sync(struct xlog *log)
 {
-	if (obuf_size(&log->obuf) == XLOG_FIXHEADER_SIZE)
-		return 0;
-	ssize_t written;
-
-	if (obuf_size(&log->obuf) >= XLOG_TX_COMPRESS_THRESHOLD) {
-		written = xlog_tx_write_zstd(log);
-	} else {
-		written = xlog_tx_write_plain(log);
-	}
-	ERROR_INJECT(ERRINJ_WAL_WRITE, written = -1;);
-
-	obuf_reset(&log->obuf);
-	/*
-	 * Simplify recovery after a temporary write failure:
-	 * truncate the file to the best known good write
-	 * position.
-	 */
-	if (written < 0) {
-		if (lseek(log->fd, log->offset, SEEK_SET) < 0 ||
-		    ftruncate(log->fd, log->offset) != 0)
-			panic_syserror("failed to truncate xlog after write error");
-		return -1;
-	}
-	log->offset += written;
-	log->rows += log->tx_rows;
-	log->tx_rows = 0;
 	if ((log->sync_interval && log->offset >=
 	    (off_t)(log->synced_size + log->sync_interval)) ||
 	    (log->rate_limit && log->offset >=
@@ -1112,6 +1265,40 @@ xlog_tx_write(struct xlog *log)
 		}
 		log->synced_size = log->offset;
 	}
+}
+
+/**
+ * Writes xlog batch to file
+ */
+static ssize_t
+xlog_tx_write(struct xlog *log)
+{
+	if (obuf_size(&log->obuf) == XLOG_FIXHEADER_SIZE)
+		return 0;
+	ssize_t written;
+
+	if (obuf_size(&log->obuf) >= XLOG_TX_COMPRESS_THRESHOLD) {
+		written = xlog_tx_write_zstd(log);
+	} else {
+		written = xlog_tx_write_plain(log);
+	}
+	ERROR_INJECT(ERRINJ_WAL_WRITE, written = -1;);
+
+	obuf_reset(&log->obuf);
+	/*
+	 * Simplify recovery after a temporary write failure:
+	 * truncate the file to the best known good write
+	 * position.
+	 */
+	if (written < 0) {
+		if (xlog_truncate(log, log->offset) != 0)
+			panic_syserror("failed to truncate xlog after write error");
+		return -1;
+	}
+	log->offset += written;
+	log->rows += log->tx_rows;
+	log->tx_rows = 0;
+	xlog_tx_sync(log);
 	return written;
 }
 
@@ -1221,6 +1408,154 @@ xlog_flush(struct xlog *log)
 	return xlog_tx_write(log);
 }
 
+int
+xlog_block_create(struct xlog_block *block)
+{
+	memset(block, 0, sizeof(*block));
+	block->zctx = ZSTD_createCCtx();
+	if (block->zctx == NULL) {
+		diag_set(ClientError, ER_COMPRESSION,
+			 "failed to create context");
+		return -1;
+	}
+	xlog_block_reset(block);
+	return 0;
+}
+
+void
+xlog_block_destroy(struct xlog_block *block)
+{
+	ZSTD_freeCCtx(block->zctx);
+	free(block->data);
+	free(block->zdata);
+	TRASH(block);
+}
+
+void
+xlog_block_reset(struct xlog_block *block)
+{
+	/* Leave room for the fixheader, @sa xlog_block_seal(). */
+	block->data_size = XLOG_FIXHEADER_SIZE;
+	block->rows = 0;
+	block->out = NULL;
+	block->out_size = 0;
+}
+
+bool
+xlog_block_is_full(const struct xlog_block *block)
+{
+	return block->data_size >= XLOG_TX_AUTOCOMMIT_THRESHOLD;
+}
+
+/** Make sure the block has room for @a size more bytes of data. */
+static int
+xlog_block_reserve(struct xlog_block *block, size_t size)
+{
+	if (block->data_size + size <= block->data_capacity)
+		return 0;
+	size_t capacity = MAX(block->data_capacity * 2,
+			      block->data_size + size);
+	capacity = MAX(capacity, (size_t)XLOG_TX_AUTOCOMMIT_THRESHOLD);
+	char *data = (char *)realloc(block->data, capacity);
+	if (data == NULL) {
+		diag_set(OutOfMemory, capacity, "realloc", "xlog block");
+		return -1;
+	}
+	block->data = data;
+	block->data_capacity = capacity;
+	return 0;
+}
+
+int
+xlog_block_add_row(struct xlog_block *block, const struct xrow_header *packet)
+{
+	assert(block->out == NULL);
+	struct iovec iov[XROW_IOVMAX];
+	int iovcnt = xrow_header_encode(packet, iov, 0);
+	if (iovcnt < 0)
+		return -1;
+	assert(iovcnt <= XROW_IOVMAX);
+	size_t size = 0;
+	for (int i = 0; i < iovcnt; i++)
+		size += iov[i].iov_len;
+	if (xlog_block_reserve(block, size) != 0)
+		return -1;
+	for (int i = 0; i < iovcnt; i++) {
+		memcpy(block->data + block->data_size,
+		       iov[i].iov_base, iov[i].iov_len);
+		block->data_size += iov[i].iov_len;
+	}
+	block->rows++;
+	return 0;
+}
+
+int
+xlog_block_seal(struct xlog_block *block)
+{
+	assert(block->out == NULL);
+	assert(block->data_size > XLOG_FIXHEADER_SIZE);
+	const char *data = block->data + XLOG_FIXHEADER_SIZE;
+	size_t len = block->data_size - XLOG_FIXHEADER_SIZE;
+
+	if (block->data_size < XLOG_TX_COMPRESS_THRESHOLD) {
+		xlog_tx_encode_fixheader(block->data, row_marker, len,
+					 crc32_calc(0, data, len));
+		block->out = block->data;
+		block->out_size = block->data_size;
+		return 0;
+	}
+
+	size_t zmax_size = XLOG_FIXHEADER_SIZE + ZSTD_compressBound(len);
+	if (zmax_size > block->zdata_capacity) {
+		char *zdata = (char *)realloc(block->zdata, zmax_size);
+		if (zdata == NULL) {
+			diag_set(OutOfMemory, zmax_size, "realloc",
+				 "compression buffer");
+			return -1;
+		}
+		block->zdata = zdata;
+		block->zdata_capacity = zmax_size;
+	}
+	char *zdst = block->zdata + XLOG_FIXHEADER_SIZE;
+	/* 3 is compression level. */
+	size_t zsize = ZSTD_compressCCtx(block->zctx, zdst,
+					 zmax_size - XLOG_FIXHEADER_SIZE,
+					 data, len, 3);
+	if (ZSTD_isError(zsize)) {
+		diag_set(ClientError, ER_COMPRESSION,
+			 ZSTD_getErrorName(zsize));
+		return -1;
+	}
+	xlog_tx_encode_fixheader(block->zdata, zrow_marker, zsize,
+				 crc32_calc(0, zdst, zsize));
+	block->out = block->zdata;
+	block->out_size = XLOG_FIXHEADER_SIZE + zsize;
+	return 0;
+}
+
+ssize_t
+xlog_write_block(struct xlog *log, struct xlog_block *block)
+{
+	assert(block->out != NULL);
+	/* Preserve the order of rows written with xlog_write_row(). */
+	if (xlog_flush(log) < 0)
+		return -1;
+	struct iovec iov;
+	iov.iov_base = (void *)block->out;
+	iov.iov_len = block->out_size;
+	ssize_t written = xlog_writev(log, &iov, 1);
+	ERROR_INJECT(ERRINJ_WAL_WRITE, written = -1;);
+	if (written < 0) {
+		if (xlog_truncate(log, log->offset) != 0)
+			panic_syserror("failed to truncate xlog after write error");
+		return -1;
+	}
+	log->offset += written;
+	log->rows += block->rows;
+	xlog_tx_sync(log);
+	return written;
+}
+
 static int
 sync_cb(eio_req *req)
 {
@@ -1238,6 +1573,11 @@ sync_cb(eio_req *req)
 int
 xlog_sync(struct xlog *l)
 {
+	if (l->dio_buf != NULL && xlog_dio_flush(l, true) != 0) {
+		say_syserror("%s: failed to write direct i/o buffer",
+			     l->filename);
+		return -1;
+	}
 	if (l->sync_is_async) {
 		int fd = dup(l->fd);
 		if (fd == -1) {
@@ -1255,9 +1595,18 @@ xlog_sync(struct xlog *l)
 int
 xlog_close(struct xlog *l, bool reuse_fd)
 {
-	int rc = fio_writen(l->fd, &eof_marker, sizeof(log_magic_t));
+	struct iovec iov = {
+		.iov_base = (void *)&eof_marker,
+		.iov_len = sizeof(log_magic_t),
+	};
+	int rc = xlog_writev(l, &iov, 1) < 0 ? -1 : 0;
 	if (rc < 0)
 		say_syserror("%s: failed to write EOF marker", l->filename);
+	if (xlog_dio_finish(l) != 0) {
+		say_syserror("%s: failed to write direct i/o buffer",
+			     l->filename);
+		rc = -1;
+	}
 
 	/*
 	 * Sync the file before closing, since
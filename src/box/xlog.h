@@ -310,6 +310,18 @@ struct xlog {
 	uint64_t rate_limit;
 	/** Time when xlog wast synced last time */
 	double sync_time;
+	/**
+	 * Aligned staging buffer used when the file is written
+	 * with O_DIRECT, NULL otherwise. Data is written to disk
+	 * in whole XLOG_DIO_ALIGN blocks, the unaligned tail is
+	 * kept in the buffer until the next write or sync.
+	 * @sa xlog_set_direct_io().
+	 */
+	char *dio_buf;
+	/** Number of bytes accumulated in dio_buf. */
+	size_t dio_used;
+	/** File offset corresponding to the start of dio_buf. */
+	off_t dio_offset;
 };
 
 /**
@@ -373,6 +385,19 @@ xlog_is_open(struct xlog *l)
 	return l->fd != -1;
 }
 
+/**
+ * Switch a freshly created xlog to direct I/O: write the file
+ * with O_DIRECT bypassing the OS page cache. Must be called
+ * right after xlog_create(), before any row is written.
+ * If the platform or the file system doesn't support direct
+ * I/O, the xlog silently stays in the buffered mode.
+ *
+ * @retval 0 for ok
+ * @retval -1 for error
+ */
+int
+xlog_set_direct_io(struct xlog *xlog);
+
 /**
  * Rename xlog
  *
@@ -420,6 +445,90 @@ xlog_tx_rollback(struct xlog *log);
 ssize_t
 xlog_flush(struct xlog *log);
 
+/**
+ * A block of rows encoded and compressed independently of an
+ * xlog file. Unlike rows written with xlog_write_row(), rows
+ * added to a block can be compressed in a different thread,
+ * in parallel with writing other blocks to the file. A block
+ * is written to a file as a single xlog transaction with
+ * xlog_write_block().
+ */
+struct xlog_block {
+	/** Encoded rows, preceded by room for the fixheader. */
+	char *data;
+	size_t data_size;
+	size_t data_capacity;
+	/** Buffer for the compressed block. */
+	char *zdata;
+	size_t zdata_capacity;
+	/** Compression context. */
+	ZSTD_CCtx *zctx;
+	/** Number of rows in the block. */
+	int64_t rows;
+	/**
+	 * The block ready to be written to a file, set by
+	 * xlog_block_seal().
+	 */
+	const char *out;
+	size_t out_size;
+};
+
+/**
+ * Initialize an empty block.
+ *
+ * @retval 0 for success
+ * @retval -1 if error
+ */
+int
+xlog_block_create(struct xlog_block *block);
+
+/** Free memory used by a block. */
+void
+xlog_block_destroy(struct xlog_block *block);
+
+/** Remove all rows from a block so that it can be reused. */
+void
+xlog_block_reset(struct xlog_block *block);
+
+/**
+ * Return true if the block is big enough to be written,
+ * i.e. if xlog_write_row() would have written the rows
+ * to the file by now.
+ */
+bool
+xlog_block_is_full(const struct xlog_block *block);
+
+/**
+ * Append a row to a block.
+ *
+ * @retval 0 for success
+ * @retval -1 if error
+ */
+int
+xlog_block_add_row(struct xlog_block *block, const struct xrow_header *packet);
+
+/**
+ * Prepare a non-empty block for writing: compute the checksum
+ * and compress the rows if the block is big enough. No rows
+ * can be added to a sealed block until it is reset. Doesn't
+ * use anything but the block, so it may be called from any
+ * thread.
+ *
+ * @retval 0 for success
+ * @retval -1 if error
+ */
+int
+xlog_block_seal(struct xlog_block *block);
+
+/**
+ * Write a sealed block to an xlog file.
+ *
+ * @retval >= 0 the number of bytes written
+ * @retval -1 if error
+ */
+ssize_t
+xlog_write_block(struct xlog *log, struct xlog_block *block);
+
 
 /**
  * Sync a log file. The exact action is defined
@@ -134,6 +134,26 @@ fio_writen(int fd, const void *buf, size_t count)
 	return 0;
 }
 
+int
+fio_pwriten(int fd, const void *buf, size_t count, off_t offset)
+{
+	size_t n = 0;
+	while (n < count) {
+		ssize_t nwr = pwrite(fd, buf + n, count - n, offset + n);
+		if (nwr < 0) {
+			if (errno == EINTR) {
+				errno = 0;
+				continue;
+			}
+			say_syserror("pwrite, [%s]", fio_filename(fd));
+			return -1;
+		}
+		n += nwr;
+	}
+	assert(n == count);
+	return 0;
+}
+
 ssize_t
 fio_writev(int fd, struct iovec *iov, int iovcnt)
 {
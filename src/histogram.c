@@ -142,6 +142,10 @@ histogram_snprint(char *buf, int size, struct histogram *hist)
 	int total = 0;
 	bool first = true;
 
+	/* Make sure the output is terminated if the histogram is empty. */
+	if (size > 0)
+		buf[0] = '\0';
+
 	for (size_t i = 0; i < hist->n_buckets; i++) {
 		int64_t count = hist->buckets[i].count;
 		if (count == 0)
@@ -63,6 +63,106 @@ bitset_destroy(struct bitset *bitset)
 	memset(&bitset->pages, 0, sizeof(bitset->pages));
 }
 
+/**
+ * @brief Replace \a old page with \a page in the pages tree and free
+ * \a old.
+ */
+static void
+bitset_replace_page(struct bitset *bitset, struct bitset_page *old,
+		    struct bitset_page *page)
+{
+	bitset_pages_remove(&bitset->pages, old);
+	bitset_pages_insert(&bitset->pages, page);
+	bitset_page_destroy(old);
+	bitset->realloc(old, 0);
+}
+
+/**
+ * @brief Convert a full array page to a bitmap page
+ * @return the new page or NULL on memory error (\a page is kept)
+ */
+static struct bitset_page *
+bitset_page_to_bitmap(struct bitset *bitset, struct bitset_page *page)
+{
+	assert(page->type == BITSET_PAGE_ARRAY);
+	size_t size = bitset_page_alloc_size(bitset->realloc);
+	struct bitset_page *bitmap = bitset->realloc(NULL, size);
+	if (bitmap == NULL)
+		return NULL;
+
+	bitset_page_create(bitmap);
+	bitmap->first_pos = page->first_pos;
+	bitmap->cardinality = page->cardinality;
+	void *data = bitset_page_data(bitmap);
+	const uint16_t *a = bitset_page_array(page);
+	for (size_t i = 0; i < page->cardinality; i++)
+		bit_set(data, a[i]);
+
+	bitset_replace_page(bitset, page, bitmap);
+	return bitmap;
+}
+
+/**
+ * @brief Convert a sparse bitmap page to an array page
+ * @return the new page or NULL on memory error (\a page is kept)
+ */
+static struct bitset_page *
+bitset_page_to_array(struct bitset *bitset, struct bitset_page *page)
+{
+	assert(page->type == BITSET_PAGE_BITMAP);
+	assert(page->cardinality <= BITSET_PAGE_ARRAY_MAX);
+	size_t capacity = BITSET_PAGE_ARRAY_MIN;
+	while (capacity < page->cardinality)
+		capacity *= 2;
+	if (capacity > BITSET_PAGE_ARRAY_MAX)
+		capacity = BITSET_PAGE_ARRAY_MAX;
+
+	size_t size = bitset_page_array_alloc_size(capacity);
+	struct bitset_page *array = bitset->realloc(NULL, size);
+	if (array == NULL)
+		return NULL;
+
+	bitset_page_array_create(array, capacity);
+	array->first_pos = page->first_pos;
+	uint16_t *a = bitset_page_array(array);
+	size_t offset;
+	struct bit_iterator it;
+	bit_iterator_init(&it, bitset_page_data(page),
+			  BITSET_PAGE_DATA_SIZE, true);
+	while ((offset = bit_iterator_next(&it)) != SIZE_MAX)
+		a[array->cardinality++] = offset;
+	assert(array->cardinality == page->cardinality);
+
+	bitset_replace_page(bitset, page, array);
+	return array;
+}
+
+/**
+ * @brief Double the capacity of an array page
+ * @return the new page or NULL on memory error (\a page is kept)
+ */
+static struct bitset_page *
+bitset_page_array_grow(struct bitset *bitset, struct bitset_page *page)
+{
+	assert(page->type == BITSET_PAGE_ARRAY);
+	size_t capacity = page->capacity * 2;
+	if (capacity > BITSET_PAGE_ARRAY_MAX)
+		capacity = BITSET_PAGE_ARRAY_MAX;
+
+	/* The page may move, so take it out of the tree first */
+	bitset_pages_remove(&bitset->pages, page);
+	size_t size = bitset_page_array_alloc_size(capacity);
+	struct bitset_page *grown = bitset->realloc(page, size);
+	if (grown == NULL) {
+		bitset_pages_insert(&bitset->pages, page);
+		return NULL;
+	}
+
+	grown->capacity = capacity;
+	bitset_pages_insert(&bitset->pages, grown);
+	return grown;
+}
+
 bool
 bitset_test(struct bitset *bitset, size_t pos)
 {
@@ -76,7 +176,13 @@ bitset_test(struct bitset *bitset, size_t pos)
 
 	assert(page->first_pos <= pos && pos < page->first_pos +
 	       BITSET_PAGE_DATA_SIZE * CHAR_BIT);
-	return bit_test(bitset_page_data(page), pos - page->first_pos);
+	size_t offset = pos - page->first_pos;
+	if (page->type == BITSET_PAGE_ARRAY) {
+		size_t i = bitset_page_array_lower_bound(page, offset);
+		return i < page->cardinality &&
+		       bitset_page_array(page)[i] == offset;
+	}
+	return bit_test(bitset_page_data(page), offset);
 }
 
 int
@@ -88,13 +194,14 @@ bitset_set(struct bitset *bitset, size_t pos)
 	/* Find a page in pages tree */
 	struct bitset_page *page = bitset_pages_search(&bitset->pages, &key);
 	if (page == NULL) {
-		/* Allocate a new page */
-		size_t size = bitset_page_alloc_size(bitset->realloc);
+		/* Allocate a new page, it is sparse until it fills up */
+		size_t size = bitset_page_array_alloc_size(
+			BITSET_PAGE_ARRAY_MIN);
 		page = bitset->realloc(NULL, size);
 		if (page == NULL)
 			return -1;
 
-		bitset_page_create(page);
+		bitset_page_array_create(page, BITSET_PAGE_ARRAY_MIN);
 		page->first_pos = key.first_pos;
 
 		/* Insert the page into pages tree */
@@ -103,8 +210,31 @@ bitset_set(struct bitset *bitset, size_t pos)
 
 	assert(page->first_pos <= pos && pos < page->first_pos +
 	       BITSET_PAGE_DATA_SIZE * CHAR_BIT);
-	bool prev = bit_set(bitset_page_data(page), pos - page->first_pos);
-	if (prev) {
+	size_t offset = pos - page->first_pos;
+	if (page->type == BITSET_PAGE_ARRAY) {
+		size_t i = bitset_page_array_lower_bound(page, offset);
+		if (i < page->cardinality &&
+		    bitset_page_array(page)[i] == offset) {
+			/* Value has not changed */
+			return 1;
+		}
+		if (page->cardinality == page->capacity) {
+			if (page->capacity < BITSET_PAGE_ARRAY_MAX)
+				page = bitset_page_array_grow(bitset, page);
+			else
+				page = bitset_page_to_bitmap(bitset, page);
+			if (page == NULL)
+				return -1;
+		}
+		if (page->type == BITSET_PAGE_ARRAY) {
+			uint16_t *a = bitset_page_array(page);
+			memmove(a + i + 1, a + i,
+				(page->cardinality - i) * sizeof(*a));
+			a[i] = offset;
+		} else {
+			bit_set(bitset_page_data(page), offset);
+		}
+	} else if (bit_set(bitset_page_data(page), offset)) {
 		/* Value has not changed */
 		return 1;
 	}
@@ -128,8 +258,15 @@ bitset_clear(struct bitset *bitset, size_t pos)
 
 	assert(page->first_pos <= pos && pos < page->first_pos +
 	       BITSET_PAGE_DATA_SIZE * CHAR_BIT);
-	bool prev = bit_clear(bitset_page_data(page), pos - page->first_pos);
-	if (!prev) {
+	size_t offset = pos - page->first_pos;
+	if (page->type == BITSET_PAGE_ARRAY) {
+		size_t i = bitset_page_array_lower_bound(page, offset);
+		uint16_t *a = bitset_page_array(page);
+		if (i == page->cardinality || a[i] != offset)
+			return 0;
+		memmove(a + i, a + i + 1,
+			(page->cardinality - i - 1) * sizeof(*a));
+	} else if (!bit_clear(bitset_page_data(page), offset)) {
 		return 0;
 	}
 
@@ -144,6 +281,14 @@ bitset_clear(struct bitset *bitset, size_t pos)
 		/* Free the page */
 		bitset_page_destroy(page);
 		bitset->realloc(page, 0);
+	} else if (page->type == BITSET_PAGE_BITMAP &&
+		   page->cardinality <= BITSET_PAGE_ARRAY_MAX / 2) {
+		/*
+		 * The page became sparse. Convert it back with some
+		 * hysteresis to avoid flapping. A memory error is
+		 * harmless here: the bitmap page stays valid.
+		 */
+		bitset_page_to_array(bitset, page);
 	}
 
 	return 1;
@@ -164,6 +309,13 @@ bitset_info(struct bitset *bitset, struct bitset_info *info)
 	struct bitset_page *page = bitset_pages_first(&bitset->pages);
 	while (page != NULL) {
 		info->pages++;
+		if (page->type == BITSET_PAGE_ARRAY) {
+			info->array_pages++;
+			info->total_size +=
+				bitset_page_array_alloc_size(page->capacity);
+		} else {
+			info->total_size += info->page_total_size;
+		}
 		cardinality_check += page->cardinality;
 		page = bitset_pages_next(&bitset->pages, page);
 	}
@@ -186,6 +338,7 @@ bitset_dump(struct bitset *bitset, int verbose, FILE *stream)
 		info.page_data_size, info.page_total_size);
 	fprintf(stream, "    " "page_bit    = %zu\n", PAGE_BIT);
 	fprintf(stream, "    " "pages       = %zu\n", info.pages);
+	fprintf(stream, "    " "array_pages = %zu\n", info.array_pages);
 
 
 	size_t cardinality = bitset_cardinality(bitset);
@@ -205,7 +358,7 @@ bitset_dump(struct bitset *bitset, int verbose, FILE *stream)
 			"utilization = undefined\n");
 	}
 	size_t mem_data  = info.page_data_size * info.pages;
-	size_t mem_total = info.page_total_size * info.pages;
+	size_t mem_total = info.total_size;
 
 	fprintf(stream, "    " "mem_data    = %zu bytes\n", mem_data);
 	fprintf(stream, "    " "mem_total   = %zu bytes "
@@ -236,7 +389,7 @@ bitset_dump(struct bitset *bitset, int verbose, FILE *stream)
 
 		fprintf(stream, "utilization = %8.4f%% (%zu/%zu)",
 			(float) page->cardinality * 1e2 / PAGE_BIT,
-			page->cardinality, PAGE_BIT);
+			(size_t) page->cardinality, PAGE_BIT);
 
 		if (verbose < 2) {
 			fprintf(stream, "\n");
@@ -246,6 +399,14 @@ bitset_dump(struct bitset *bitset, int verbose, FILE *stream)
 
 		fprintf(stream, "vals = {");
 
+		if (page->type == BITSET_PAGE_ARRAY) {
+			const uint16_t *a = bitset_page_array(page);
+			for (size_t i = 0; i < page->cardinality; i++)
+				fprintf(stream, "%zu, ", page->first_pos + a[i]);
+			fprintf(stream, "}\n");
+			continue;
+		}
+
 		size_t pos = 0;
 		struct bit_iterator it;
 		bit_iterator_init(&it, bitset_page_data(page),
@@ -69,7 +69,11 @@ extern "C" {
 struct bitset_page {
 	size_t first_pos;
 	rb_node(struct bitset_page) node;
-	size_t cardinality;
+	uint32_t cardinality;
+	/** Page container type, see enum bitset_page_type */
+	uint16_t type;
+	/** Number of offsets an array container can hold */
+	uint16_t capacity;
 	uint8_t data[0];
 };
 
@@ -151,6 +155,10 @@ bitset_cardinality(const struct bitset *bitset) {
 struct bitset_info {
 	/** Number of allocated pages */
 	size_t pages;
+	/** Number of allocated pages stored as sorted offset arrays */
+	size_t array_pages;
+	/** Memory used by all pages (in bytes, including tree data) */
+	size_t total_size;
 	/** Data (payload) size of one page (in bytes) */
 	size_t page_data_size;
 	/** Full size of one page (in bytes, including padding and tree data) */
@@ -393,7 +393,7 @@ bitset_index_bsize(const struct bitset_index *index)
 			continue;
 		struct bitset_info info;
 		bitset_info(index->bitsets[b], &info);
-		result += info.page_total_size * info.pages;
+		result += info.total_size;
 	}
 	return result;
 }
@@ -41,6 +41,18 @@ bitset_page_data(struct bitset_page *page);
 extern inline void
 bitset_page_create(struct bitset_page *page);
 
+extern inline size_t
+bitset_page_array_alloc_size(size_t capacity);
+
+extern inline uint16_t *
+bitset_page_array(struct bitset_page *page);
+
+extern inline void
+bitset_page_array_create(struct bitset_page *page, size_t capacity);
+
+extern inline size_t
+bitset_page_array_lower_bound(struct bitset_page *page, size_t offset);
+
 extern inline void
 bitset_page_destroy(struct bitset_page *page);
 
@@ -67,6 +79,13 @@ void
 bitset_page_dump(struct bitset_page *page, FILE *stream)
 {
 	fprintf(stream, "Page %zu:\n", page->first_pos);
+	if (page->type == BITSET_PAGE_ARRAY) {
+		uint16_t *a = bitset_page_array(page);
+		for (size_t i = 0; i < page->cardinality; i++)
+			fprintf(stream, "%u ", (unsigned) a[i]);
+		fprintf(stream, "\n--\n");
+		return;
+	}
 	char *d = bitset_page_data(page);
 	for (int i = 0; i < BITSET_PAGE_DATA_SIZE; i++) {
 		fprintf(stream, "%x ", *d);
@@ -58,7 +58,29 @@ enum {
 	BITSET_PAGE_DATA_SIZE = 160
 };
 
-#if defined(ENABLE_AVX)
+/**
+ * A page is stored either as a plain bitmap of BITSET_PAGE_DATA_SIZE
+ * bytes or, while it is sparse, as a sorted array of 16-bit offsets
+ * of its set bits. An array page is allocated for its capacity only
+ * and is converted to a bitmap once it would grow past the bitmap size.
+ */
+enum bitset_page_type {
+	BITSET_PAGE_BITMAP = 0,
+	BITSET_PAGE_ARRAY = 1
+};
+
+enum {
+	/** Max number of offsets stored in an array page */
+	BITSET_PAGE_ARRAY_MAX = BITSET_PAGE_DATA_SIZE / sizeof(uint16_t),
+	/** Initial capacity of an array page */
+	BITSET_PAGE_ARRAY_MIN = 4
+};
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+typedef __m256i bitset_word_t;
+#define BITSET_PAGE_DATA_ALIGNMENT 32
+#elif defined(ENABLE_AVX)
 typedef __m256i bitset_word_t;
 #define BITSET_PAGE_DATA_ALIGNMENT 32
 #elif defined(ENABLE_SSE2)
@@ -121,6 +143,49 @@ bitset_page_create(struct bitset_page *page)
 	memset(page, 0, size);
 }
 
+inline size_t
+bitset_page_array_alloc_size(size_t capacity)
+{
+	return sizeof(struct bitset_page) + capacity * sizeof(uint16_t);
+}
+
+inline uint16_t *
+bitset_page_array(struct bitset_page *page)
+{
+	assert(page->type == BITSET_PAGE_ARRAY);
+	return (uint16_t *) page->data;
+}
+
+inline void
+bitset_page_array_create(struct bitset_page *page, size_t capacity)
+{
+	assert(capacity <= BITSET_PAGE_ARRAY_MAX);
+	memset(page, 0, sizeof(*page));
+	page->type = BITSET_PAGE_ARRAY;
+	page->capacity = capacity;
+}
+
+/**
+ * @brief Find the first offset in the array page that is not less
+ * than \a offset
+ * @return index in bitset_page_array()
+ */
+inline size_t
+bitset_page_array_lower_bound(struct bitset_page *page, size_t offset)
+{
+	const uint16_t *a = bitset_page_array(page);
+	size_t lo = 0;
+	size_t hi = page->cardinality;
+	while (lo < hi) {
+		size_t mid = lo + (hi - lo) / 2;
+		if (a[mid] < offset)
+			lo = mid + 1;
+		else
+			hi = mid;
+	}
+	return lo;
+}
+
 inline void
 bitset_page_destroy(struct bitset_page *page)
 {
@@ -150,6 +215,23 @@ bitset_page_set_ones(struct bitset_page *page)
 inline void
 bitset_page_and(struct bitset_page *dst, struct bitset_page *src)
 {
+	assert(dst->type == BITSET_PAGE_BITMAP);
+	if (src->type == BITSET_PAGE_ARRAY) {
+		/* Only bits listed in the array can survive */
+		void *d = bitset_page_data(dst);
+		const uint16_t *s = bitset_page_array(src);
+		uint16_t keep[BITSET_PAGE_ARRAY_MAX];
+		size_t n = 0;
+		for (size_t i = 0; i < src->cardinality; i++) {
+			if (bit_test(d, s[i]))
+				keep[n++] = s[i];
+		}
+		memset(d, 0, BITSET_PAGE_DATA_SIZE);
+		for (size_t i = 0; i < n; i++)
+			bit_set(d, keep[i]);
+		return;
+	}
+
 	bitset_word_t *d = (bitset_word_t *) bitset_page_data(dst);
 	bitset_word_t *s = (bitset_word_t *) bitset_page_data(src);
 
@@ -163,6 +245,15 @@ bitset_page_and(struct bitset_page *dst, struct bitset_page *src)
 inline void
 bitset_page_nand(struct bitset_page *dst, struct bitset_page *src)
 {
+	assert(dst->type == BITSET_PAGE_BITMAP);
+	if (src->type == BITSET_PAGE_ARRAY) {
+		void *d = bitset_page_data(dst);
+		const uint16_t *s = bitset_page_array(src);
+		for (size_t i = 0; i < src->cardinality; i++)
+			bit_clear(d, s[i]);
+		return;
+	}
+
 	bitset_word_t *d = (bitset_word_t *) bitset_page_data(dst);
 	bitset_word_t *s = (bitset_word_t *) bitset_page_data(src);
 
@@ -176,6 +267,15 @@ bitset_page_nand(struct bitset_page *dst, struct bitset_page *src)
 inline void
 bitset_page_or(struct bitset_page *dst, struct bitset_page *src)
 {
+	assert(dst->type == BITSET_PAGE_BITMAP);
+	if (src->type == BITSET_PAGE_ARRAY) {
+		void *d = bitset_page_data(dst);
+		const uint16_t *s = bitset_page_array(src);
+		for (size_t i = 0; i < src->cardinality; i++)
+			bit_set(d, s[i]);
+		return;
+	}
+
 	bitset_word_t *d = (bitset_word_t *) bitset_page_data(dst);
 	bitset_word_t *s = (bitset_word_t *) bitset_page_data(src);
 
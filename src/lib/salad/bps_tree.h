@@ -137,6 +137,7 @@
  * void bps_tree_destroy(tree);
  * int bps_tree_build(tree, sorted_array, array_size);
  * bps_tree_elem_t *bps_tree_find(tree, key);
+ * void bps_tree_find_batch(tree, keys, count, result);
  * int bps_tree_insert(tree, new_elem, replaced_elem);
  * int bps_tree_delete(tree, elem);
  * size_t bps_tree_size(tree);
@@ -154,6 +155,13 @@
  * struct bps_tree_iterator bps_tree_lower_bound(tree, key, exact);
  * struct bps_tree_iterator bps_tree_upper_bound(tree, key, exact);
  * size_t bps_tree_approxiamte_count(tree, key);
+ * // with BPS_INNER_CHILD_CARDS defined:
+ * struct bps_tree_iterator bps_tree_lower_bound_get_offset(tree, key,
+ *                                                          exact, offset);
+ * struct bps_tree_iterator bps_tree_upper_bound_get_offset(tree, key,
+ *                                                          exact, offset);
+ * struct bps_tree_iterator bps_tree_iterator_at(tree, offset);
+ * size_t bps_tree_iterator_get_offset(tree, itr);
  * bps_tree_elem_t *bps_tree_iterator_get_elem(tree, itr);
  * bool bps_tree_iterator_next(tree, itr);
  * bool bps_tree_iterator_prev(tree, itr);
@@ -279,6 +287,16 @@
  * #define BPS_BLOCK_LINEAR_SEARCH
  */
 
+/**
+ * A switch that makes every inner block store the number of
+ * elements in the subtree of each of its children. It costs an
+ * extra size_t per child (i.e. a lower fan-out of inner blocks)
+ * and a few more block reads on insertion and deletion, but gives
+ * logarithmic time positional access: the offset of an element
+ * or a bound of a key, and an iterator by offset. To turn it on,
+ * #define BPS_INNER_CHILD_CARDS
+ */
+
 /**
  * A switch that enables collection of executions of different
  * branches of code. Used only for debug purposes, I hope you
@@ -345,6 +363,7 @@ typedef uint32_t bps_tree_block_id_t;
 #define bps_tree_build _api_name(build)
 #define bps_tree_destroy _api_name(destroy)
 #define bps_tree_find _api_name(find)
+#define bps_tree_find_batch _api_name(find_batch)
 #define bps_tree_insert _api_name(insert)
 #define bps_tree_delete _api_name(delete)
 #define bps_tree_size _api_name(size)
@@ -358,6 +377,10 @@ typedef uint32_t bps_tree_block_id_t;
 #define bps_tree_lower_bound _api_name(lower_bound)
 #define bps_tree_upper_bound _api_name(upper_bound)
 #define bps_tree_approximate_count _api_name(approximate_count)
+#define bps_tree_lower_bound_get_offset _api_name(lower_bound_get_offset)
+#define bps_tree_upper_bound_get_offset _api_name(upper_bound_get_offset)
+#define bps_tree_iterator_at _api_name(iterator_at)
+#define bps_tree_iterator_get_offset _api_name(iterator_get_offset)
 #define bps_tree_iterator_get_elem _api_name(iterator_get_elem)
 #define bps_tree_iterator_next _api_name(iterator_next)
 #define bps_tree_iterator_prev _api_name(iterator_prev)
@@ -381,6 +404,7 @@ typedef uint32_t bps_tree_block_id_t;
 #define bps_tree_restore_block_ver _bps_tree(restore_block_ver)
 #define bps_tree_root _bps_tree(root)
 #define bps_tree_touch_block _bps_tree(touch_block)
+#define bps_tree_prefetch_block _bps_tree(prefetch_block)
 #define bps_tree_find_ins_point_key _bps_tree(find_ins_point_key)
 #define bps_tree_find_ins_point_elem _bps_tree(find_ins_point_elem)
 #define bps_tree_find_after_ins_point_key _bps_tree(find_after_ins_point_key)
@@ -397,6 +421,10 @@ typedef uint32_t bps_tree_block_id_t;
 #define bps_tree_touch_leaf_path_max_elem _bps_tree(touch_leaf_path_max_elem)
 #define bps_tree_touch_path _bps_tree(touch_path_max_elem)
 #define bps_tree_process_replace _bps_tree(process_replace)
+#define bps_tree_block_card _bps_tree(block_card)
+#define bps_tree_update_child_card _bps_tree(update_child_card)
+#define bps_tree_update_card_in_parent _bps_tree(update_card_in_parent)
+#define bps_tree_add_path_cards _bps_tree(add_path_cards)
 #define bps_tree_debug_memmove _bps_tree(debug_memmove)
 #define bps_tree_insert_into_leaf _bps_tree(insert_into_leaf)
 #define bps_tree_insert_into_inner _bps_tree(insert_into_inner)
@@ -591,6 +619,22 @@ bps_tree_destroy(struct bps_tree *tree);
 static inline bps_tree_elem_t *
 bps_tree_find(const struct bps_tree *tree, bps_tree_key_t key);
 
+/**
+ * @brief Find the first elements that are equal to each of the keys.
+ *  The result is the same as of calling bps_tree_find for every key
+ *  in turn, but the keys descend the tree level by level together,
+ *  and the next block of each key is prefetched while the others are
+ *  searched, so cache misses of different keys overlap.
+ * @param tree - pointer to a tree
+ * @param keys - array of keys
+ * @param count - number of keys
+ * @param result - array of count pointers that receives the first
+ *  equal element for each key or NULL if not found
+ */
+static inline void
+bps_tree_find_batch(const struct bps_tree *tree, bps_tree_key_t *keys,
+		    size_t count, bps_tree_elem_t **result);
+
 /**
  * @brief Insert an element to the tree or replace an element in the tree
  * In case of replacing, if 'replaced' argument is not null,
@@ -733,6 +777,64 @@ bps_tree_upper_bound(const struct bps_tree *tree, bps_tree_key_t key,
 static inline size_t
 bps_tree_approximate_count(const struct bps_tree *tree, bps_tree_key_t key);
 
+#ifdef BPS_INNER_CHILD_CARDS
+/**
+ * @brief Same as bps_tree_lower_bound, but also calculates the
+ *  offset of the returned iterator, i.e. the number of elements
+ *  that are less than the key.
+ * @param tree - pointer to a tree
+ * @param key - key that will be compared with elements
+ * @param exact - see bps_tree_lower_bound. Pass NULL if you don't
+ *  need that info.
+ * @param offset - pointer to a value that receives the offset.
+ * @return - Lower-bound iterator. Invalid if all elements are less than key.
+ */
+static inline struct bps_tree_iterator
+bps_tree_lower_bound_get_offset(const struct bps_tree *tree,
+				bps_tree_key_t key, bool *exact,
+				size_t *offset);
+
+/**
+ * @brief Same as bps_tree_upper_bound, but also calculates the
+ *  offset of the returned iterator, i.e. the number of elements
+ *  that are less than or equal to the key.
+ * @param tree - pointer to a tree
+ * @param key - key that will be compared with elements
+ * @param exact - see bps_tree_upper_bound. Pass NULL if you don't
+ *  need that info.
+ * @param offset - pointer to a value that receives the offset.
+ * @return - Upper-bound iterator. Invalid if all elements are less or equal
+ *  than the key.
+ */
+static inline struct bps_tree_iterator
+bps_tree_upper_bound_get_offset(const struct bps_tree *tree,
+				bps_tree_key_t key, bool *exact,
+				size_t *offset);
+
+/**
+ * @brief Get an iterator to the element with the given offset,
+ *  i.e. to the element that has exactly 'offset' elements before it.
+ * @param tree - pointer to a tree
+ * @param offset - offset of the element
+ * @return - Iterator. Invalid if offset >= size of the tree.
+ */
+static inline struct bps_tree_iterator
+bps_tree_iterator_at(const struct bps_tree *tree, size_t offset);
+
+/**
+ * @brief Get the offset of the element pointed by iterator, i.e.
+ *  the number of elements before it.
+ *  Must not be used with iterators that are frozen.
+ * @param tree - pointer to a tree
+ * @param itr - pointer to tree iterator
+ * @return - Offset of the element, size of the tree for invalid
+ *  iterator.
+ */
+static inline size_t
+bps_tree_iterator_get_offset(const struct bps_tree *tree,
+			     struct bps_tree_iterator *itr);
+#endif /* BPS_INNER_CHILD_CARDS */
+
 /**
  * @brief Get a pointer to the element pointed by iterator.
  *  If iterator is detected as broken, it is invalidated and NULL returned.
@@ -837,6 +939,16 @@ bps_tree_debug_check_internal_functions(bool assertme);
 /* Same as BPS_TREE_MEMMOVE but takes count of values instead of memory size */
 #define BPS_TREE_DATAMOVE(dst, src, num, dst_bck, src_bck) \
 	BPS_TREE_MEMMOVE(dst, src, (num) * sizeof((dst)[0]), dst_bck, src_bck)
+/*
+ * Same as BPS_TREE_DATAMOVE, used for child cardinalities of inner
+ * blocks; does nothing if they are not stored.
+ */
+#ifdef BPS_INNER_CHILD_CARDS
+#define BPS_TREE_CARDMOVE(dst, src, num, dst_bck, src_bck) \
+	BPS_TREE_DATAMOVE(dst, src, num, dst_bck, src_bck)
+#else
+#define BPS_TREE_CARDMOVE(dst, src, num, dst_bck, src_bck) do { } while (0)
+#endif
 
 /**
  * Types of a block
@@ -865,9 +977,16 @@ enum bps_tree_max_sizes {
 		(BPS_TREE_BLOCK_SIZE - sizeof(struct bps_block)
 		 - 2 * sizeof(bps_tree_block_id_t) )
 		/ sizeof(bps_tree_elem_t),
+#ifdef BPS_INNER_CHILD_CARDS
+	BPS_TREE_MAX_COUNT_IN_INNER =
+		(BPS_TREE_BLOCK_SIZE - sizeof(struct bps_block))
+		/ (sizeof(bps_tree_elem_t) + sizeof(bps_tree_block_id_t)
+		   + sizeof(size_t)),
+#else
 	BPS_TREE_MAX_COUNT_IN_INNER =
 		(BPS_TREE_BLOCK_SIZE - sizeof(struct bps_block))
 		/ (sizeof(bps_tree_elem_t) + sizeof(bps_tree_block_id_t)),
+#endif
 	BPS_TREE_MAX_DEPTH = 16
 };
 
@@ -913,6 +1032,10 @@ struct bps_inner {
 	bps_tree_elem_t elems[BPS_TREE_MAX_COUNT_IN_INNER - 1];
 	/* Corresponding child IDs */
 	bps_tree_block_id_t child_ids[BPS_TREE_MAX_COUNT_IN_INNER];
+#ifdef BPS_INNER_CHILD_CARDS
+	/* Number of elements in corresponding child subtrees */
+	size_t child_cards[BPS_TREE_MAX_COUNT_IN_INNER];
+#endif
 };
 
 /**
@@ -1123,6 +1246,9 @@ bps_tree_build(struct bps_tree *tree, bps_tree_elem_t *sorted_array,
 			}
 			parents[i]->child_ids[parents[i]->header.size] =
 				insert_id;
+#ifdef BPS_INNER_CHILD_CARDS
+			parents[i]->child_cards[parents[i]->header.size] = 0;
+#endif
 			if (new_id == (bps_tree_block_id_t)-1)
 				break;
 			if (i == depth - 2) {
@@ -1132,6 +1258,12 @@ bps_tree_build(struct bps_tree *tree, bps_tree_elem_t *sorted_array,
 			}
 		}
 
+#ifdef BPS_INNER_CHILD_CARDS
+		for (bps_tree_block_id_t i = 0; i < depth - 1; i++)
+			parents[i]->child_cards[parents[i]->header.size] +=
+				leaf->header.size;
+#endif
+
 		bps_tree_elem_t insert_value = current[leaf->header.size - 1];
 		for (bps_tree_block_id_t i = 0; i < depth - 1; i++) {
 			parents[i]->header.size++;
@@ -1248,6 +1380,16 @@ bps_tree_touch_block(struct bps_tree *tree, bps_tree_block_id_t id)
 	return (struct bps_block *)matras_touch(&tree->matras, id);
 }
 
+/**
+ * @brief Prefetch a block into the CPU cache.
+ */
+static inline void
+bps_tree_prefetch_block(const struct bps_block *block)
+{
+	for (size_t offset = 0; offset < BPS_TREE_BLOCK_SIZE; offset += 64)
+		__builtin_prefetch((const char *)block + offset);
+}
+
 /**
  * @brief Get a random element in a tree.
  * @param tree - pointer to a tree
@@ -1764,6 +1906,198 @@ bps_tree_iterator_get_elem(const struct bps_tree *tree,
 	return leaf->elems + itr->pos;
 }
 
+#ifdef BPS_INNER_CHILD_CARDS
+/**
+ * @brief Same as bps_tree_lower_bound, but also calculates the
+ *  offset of the returned iterator, i.e. the number of elements
+ *  that are less than the key.
+ * @param tree - pointer to a tree
+ * @param key - key that will be compared with elements
+ * @param exact - see bps_tree_lower_bound. Pass NULL if you don't
+ *  need that info.
+ * @param offset - pointer to a value that receives the offset.
+ * @return - Lower-bound iterator. Invalid if all elements are less than key.
+ */
+static inline struct bps_tree_iterator
+bps_tree_lower_bound_get_offset(const struct bps_tree *tree,
+				bps_tree_key_t key, bool *exact,
+				size_t *offset)
+{
+	struct bps_tree_iterator res;
+	matras_head_read_view(&res.view);
+	bool local_result;
+	if (!exact)
+		exact = &local_result;
+	*exact = false;
+	*offset = 0;
+	if (tree->root_id == (bps_tree_block_id_t)(-1)) {
+		res.block_id = (bps_tree_block_id_t)(-1);
+		res.pos = 0;
+		return res;
+	}
+	struct bps_block *block = bps_tree_root(tree);
+	bps_tree_block_id_t block_id = tree->root_id;
+	for (bps_tree_block_id_t i = 0; i < tree->depth - 1; i++) {
+		struct bps_inner *inner = (struct bps_inner *)block;
+		bps_tree_pos_t pos;
+		pos = bps_tree_find_ins_point_key(tree, inner->elems,
+						  inner->header.size - 1,
+						  key, exact);
+		for (bps_tree_pos_t j = 0; j < pos; j++)
+			*offset += inner->child_cards[j];
+		block_id = inner->child_ids[pos];
+		block = bps_tree_restore_block(tree, block_id);
+	}
+
+	struct bps_leaf *leaf = (struct bps_leaf *)block;
+	bps_tree_pos_t pos;
+	pos = bps_tree_find_ins_point_key(tree, leaf->elems, leaf->header.size,
+					  key, exact);
+	*offset += pos;
+	if (pos >= leaf->header.size) {
+		res.block_id = leaf->next_id;
+		res.pos = 0;
+	} else {
+		res.block_id = block_id;
+		res.pos = pos;
+	}
+	return res;
+}
+
+/**
+ * @brief Same as bps_tree_upper_bound, but also calculates the
+ *  offset of the returned iterator, i.e. the number of elements
+ *  that are less than or equal to the key.
+ * @param tree - pointer to a tree
+ * @param key - key that will be compared with elements
+ * @param exact - see bps_tree_upper_bound. Pass NULL if you don't
+ *  need that info.
+ * @param offset - pointer to a value that receives the offset.
+ * @return - Upper-bound iterator. Invalid if all elements are less or equal
+ *  than the key.
+ */
+static inline struct bps_tree_iterator
+bps_tree_upper_bound_get_offset(const struct bps_tree *tree,
+				bps_tree_key_t key, bool *exact,
+				size_t *offset)
+{
+	struct bps_tree_iterator res;
+	matras_head_read_view(&res.view);
+	bool local_result;
+	if (!exact)
+		exact = &local_result;
+	*exact = false;
+	*offset = 0;
+	bool exact_test;
+	if (tree->root_id == (bps_tree_block_id_t)(-1)) {
+		res.block_id = (bps_tree_block_id_t)(-1);
+		res.pos = 0;
+		return res;
+	}
+	struct bps_block *block = bps_tree_root(tree);
+	bps_tree_block_id_t block_id = tree->root_id;
+	for (bps_tree_block_id_t i = 0; i < tree->depth - 1; i++) {
+		struct bps_inner *inner = (struct bps_inner *)block;
+		bps_tree_pos_t pos;
+		pos = bps_tree_find_after_ins_point_key(tree, inner->elems,
+							inner->header.size - 1,
+							key, &exact_test);
+		if (exact_test)
+			*exact = true;
+		for (bps_tree_pos_t j = 0; j < pos; j++)
+			*offset += inner->child_cards[j];
+		block_id = inner->child_ids[pos];
+		block = bps_tree_restore_block(tree, block_id);
+	}
+
+	struct bps_leaf *leaf = (struct bps_leaf *)block;
+	bps_tree_pos_t pos;
+	pos = bps_tree_find_after_ins_point_key(tree, leaf->elems,
+						leaf->header.size,
+						key, &exact_test);
+	if (exact_test)
+		*exact = true;
+	*offset += pos;
+	if (pos >= leaf->header.size) {
+		res.block_id = leaf->next_id;
+		res.pos = 0;
+	} else {
+		res.block_id = block_id;
+		res.pos = pos;
+	}
+	return res;
+}
+
+/**
+ * @brief Get an iterator to the element with the given offset,
+ *  i.e. to the element that has exactly 'offset' elements before it.
+ * @param tree - pointer to a tree
+ * @param offset - offset of the element
+ * @return - Iterator. Invalid if offset >= size of the tree.
+ */
+static inline struct bps_tree_iterator
+bps_tree_iterator_at(const struct bps_tree *tree, size_t offset)
+{
+	struct bps_tree_iterator res;
+	matras_head_read_view(&res.view);
+	if (offset >= tree->size) {
+		res.block_id = (bps_tree_block_id_t)(-1);
+		res.pos = 0;
+		return res;
+	}
+	struct bps_block *block = bps_tree_root(tree);
+	bps_tree_block_id_t block_id = tree->root_id;
+	for (bps_tree_block_id_t i = 0; i < tree->depth - 1; i++) {
+		struct bps_inner *inner = (struct bps_inner *)block;
+		bps_tree_pos_t pos = 0;
+		while (offset >= inner->child_cards[pos]) {
+			offset -= inner->child_cards[pos];
+			pos++;
+			assert(pos < inner->header.size);
+		}
+		block_id = inner->child_ids[pos];
+		block = bps_tree_restore_block(tree, block_id);
+	}
+	assert(offset < (size_t)block->size);
+	res.block_id = block_id;
+	res.pos = (bps_tree_pos_t)offset;
+	return res;
+}
+
+/**
+ * @brief Get the offset of the element pointed by iterator, i.e.
+ *  the number of elements before it.
+ *  Must not be used with iterators that are frozen.
+ * @param tree - pointer to a tree
+ * @param itr - pointer to tree iterator
+ * @return - Offset of the element, size of the tree for invalid
+ *  iterator.
+ */
+static inline size_t
+bps_tree_iterator_get_offset(const struct bps_tree *tree,
+			     struct bps_tree_iterator *itr)
+{
+	assert(!matras_is_read_view_created(&itr->view));
+	bps_tree_elem_t *elem = bps_tree_iterator_get_elem(tree, itr);
+	if (elem == NULL)
+		return tree->size;
+	size_t offset = 0;
+	bool exact;
+	struct bps_block *block = bps_tree_root(tree);
+	for (bps_tree_block_id_t i = 0; i < tree->depth - 1; i++) {
+		struct bps_inner *inner = (struct bps_inner *)block;
+		bps_tree_pos_t pos;
+		pos = bps_tree_find_ins_point_elem(tree, inner->elems,
+						   inner->header.size - 1,
+						   *elem, &exact);
+		for (bps_tree_pos_t j = 0; j < pos; j++)
+			offset += inner->child_cards[j];
+		block = bps_tree_restore_block(tree, inner->child_ids[pos]);
+	}
+	return offset + itr->pos;
+}
+#endif /* BPS_INNER_CHILD_CARDS */
+
 /**
  * @brief Increments an iterator, makes it point to the next element
  *  If the iterator is to last element, it will be invalidated
@@ -1885,6 +2219,55 @@ bps_tree_find(const struct bps_tree *tree, bps_tree_key_t key)
 		return 0;
 }
 
+/**
+ * @brief Find the first elements that are equal to each of the keys.
+ */
+static inline void
+bps_tree_find_batch(const struct bps_tree *tree, bps_tree_key_t *keys,
+		    size_t count, bps_tree_elem_t **result)
+{
+	/* Number of keys descending the tree together. */
+	enum { BATCH_SIZE = 32 };
+	struct bps_block *blocks[BATCH_SIZE];
+	if (tree->root_id == (bps_tree_block_id_t)(-1)) {
+		for (size_t i = 0; i < count; i++)
+			result[i] = 0;
+		return;
+	}
+	struct bps_block *root = bps_tree_root(tree);
+	while (count > 0) {
+		size_t size = count < BATCH_SIZE ? count : BATCH_SIZE;
+		for (size_t k = 0; k < size; k++)
+			blocks[k] = root;
+		bool exact = false;
+		for (bps_tree_block_id_t i = 0; i < tree->depth - 1; i++) {
+			for (size_t k = 0; k < size; k++) {
+				struct bps_inner *inner =
+					(struct bps_inner *)blocks[k];
+				bps_tree_pos_t pos;
+				pos = bps_tree_find_ins_point_key(tree,
+						inner->elems,
+						inner->header.size - 1,
+						keys[k], &exact);
+				blocks[k] = bps_tree_restore_block(tree,
+						inner->child_ids[pos]);
+				bps_tree_prefetch_block(blocks[k]);
+			}
+		}
+		for (size_t k = 0; k < size; k++) {
+			struct bps_leaf *leaf = (struct bps_leaf *)blocks[k];
+			bps_tree_pos_t pos;
+			pos = bps_tree_find_ins_point_key(tree, leaf->elems,
+							  leaf->header.size,
+							  keys[k], &exact);
+			result[k] = exact ? leaf->elems + pos : 0;
+		}
+		keys += size;
+		result += size;
+		count -= size;
+	}
+}
+
 /**
  * @brief Add a block to the garbage for future reuse
  */
@@ -2124,6 +2507,101 @@ bps_tree_touch_path(struct bps_tree *tree,
 	}
 }
 
+#ifdef BPS_INNER_CHILD_CARDS
+/**
+ * @brief Get the number of elements in the subtree of a block.
+ */
+static inline size_t
+bps_tree_block_card(struct bps_tree *tree, bps_tree_block_id_t block_id)
+{
+	struct bps_block *block = bps_tree_restore_block(tree, block_id);
+	if (block->type == BPS_TREE_BT_LEAF)
+		return block->size;
+	assert(block->type == BPS_TREE_BT_INNER);
+	struct bps_inner *inner = (struct bps_inner *)block;
+	size_t card = 0;
+	for (bps_tree_pos_t i = 0; i < inner->header.size; i++)
+		card += inner->child_cards[i];
+	return card;
+}
+#endif
+
+/**
+ * @brief Set the stored cardinality of a child of an inner block
+ *  to the actual number of elements in the child's subtree.
+ *  Does nothing if cardinalities are not stored.
+ */
+static inline void
+bps_tree_update_child_card(struct bps_tree *tree, struct bps_inner *inner,
+			   bps_tree_pos_t pos)
+{
+#ifdef BPS_INNER_CHILD_CARDS
+	/* exclusive behaviuor for debug checks */
+	if (tree->root_id == (bps_tree_block_id_t) -1)
+		return;
+	inner->child_cards[pos] = bps_tree_block_card(tree,
+						      inner->child_ids[pos]);
+#else
+	(void)tree;
+	(void)inner;
+	(void)pos;
+#endif
+}
+
+/**
+ * @brief Update the stored cardinality of a block in the parent
+ *  after elements were moved to or from the block. Does nothing if
+ *  the block is new and not linked to the parent yet: its
+ *  cardinality is set on linking, see bps_tree_insert_into_inner.
+ */
+static inline void
+bps_tree_update_card_in_parent(struct bps_tree *tree,
+			       struct bps_inner_path_elem *parent,
+			       bps_tree_pos_t pos, bps_tree_block_id_t block_id)
+{
+#ifdef BPS_INNER_CHILD_CARDS
+	/* exclusive behaviuor for debug checks */
+	if (tree->root_id == (bps_tree_block_id_t) -1 || parent == NULL)
+		return;
+	struct bps_inner *inner = parent->block;
+	if (pos >= inner->header.size || inner->child_ids[pos] != block_id)
+		return;
+	bps_tree_update_child_card(tree, inner, pos);
+#else
+	(void)tree;
+	(void)parent;
+	(void)pos;
+	(void)block_id;
+#endif
+}
+
+/**
+ * @brief Add a delta to stored cardinalities of children on the path
+ *  from the given inner block up to the root. Called when the number
+ *  of elements in the subtree of the block has changed by that delta.
+ */
+static inline void
+bps_tree_add_path_cards(struct bps_tree *tree,
+			struct bps_inner_path_elem *inner_path_elem,
+			int delta)
+{
+#ifdef BPS_INNER_CHILD_CARDS
+	/* exclusive behaviuor for debug checks */
+	if (tree->root_id == (bps_tree_block_id_t) -1)
+		return;
+	for (struct bps_inner_path_elem *path = inner_path_elem;
+	     path; path = path->parent) {
+		path->block = (struct bps_inner *)
+			bps_tree_touch_block(tree, path->block_id);
+		path->block->child_cards[path->insertion_point] += delta;
+	}
+#else
+	(void)tree;
+	(void)inner_path_elem;
+	(void)delta;
+#endif
+}
+
 /**
  * @brief Replace element by it's path and fill the *replaced argument
  */
@@ -2209,6 +2687,16 @@ bps_tree_debug_memmove(void *dst_arg, void *src_arg, size_t num,
 				assert(src < ((char *)src_inner->elems) +
 				       (BPS_TREE_MAX_COUNT_IN_INNER - 1) *
 				       sizeof(bps_tree_elem_t));
+#ifdef BPS_INNER_CHILD_CARDS
+			} else if (dst >= ((char *)dst_inner->child_cards)) {
+				assert(dst < ((char *)dst_inner->child_cards) +
+				       BPS_TREE_MAX_COUNT_IN_INNER *
+				       sizeof(size_t));
+				assert(src >= (char *)src_inner->child_cards);
+				assert(src < ((char *)src_inner->child_cards) +
+				       BPS_TREE_MAX_COUNT_IN_INNER *
+				       sizeof(size_t));
+#endif
 			} else {
 				assert(dst >= ((char *)dst_inner->child_ids));
 				assert(dst < ((char *)dst_inner->child_ids) +
@@ -2229,6 +2717,17 @@ bps_tree_debug_memmove(void *dst_arg, void *src_arg, size_t num,
 					(BPS_TREE_MAX_COUNT_IN_INNER - 1) *
 					sizeof(bps_tree_elem_t)) {
 				/* nothing to do due to if condition */
+#ifdef BPS_INNER_CHILD_CARDS
+			} else if (dst >= ((char *)dst_inner->child_cards) &&
+				   src >= ((char *)src_inner->child_cards)) {
+				assert(dst <= ((char *)dst_inner->child_cards) +
+				       BPS_TREE_MAX_COUNT_IN_INNER *
+				       sizeof(size_t));
+				assert(src >= (char *)src_inner->child_cards);
+				assert(src <= ((char *)src_inner->child_cards) +
+				       BPS_TREE_MAX_COUNT_IN_INNER *
+				       sizeof(size_t));
+#endif
 			} else {
 				assert(dst >= ((char *)dst_inner->child_ids));
 				assert(dst <= ((char *)dst_inner->child_ids) +
@@ -2275,6 +2774,7 @@ bps_tree_insert_into_leaf(struct bps_tree *tree,
 	}
 	leaf->header.size++;
 	tree->size++;
+	bps_tree_add_path_cards(tree, leaf_path_elem->parent, 1);
 }
 
 /**
@@ -2303,12 +2803,16 @@ bps_tree_insert_into_inner(struct bps_tree *tree,
 		BPS_TREE_DATAMOVE(inner->child_ids + pos + 1,
 				  inner->child_ids + pos,
 				  inner->header.size - pos, inner, inner);
+		BPS_TREE_CARDMOVE(inner->child_cards + pos + 1,
+				  inner->child_cards + pos,
+				  inner->header.size - pos, inner, inner);
 	} else {
 		if (pos > 0)
 			inner->elems[pos - 1] = *inner_path_elem->max_elem_copy;
 		*inner_path_elem->max_elem_copy = max_elem;
 	}
 	inner->child_ids[pos] = block_id;
+	bps_tree_update_child_card(tree, inner, pos);
 
 	inner->header.size++;
 }
@@ -2342,6 +2846,7 @@ bps_tree_delete_from_leaf(struct bps_tree *tree,
 	}
 
 	tree->size--;
+	bps_tree_add_path_cards(tree, leaf_path_elem->parent, -1);
 }
 
 /**
@@ -2367,6 +2872,9 @@ bps_tree_delete_from_inner(struct bps_tree *tree,
 		BPS_TREE_DATAMOVE(inner->child_ids + pos,
 				  inner->child_ids + pos + 1,
 				  inner->header.size - 1 - pos, inner, inner);
+		BPS_TREE_CARDMOVE(inner->child_cards + pos,
+				  inner->child_cards + pos + 1,
+				  inner->header.size - 1 - pos, inner, inner);
 	} else if (pos > 0) {
 		*inner_path_elem->max_elem_copy = inner->elems[pos - 1];
 	}
@@ -2409,6 +2917,12 @@ bps_tree_move_elems_to_right_leaf(struct bps_tree *tree,
 		*a_leaf_path_elem->max_elem_copy =
 			a->elems[a->header.size - 1];
 	*b_leaf_path_elem->max_elem_copy = b->elems[b->header.size - 1];
+	bps_tree_update_card_in_parent(tree, a_leaf_path_elem->parent,
+				       a_leaf_path_elem->pos_in_parent,
+				       a_leaf_path_elem->block_id);
+	bps_tree_update_card_in_parent(tree, b_leaf_path_elem->parent,
+				       b_leaf_path_elem->pos_in_parent,
+				       b_leaf_path_elem->block_id);
 }
 
 /**
@@ -2440,6 +2954,10 @@ bps_tree_move_elems_to_right_inner(struct bps_tree *tree,
 			  b->header.size, b, b);
 	BPS_TREE_DATAMOVE(b->child_ids, a->child_ids + a->header.size - num,
 			  num, b, a);
+	BPS_TREE_CARDMOVE(b->child_cards + num, b->child_cards,
+			  b->header.size, b, b);
+	BPS_TREE_CARDMOVE(b->child_cards,
+			  a->child_cards + a->header.size - num, num, b, a);
 
 	if (!move_to_empty)
 		BPS_TREE_DATAMOVE(b->elems + num, b->elems,
@@ -2457,6 +2975,12 @@ bps_tree_move_elems_to_right_inner(struct bps_tree *tree,
 
 	a->header.size -= num;
 	b->header.size += num;
+	bps_tree_update_card_in_parent(tree, a_inner_path_elem->parent,
+				       a_inner_path_elem->pos_in_parent,
+				       a_inner_path_elem->block_id);
+	bps_tree_update_card_in_parent(tree, b_inner_path_elem->parent,
+				       b_inner_path_elem->pos_in_parent,
+				       b_inner_path_elem->block_id);
 }
 
 /**
@@ -2489,6 +3013,12 @@ bps_tree_move_elems_to_left_leaf(struct bps_tree *tree,
 	a->header.size += num;
 	b->header.size -= num;
 	*a_leaf_path_elem->max_elem_copy = a->elems[a->header.size - 1];
+	bps_tree_update_card_in_parent(tree, a_leaf_path_elem->parent,
+				       a_leaf_path_elem->pos_in_parent,
+				       a_leaf_path_elem->block_id);
+	bps_tree_update_card_in_parent(tree, b_leaf_path_elem->parent,
+				       b_leaf_path_elem->pos_in_parent,
+				       b_leaf_path_elem->block_id);
 }
 
 /**
@@ -2520,6 +3050,10 @@ bps_tree_move_elems_to_left_inner(struct bps_tree *tree,
 			  num, a, b);
 	BPS_TREE_DATAMOVE(b->child_ids, b->child_ids + num,
 			  b->header.size - num, b, b);
+	BPS_TREE_CARDMOVE(a->child_cards + a->header.size, b->child_cards,
+			  num, a, b);
+	BPS_TREE_CARDMOVE(b->child_cards, b->child_cards + num,
+			  b->header.size - num, b, b);
 
 	if (!move_to_empty)
 		a->elems[a->header.size - 1] =
@@ -2536,6 +3070,12 @@ bps_tree_move_elems_to_left_inner(struct bps_tree *tree,
 
 	a->header.size += num;
 	b->header.size -= num;
+	bps_tree_update_card_in_parent(tree, a_inner_path_elem->parent,
+				       a_inner_path_elem->pos_in_parent,
+				       a_inner_path_elem->block_id);
+	bps_tree_update_card_in_parent(tree, b_inner_path_elem->parent,
+				       b_inner_path_elem->pos_in_parent,
+				       b_inner_path_elem->block_id);
 }
 
 /**
@@ -2600,6 +3140,13 @@ bps_tree_insert_and_move_elems_to_right_leaf(struct bps_tree *tree,
 		*b_leaf_path_elem->max_elem_copy =
 			b->elems[b->header.size - 1];
 	tree->size++;
+	bps_tree_add_path_cards(tree, a_leaf_path_elem->parent, 1);
+	bps_tree_update_card_in_parent(tree, a_leaf_path_elem->parent,
+				       a_leaf_path_elem->pos_in_parent,
+				       a_leaf_path_elem->block_id);
+	bps_tree_update_card_in_parent(tree, b_leaf_path_elem->parent,
+				       b_leaf_path_elem->pos_in_parent,
+				       b_leaf_path_elem->block_id);
 }
 
 /**
@@ -2637,6 +3184,8 @@ bps_tree_insert_and_move_elems_to_right_inner(struct bps_tree *tree,
 	if (!move_to_empty) {
 		BPS_TREE_DATAMOVE(b->child_ids + num, b->child_ids,
 				  b->header.size, b, b);
+		BPS_TREE_CARDMOVE(b->child_cards + num, b->child_cards,
+				  b->header.size, b, b);
 		BPS_TREE_DATAMOVE(b->elems + num, b->elems,
 				  b->header.size - 1, b, b);
 	}
@@ -2650,6 +3199,13 @@ bps_tree_insert_and_move_elems_to_right_inner(struct bps_tree *tree,
 		BPS_TREE_DATAMOVE(a->child_ids + pos + 1, a->child_ids + pos,
 				  mid_part_size - num, a, a);
 		a->child_ids[pos] = block_id;
+		BPS_TREE_CARDMOVE(b->child_cards,
+				  a->child_cards + a->header.size - num,
+				  num, b, a);
+		BPS_TREE_CARDMOVE(a->child_cards + pos + 1,
+				  a->child_cards + pos,
+				  mid_part_size - num, a, a);
+		bps_tree_update_child_card(tree, a, pos);
 
 		BPS_TREE_DATAMOVE(b->elems, a->elems + a->header.size - num,
 				  num - 1, b, a);
@@ -2672,6 +3228,13 @@ bps_tree_insert_and_move_elems_to_right_inner(struct bps_tree *tree,
 		BPS_TREE_DATAMOVE(a->child_ids + pos + 1, a->child_ids + pos,
 				  mid_part_size - num, a, a);
 		a->child_ids[pos] = block_id;
+		BPS_TREE_CARDMOVE(b->child_cards,
+				  a->child_cards + a->header.size - num,
+				  num, b, a);
+		BPS_TREE_CARDMOVE(a->child_cards + pos + 1,
+				  a->child_cards + pos,
+				  mid_part_size - num, a, a);
+		bps_tree_update_child_card(tree, a, pos);
 
 		BPS_TREE_DATAMOVE(b->elems, a->elems + a->header.size - num,
 				  num - 1, b, a);
@@ -2691,6 +3254,12 @@ bps_tree_insert_and_move_elems_to_right_inner(struct bps_tree *tree,
 		b->child_ids[new_pos] = block_id;
 		BPS_TREE_DATAMOVE(b->child_ids + new_pos + 1,
 				  a->child_ids + pos, mid_part_size, b, a);
+		BPS_TREE_CARDMOVE(b->child_cards,
+				  a->child_cards + a->header.size - num + 1,
+				  new_pos, b, a);
+		bps_tree_update_child_card(tree, b, new_pos);
+		BPS_TREE_CARDMOVE(b->child_cards + new_pos + 1,
+				  a->child_cards + pos, mid_part_size, b, a);
 
 		if (pos == a->header.size) {
 			/* +1 */
@@ -2735,6 +3304,12 @@ bps_tree_insert_and_move_elems_to_right_inner(struct bps_tree *tree,
 
 	a->header.size -= (num - 1);
 	b->header.size += num;
+	bps_tree_update_card_in_parent(tree, a_inner_path_elem->parent,
+				       a_inner_path_elem->pos_in_parent,
+				       a_inner_path_elem->block_id);
+	bps_tree_update_card_in_parent(tree, b_inner_path_elem->parent,
+				       b_inner_path_elem->pos_in_parent,
+				       b_inner_path_elem->block_id);
 }
 
 /**
@@ -2798,6 +3373,13 @@ bps_tree_insert_and_move_elems_to_left_leaf(struct bps_tree *tree,
 		*b_leaf_path_elem->max_elem_copy =
 			b->elems[b->header.size - 1];
 	tree->size++;
+	bps_tree_add_path_cards(tree, b_leaf_path_elem->parent, 1);
+	bps_tree_update_card_in_parent(tree, a_leaf_path_elem->parent,
+				       a_leaf_path_elem->pos_in_parent,
+				       a_leaf_path_elem->block_id);
+	bps_tree_update_card_in_parent(tree, b_leaf_path_elem->parent,
+				       b_leaf_path_elem->pos_in_parent,
+				       b_leaf_path_elem->block_id);
 }
 
 /**
@@ -2843,6 +3425,14 @@ bps_tree_insert_and_move_elems_to_left_inner(struct bps_tree *tree,
 		BPS_TREE_DATAMOVE(b->child_ids + new_pos + 1,
 				  b->child_ids + pos,
 				  b->header.size - pos, b, b);
+		BPS_TREE_CARDMOVE(a->child_cards + a->header.size,
+				  b->child_cards, num, a, b);
+		BPS_TREE_CARDMOVE(b->child_cards, b->child_cards + num,
+				  new_pos, b, b);
+		BPS_TREE_CARDMOVE(b->child_cards + new_pos + 1,
+				  b->child_cards + pos,
+				  b->header.size - pos, b, b);
+		bps_tree_update_child_card(tree, b, new_pos);
 
 		if (!move_to_empty)
 			a->elems[a->header.size - 1] =
@@ -2884,6 +3474,15 @@ bps_tree_insert_and_move_elems_to_left_inner(struct bps_tree *tree,
 		if (!move_all)
 			BPS_TREE_DATAMOVE(b->child_ids, b->child_ids + num - 1,
 					  b->header.size - num + 1, b, b);
+		BPS_TREE_CARDMOVE(a->child_cards + a->header.size,
+				  b->child_cards, pos, a, b);
+		bps_tree_update_child_card(tree, a, new_pos);
+		BPS_TREE_CARDMOVE(a->child_cards + new_pos + 1,
+				  b->child_cards + pos, num - 1 - pos, a, b);
+		if (!move_all)
+			BPS_TREE_CARDMOVE(b->child_cards,
+					  b->child_cards + num - 1,
+					  b->header.size - num + 1, b, b);
 
 		if (!move_to_empty)
 			a->elems[a->header.size - 1] =
@@ -2928,6 +3527,12 @@ bps_tree_insert_and_move_elems_to_left_inner(struct bps_tree *tree,
 
 	a->header.size += num;
 	b->header.size -= (num - 1);
+	bps_tree_update_card_in_parent(tree, a_inner_path_elem->parent,
+				       a_inner_path_elem->pos_in_parent,
+				       a_inner_path_elem->block_id);
+	bps_tree_update_card_in_parent(tree, b_inner_path_elem->parent,
+				       b_inner_path_elem->pos_in_parent,
+				       b_inner_path_elem->block_id);
 }
 
 /**
@@ -3436,6 +4041,8 @@ bps_tree_process_insert_leaf(struct bps_tree *tree,
 		new_root->header.size = 2;
 		new_root->child_ids[0] = tree->root_id;
 		new_root->child_ids[1] = new_block_id;
+		bps_tree_update_child_card(tree, new_root, 0);
+		bps_tree_update_child_card(tree, new_root, 1);
 		new_root->elems[0] = tree->max_elem;
 		tree->root_id = new_root_id;
 		tree->max_elem = new_max_elem;
@@ -3752,6 +4359,8 @@ bps_tree_process_insert_inner(struct bps_tree *tree,
 		new_root->header.size = 2;
 		new_root->child_ids[0] = tree->root_id;
 		new_root->child_ids[1] = new_block_id;
+		bps_tree_update_child_card(tree, new_root, 0);
+		bps_tree_update_child_card(tree, new_root, 1);
 		new_root->elems[0] = tree->max_elem;
 		tree->root_id = new_root_id;
 		tree->max_elem = new_max_elem;
@@ -4306,13 +4915,22 @@ bps_tree_debug_check_block(const struct bps_tree *tree, struct bps_block *block,
 				result |= 0x4000000;
 		}
 
-		for (bps_tree_pos_t i = 0; i < block->size; i++)
+		for (bps_tree_pos_t i = 0; i < block->size; i++) {
+			size_t child_count = *calc_count;
 			result |= bps_tree_debug_check_block(tree,
 				bps_tree_restore_block(tree,
 						       inner->child_ids[i]),
 				inner->child_ids[i], level - 1, calc_count,
 				expected_prev_id, expected_this_id,
 				check_fullness_next);
+			child_count = *calc_count - child_count;
+#ifdef BPS_INNER_CHILD_CARDS
+			if (inner->child_cards[i] != child_count)
+				result |= 0x8000000;
+#else
+			(void)child_count;
+#endif
+		}
 		return result;
 	}
 }
@@ -4552,6 +5170,8 @@ bps_tree_debug_check_insert_into_leaf(struct bps_tree *tree, bool assertme)
 			bps_tree_debug_set_elem(&ins, j);
 			path_elem.block = &block;
 			path_elem.block_id = 0;
+			path_elem.parent = 0;
+			path_elem.pos_in_parent = 0;
 			path_elem.insertion_point = j;
 			path_elem.max_elem_copy = &max;
 			path_elem.max_elem_block_id = -1;
@@ -4607,6 +5227,8 @@ bps_tree_debug_check_delete_from_leaf(struct bps_tree *tree, bool assertme)
 				j == i - 1 ? i - 2 : i - 1);
 			path_elem.block = &block;
 			path_elem.block_id = 0;
+			path_elem.parent = 0;
+			path_elem.pos_in_parent = 0;
 			path_elem.insertion_point = j;
 			path_elem.max_elem_copy = &max;
 			path_elem.max_elem_block_id = -1;
@@ -4688,7 +5310,11 @@ bps_tree_debug_check_move_to_right_leaf(struct bps_tree *tree, bool assertme)
 				b_path_elem.max_elem_block_id = -1;
 				b_path_elem.max_elem_pos = -1;
 				a_path_elem.block_id = 0;
+				a_path_elem.parent = 0;
+				a_path_elem.pos_in_parent = 0;
 				b_path_elem.block_id = 0;
+				b_path_elem.parent = 0;
+				b_path_elem.pos_in_parent = 0;
 
 				bps_tree_move_elems_to_right_leaf(tree,
 					&a_path_elem, &b_path_elem,
@@ -4785,7 +5411,11 @@ bps_tree_debug_check_move_to_left_leaf(struct bps_tree *tree, bool assertme)
 				b_path_elem.max_elem_block_id = -1;
 				b_path_elem.max_elem_pos = -1;
 				a_path_elem.block_id = 0;
+				a_path_elem.parent = 0;
+				a_path_elem.pos_in_parent = 0;
 				b_path_elem.block_id = 0;
+				b_path_elem.parent = 0;
+				b_path_elem.pos_in_parent = 0;
 
 				bps_tree_move_elems_to_left_leaf(tree,
 					&a_path_elem, &b_path_elem,
@@ -4891,7 +5521,11 @@ bps_tree_debug_check_insert_and_move_to_right_leaf(struct bps_tree *tree,
 					b_path_elem.max_elem_pos = -1;
 					a_path_elem.insertion_point = k;
 					a_path_elem.block_id = 0;
+					a_path_elem.parent = 0;
+					a_path_elem.pos_in_parent = 0;
 					b_path_elem.block_id = 0;
+					b_path_elem.parent = 0;
+					b_path_elem.pos_in_parent = 0;
 					bps_tree_elem_t ins;
 					bps_tree_debug_set_elem(&ins, ic);
 
@@ -5007,7 +5641,11 @@ bps_tree_debug_check_insert_and_move_to_left_leaf(struct bps_tree *tree,
 					b_path_elem.max_elem_pos = -1;
 					b_path_elem.insertion_point = k;
 					a_path_elem.block_id = 0;
+					a_path_elem.parent = 0;
+					a_path_elem.pos_in_parent = 0;
 					b_path_elem.block_id = 0;
+					b_path_elem.parent = 0;
+					b_path_elem.pos_in_parent = 0;
 					bps_tree_elem_t ins;
 					bps_tree_debug_set_elem(&ins, ic);
 
@@ -5094,6 +5732,8 @@ bps_tree_debug_check_insert_into_inner(struct bps_tree *tree, bool assertme)
 			struct bps_inner_path_elem path_elem;
 			path_elem.block = &block;
 			path_elem.block_id = 0;
+			path_elem.parent = 0;
+			path_elem.pos_in_parent = 0;
 			path_elem.max_elem_copy = &max;
 			path_elem.max_elem_block_id = -1;
 			path_elem.max_elem_pos = -1;
@@ -5161,6 +5801,8 @@ bps_tree_debug_check_delete_from_inner(struct bps_tree *tree, bool assertme)
 			bps_tree_debug_set_elem(&max, i - 1);
 			path_elem.block = &block;
 			path_elem.block_id = 0;
+			path_elem.parent = 0;
+			path_elem.pos_in_parent = 0;
 			path_elem.insertion_point = j;
 			path_elem.max_elem_copy = &max;
 			path_elem.max_elem_block_id = -1;
@@ -5230,7 +5872,11 @@ bps_tree_debug_check_move_to_right_inner(struct bps_tree *tree, bool assertme)
 				b_path_elem.max_elem_block_id = -1;
 				b_path_elem.max_elem_pos = -1;
 				a_path_elem.block_id = 0;
+				a_path_elem.parent = 0;
+				a_path_elem.pos_in_parent = 0;
 				b_path_elem.block_id = 0;
+				b_path_elem.parent = 0;
+				b_path_elem.pos_in_parent = 0;
 
 				unsigned char c = 0;
 				bps_tree_block_id_t kk = 0;
@@ -5330,7 +5976,11 @@ bps_tree_debug_check_move_to_left_inner(struct bps_tree *tree, bool assertme)
 				b_path_elem.max_elem_block_id = -1;
 				b_path_elem.max_elem_pos = -1;
 				a_path_elem.block_id = 0;
+				a_path_elem.parent = 0;
+				a_path_elem.pos_in_parent = 0;
 				b_path_elem.block_id = 0;
+				b_path_elem.parent = 0;
+				b_path_elem.pos_in_parent = 0;
 
 				unsigned char c = 0;
 				bps_tree_block_id_t kk = 0;
@@ -5436,7 +6086,11 @@ bps_tree_debug_check_insert_and_move_to_right_inner(struct bps_tree *tree,
 					b_path_elem.max_elem_block_id = -1;
 					b_path_elem.max_elem_pos = -1;
 					a_path_elem.block_id = 0;
+					a_path_elem.parent = 0;
+					a_path_elem.pos_in_parent = 0;
 					b_path_elem.block_id = 0;
+					b_path_elem.parent = 0;
+					b_path_elem.pos_in_parent = 0;
 
 					unsigned char c = 0;
 					bps_tree_block_id_t kk = 0;
@@ -5568,7 +6222,11 @@ bps_tree_debug_check_insert_and_move_to_left_inner(struct bps_tree *tree,
 					b_path_elem.max_elem_block_id = -1;
 					b_path_elem.max_elem_pos = -1;
 					a_path_elem.block_id = 0;
+					a_path_elem.parent = 0;
+					a_path_elem.pos_in_parent = 0;
 					b_path_elem.block_id = 0;
+					b_path_elem.parent = 0;
+					b_path_elem.pos_in_parent = 0;
 
 					unsigned char c = 0;
 					bps_tree_block_id_t kk = 0;
@@ -5688,6 +6346,7 @@ bps_tree_debug_check_internal_functions(bool assertme)
 
 #undef BPS_TREE_MEMMOVE
 #undef BPS_TREE_DATAMOVE
+#undef BPS_TREE_CARDMOVE
 #undef BPS_TREE_BRANCH_TRACE
 
 /* {{{ Macros for custom naming of structs and functions */
@@ -5710,6 +6369,7 @@ bps_tree_debug_check_internal_functions(bool assertme)
 #undef bps_tree_build
 #undef bps_tree_destroy
 #undef bps_tree_find
+#undef bps_tree_find_batch
 #undef bps_tree_insert
 #undef bps_tree_delete
 #undef bps_tree_size
@@ -5723,6 +6383,10 @@ bps_tree_debug_check_internal_functions(bool assertme)
 #undef bps_tree_lower_bound
 #undef bps_tree_upper_bound
 #undef bps_tree_approximate_count
+#undef bps_tree_lower_bound_get_offset
+#undef bps_tree_upper_bound_get_offset
+#undef bps_tree_iterator_at
+#undef bps_tree_iterator_get_offset
 #undef bps_tree_iterator_get_elem
 #undef bps_tree_iterator_next
 #undef bps_tree_iterator_prev
@@ -5745,6 +6409,7 @@ bps_tree_debug_check_internal_functions(bool assertme)
 #undef bps_tree_restore_block_ver
 #undef bps_tree_root
 #undef bps_tree_touch_block
+#undef bps_tree_prefetch_block
 #undef bps_tree_find_ins_point_key
 #undef bps_tree_find_ins_point_elem
 #undef bps_tree_find_after_ins_point_key
@@ -5761,6 +6426,10 @@ bps_tree_debug_check_internal_functions(bool assertme)
 #undef bps_tree_touch_leaf_path_max_elem
 #undef bps_tree_touch_path
 #undef bps_tree_process_replace
+#undef bps_tree_block_card
+#undef bps_tree_update_child_card
+#undef bps_tree_update_card_in_parent
+#undef bps_tree_add_path_cards
 #undef bps_tree_debug_memmove
 #undef bps_tree_insert_into_leaf
 #undef bps_tree_insert_into_inner
@@ -216,6 +216,17 @@ LIGHT(find)(const struct LIGHT(core) *ht, uint32_t hash, LIGHT_DATA_TYPE data);
 uint32_t
 LIGHT(find_key)(const struct LIGHT(core) *ht, uint32_t hash, LIGHT_KEY_TYPE data);
 
+/**
+ * @brief Prefetch the record a search for the given hash starts
+ *  with, so that a following find or find_key doesn't stall on a
+ *  cache miss. Prefetching records of a batch of hashes before
+ *  searching any of them overlaps the misses.
+ * @param ht - pointer to a hash table struct
+ * @param hash - hash to be searched for
+ */
+void
+LIGHT(prefetch)(const struct LIGHT(core) *ht, uint32_t hash);
+
 /**
  * @brief Insert a record with given hash and value
  * @param ht - pointer to a hash table struct
@@ -440,6 +451,20 @@ LIGHT(find_key)(const struct LIGHT(core) *ht, uint32_t hash, LIGHT_KEY_TYPE key)
 	return LIGHT(end);
 }
 
+/**
+ * @brief Prefetch the record a search for the given hash starts with
+ * @param ht - pointer to a hash table struct
+ * @param hash - hash to be searched for
+ */
+inline void
+LIGHT(prefetch)(const struct LIGHT(core) *ht, uint32_t hash)
+{
+	if (ht->count == 0)
+		return;
+	uint32_t slot = LIGHT(slot)(ht, hash);
+	__builtin_prefetch(matras_get(&ht->mtable, slot));
+}
+
 /**
  * @brief Replace a record with given hash and value
  * @param ht - pointer to a hash table struct
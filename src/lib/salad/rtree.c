@@ -30,10 +30,14 @@
  */
 #include "rtree.h"
 #include <string.h>
+#include <stdlib.h>
 #include <assert.h>
 #include <limits.h>
 #include <stddef.h>
 #include <sys/types.h>
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
 
 /*------------------------------------------------------------------------- */
 /* R-tree internal structures definition */
@@ -75,6 +79,13 @@ struct rtree_reinsert_list {
 	int level;
 };
 
+/* Branch to be packed into a page by rtree_build */
+struct rtree_bulk_item {
+	/* Doubled center of the branch rectangle along the sort axis */
+	coord_t key;
+	struct rtree_page_branch *branch;
+};
+
 static int
 neighbor_cmp(struct rtree_neighbor *a, struct rtree_neighbor *b)
 {
@@ -716,6 +727,177 @@ rtree_page_purge(struct rtree *tree, struct rtree_page *page, int level)
 	rtree_page_free(tree, page);
 }
 
+/*------------------------------------------------------------------------- */
+/* R-tree bulk loading */
+/*------------------------------------------------------------------------- */
+
+static int
+rtree_bulk_item_cmp(const void *a, const void *b)
+{
+	coord_t ka = ((const struct rtree_bulk_item *)a)->key;
+	coord_t kb = ((const struct rtree_bulk_item *)b)->key;
+	return ka < kb ? -1 : ka > kb ? 1 : 0;
+}
+
+/* Smallest number of slabs s such that s^dims >= pages */
+static size_t
+rtree_str_slab_count(size_t pages, unsigned dims)
+{
+	for (size_t s = 1; ; s++) {
+		size_t p = 1;
+		for (unsigned i = 0; i < dims && p < pages; i++)
+			p *= s;
+		if (p >= pages)
+			return s;
+	}
+}
+
+/*
+ * Sort-Tile-Recursive ordering: sort items along the axis,
+ * cut them into slabs holding a whole number of pages and
+ * order every slab along the remaining axes. After that
+ * every run of page_max_fill consecutive items forms a
+ * compact page.
+ */
+static void
+rtree_str_sort(const struct rtree *tree, struct rtree_bulk_item *items,
+	       size_t n, unsigned axis)
+{
+	for (size_t i = 0; i < n; i++) {
+		const coord_t *coords = &items[i].branch->rect.coords[2 * axis];
+		items[i].key = coords[0] + coords[1];
+	}
+	qsort(items, n, sizeof(*items), rtree_bulk_item_cmp);
+	unsigned dims = tree->dimension - axis;
+	if (dims == 1)
+		return;
+	size_t fill = tree->page_max_fill;
+	size_t pages = (n + fill - 1) / fill;
+	size_t slabs = rtree_str_slab_count(pages, dims);
+	size_t slab_size = fill * ((pages + slabs - 1) / slabs);
+	for (size_t i = 0; i < n; i += slab_size) {
+		size_t size = n - i < slab_size ? n - i : slab_size;
+		rtree_str_sort(tree, items + i, size, axis + 1);
+	}
+}
+
+/*
+ * Pack ordered items into pages, page_max_fill items per page.
+ * If the last page turns out to be underfilled, share items of
+ * the previous page with it.
+ */
+static void
+rtree_str_pack(const struct rtree *tree, struct rtree_bulk_item *items,
+	       size_t n, struct rtree_page **pages, size_t n_pages)
+{
+	unsigned d = tree->dimension;
+	size_t fill = tree->page_max_fill;
+	for (size_t p = 0; p < n_pages; p++) {
+		size_t begin = p * fill;
+		size_t end = n - begin < fill ? n : begin + fill;
+		struct rtree_page *page = pages[p];
+		page->n = end - begin;
+		for (size_t i = begin; i < end; i++) {
+			rtree_branch_copy(rtree_branch_get(tree, page,
+							   i - begin),
+					  items[i].branch, d);
+		}
+	}
+	struct rtree_page *last = pages[n_pages - 1];
+	if (n_pages == 1 || last->n >= tree->page_min_fill)
+		return;
+	struct rtree_page *prev = pages[n_pages - 2];
+	unsigned move = (prev->n - last->n) / 2;
+	for (unsigned i = 0; i < move; i++) {
+		rtree_branch_copy(rtree_branch_get(tree, last, last->n++),
+				  rtree_branch_get(tree, prev, --prev->n), d);
+	}
+}
+
+/*------------------------------------------------------------------------- */
+/* R-tree page matching */
+/*------------------------------------------------------------------------- */
+
+#if defined(__SSE2__)
+/*
+ * 2D versions of rtree_rect_intersects_rect and rtree_rect_in_rect
+ * that test all branches of a page. Every condition of the scalar
+ * version is rewritten as "a > b" with a sign flip where needed and
+ * checked with cmpngt for both coordinates of an axis at once. Like
+ * the scalar versions, they treat comparisons with NaN as passed.
+ */
+static uint64_t
+rtree_page_match_intersects2(const struct rtree *tree,
+			     const struct rtree_page *pg,
+			     const struct rtree_rect *rect)
+{
+	const __m128d sign = _mm_set_pd(-0.0, 0.0);
+	/* (x0, -x1) and (y0, -y1) of the rectangle */
+	__m128d qx = _mm_xor_pd(_mm_loadu_pd(&rect->coords[0]), sign);
+	__m128d qy = _mm_xor_pd(_mm_loadu_pd(&rect->coords[2]), sign);
+	uint64_t match = 0;
+	for (unsigned i = 0, n = pg->n; i < n; i++) {
+		const coord_t *c = rtree_branch_get(tree, pg, i)->rect.coords;
+		/* (x1, -x0) and (y1, -y0) of the branch */
+		__m128d bx = _mm_loadu_pd(&c[0]);
+		__m128d by = _mm_loadu_pd(&c[2]);
+		bx = _mm_xor_pd(_mm_shuffle_pd(bx, bx, 1), sign);
+		by = _mm_xor_pd(_mm_shuffle_pd(by, by, 1), sign);
+		__m128d ok = _mm_and_pd(_mm_cmpngt_pd(qx, bx),
+					_mm_cmpngt_pd(qy, by));
+		match |= (uint64_t)(_mm_movemask_pd(ok) == 3) << i;
+	}
+	return match;
+}
+
+static uint64_t
+rtree_page_match_in_rect2(const struct rtree *tree,
+			  const struct rtree_page *pg,
+			  const struct rtree_rect *rect)
+{
+	const __m128d sign = _mm_set_pd(0.0, -0.0);
+	/* (-x0, x1) and (-y0, y1) of the rectangle */
+	__m128d qx = _mm_xor_pd(_mm_loadu_pd(&rect->coords[0]), sign);
+	__m128d qy = _mm_xor_pd(_mm_loadu_pd(&rect->coords[2]), sign);
+	uint64_t match = 0;
+	for (unsigned i = 0, n = pg->n; i < n; i++) {
+		const coord_t *c = rtree_branch_get(tree, pg, i)->rect.coords;
+		/* (-x0, x1) and (-y0, y1) of the branch */
+		__m128d bx = _mm_xor_pd(_mm_loadu_pd(&c[0]), sign);
+		__m128d by = _mm_xor_pd(_mm_loadu_pd(&c[2]), sign);
+		__m128d ok = _mm_and_pd(_mm_cmpngt_pd(qx, bx),
+					_mm_cmpngt_pd(qy, by));
+		match |= (uint64_t)(_mm_movemask_pd(ok) == 3) << i;
+	}
+	return match;
+}
+#endif /* defined(__SSE2__) */
+
+/*
+ * Test all branches of a page with a comparator and return
+ * the mask of the branches it accepted.
+ */
+static uint64_t
+rtree_page_match(const struct rtree *tree, const struct rtree_page *pg,
+		 const struct rtree_rect *rect, rtree_comparator_t cmp)
+{
+	unsigned d = tree->dimension;
+	if (cmp == rtree_always_true)
+		return pg->n == 64 ? UINT64_MAX : (UINT64_C(1) << pg->n) - 1;
+#if defined(__SSE2__)
+	if (d == 2 && cmp == rtree_rect_intersects_rect)
+		return rtree_page_match_intersects2(tree, pg, rect);
+	if (d == 2 && cmp == rtree_rect_in_rect)
+		return rtree_page_match_in_rect2(tree, pg, rect);
+#endif
+	uint64_t match = 0;
+	for (unsigned i = 0, n = pg->n; i < n; i++) {
+		struct rtree_page_branch *b = rtree_branch_get(tree, pg, i);
+		match |= (uint64_t)cmp(rect, &b->rect, d) << i;
+	}
+	return match;
+}
+
 /*------------------------------------------------------------------------- */
 /* R-tree iterator methods */
 /*------------------------------------------------------------------------- */
@@ -724,29 +906,20 @@ static bool
 rtree_iterator_goto_first(struct rtree_iterator *itr, unsigned sp,
 			  struct rtree_page* pg)
 {
-	unsigned d = itr->tree->dimension;
-	if (sp + 1 == itr->tree->height) {
-		for (unsigned i = 0, n = pg->n; i < n; i++) {
-			struct rtree_page_branch *b;
-			b = rtree_branch_get(itr->tree, pg, i);
-			if (itr->leaf_cmp(&itr->rect, &b->rect, d)) {
-				itr->stack[sp].page = pg;
-				itr->stack[sp].pos = i;
-				return true;
-			}
-		}
-	} else {
-		for (unsigned i = 0, n = pg->n; i < n; i++) {
-			struct rtree_page_branch *b;
-			b = rtree_branch_get(itr->tree, pg, i);
-			if (itr->intr_cmp(&itr->rect, &b->rect, d)
-			    && rtree_iterator_goto_first(itr, sp + 1,
-							 b->data.page))
-			{
-				itr->stack[sp].page = pg;
-				itr->stack[sp].pos = i;
-				return true;
-			}
+	bool is_leaf = sp + 1 == itr->tree->height;
+	uint64_t match = rtree_page_match(itr->tree, pg, &itr->rect,
+					  is_leaf ? itr->leaf_cmp :
+					  itr->intr_cmp);
+	while (match != 0) {
+		int i = __builtin_ctzll(match);
+		match &= match - 1;
+		if (is_leaf ||
+		    rtree_iterator_goto_first(itr, sp + 1,
+				rtree_branch_get(itr->tree, pg, i)->data.page)) {
+			itr->stack[sp].page = pg;
+			itr->stack[sp].pos = i;
+			itr->stack[sp].match = match;
+			return true;
 		}
 	}
 	return false;
@@ -756,31 +929,21 @@ rtree_iterator_goto_first(struct rtree_iterator *itr, unsigned sp,
 static bool
 rtree_iterator_goto_next(struct rtree_iterator *itr, unsigned sp)
 {
-	unsigned d = itr->tree->dimension;
+	bool is_leaf = sp + 1 == itr->tree->height;
 	struct rtree_page *pg = itr->stack[sp].page;
-	if (sp + 1 == itr->tree->height) {
-		for (unsigned i = itr->stack[sp].pos, n = pg->n; ++i < n;) {
-			struct rtree_page_branch *b;
-			b = rtree_branch_get(itr->tree, pg, i);
-			if (itr->leaf_cmp(&itr->rect, &b->rect, d)) {
-				itr->stack[sp].pos = i;
-				return true;
-			}
-		}
-	} else {
-		for (int i = itr->stack[sp].pos, n = pg->n; ++i < n;) {
-			struct rtree_page_branch *b;
-			b = rtree_branch_get(itr->tree, pg, i);
-			if (itr->intr_cmp(&itr->rect, &b->rect, d)
-			    && rtree_iterator_goto_first(itr, sp + 1,
-							 b->data.page))
-			{
-				itr->stack[sp].page = pg;
-				itr->stack[sp].pos = i;
-				return true;
-			}
+	uint64_t match = itr->stack[sp].match;
+	while (match != 0) {
+		int i = __builtin_ctzll(match);
+		match &= match - 1;
+		if (is_leaf ||
+		    rtree_iterator_goto_first(itr, sp + 1,
+				rtree_branch_get(itr->tree, pg, i)->data.page)) {
+			itr->stack[sp].pos = i;
+			itr->stack[sp].match = match;
+			return true;
 		}
 	}
+	itr->stack[sp].match = 0;
 	return sp > 0 ? rtree_iterator_goto_next(itr, sp - 1) : false;
 }
 
@@ -870,16 +1033,14 @@ rtree_iterator_process_neigh(struct rtree_iterator *itr,
 	struct rtree_page *pg = (struct rtree_page *)child;
 	int level = neighbor->level;
 	rtree_iterator_free_neighbor(itr, neighbor);
+	sq_coord_t (*neigh_distance)(const struct rtree_rect *,
+				     const struct rtree_rect *, unsigned) =
+		itr->tree->distance_type == RTREE_EUCLID ?
+		rtree_rect_neigh_distance2 : rtree_rect_neigh_distance;
 	for (int i = 0, n = pg->n; i < n; i++) {
 		struct rtree_page_branch *b;
 		b = rtree_branch_get(itr->tree, pg, i);
-		coord_t distance;
-		if (itr->tree->distance_type == RTREE_EUCLID)
-			distance = rtree_rect_neigh_distance2(&b->rect,
-							      &itr->rect, d);
-		else
-			distance = rtree_rect_neigh_distance(&b->rect,
-							     &itr->rect, d);
+		coord_t distance = neigh_distance(&b->rect, &itr->rect, d);
 		struct rtree_neighbor *neigh =
 			rtree_iterator_new_neighbor(itr, b->data.page,
 						    distance, level - 1);
@@ -966,6 +1127,8 @@ rtree_init(struct rtree *tree, unsigned dimension, uint32_t extent_size,
 	tree->page_max_fill = (tree->page_size - sizeof(int)) /
 		tree->page_branch_size;
 	tree->page_min_fill = tree->page_max_fill * 2 / 5;
+	/* Matching branches of a page are collected in a 64-bit mask */
+	assert(tree->page_max_fill <= 64);
 	tree->neighbours_in_page = (tree->page_size - sizeof(void *))
 		/ sizeof(struct rtree_neighbor);
 
@@ -1006,6 +1169,82 @@ rtree_insert(struct rtree *tree, struct rtree_rect *rect, record_t obj)
 	tree->n_records++;
 }
 
+int
+rtree_build(struct rtree *tree, const record_t *records, size_t count,
+	    rtree_rect_extract_t extract_rect, void *ctx)
+{
+	assert(tree->root == NULL);
+	if (count == 0)
+		return 0;
+	unsigned d = tree->dimension;
+	size_t fill = tree->page_max_fill;
+	size_t total_pages = 0;
+	for (size_t n = count; n > 1 || total_pages == 0; ) {
+		n = (n + fill - 1) / fill;
+		total_pages += n;
+	}
+	char *branches = (char *)malloc(count * tree->page_branch_size);
+	struct rtree_bulk_item *items = (struct rtree_bulk_item *)
+		malloc(count * sizeof(*items));
+	struct rtree_page **pages = (struct rtree_page **)
+		malloc(total_pages * sizeof(*pages));
+	size_t used_pages = 0;
+	unsigned height = 0;
+	size_t n = count;
+	int rc = -1;
+	if (branches == NULL || items == NULL || pages == NULL)
+		goto out;
+
+	for (size_t i = 0; i < count; i++) {
+		struct rtree_page_branch *b = (struct rtree_page_branch *)
+			(branches + i * tree->page_branch_size);
+		struct rtree_rect rect;
+		extract_rect(&rect, records[i], ctx);
+		rtree_rect_copy(&b->rect, &rect, d);
+		b->data.record = records[i];
+		items[i].branch = b;
+	}
+	while (true) {
+		rtree_str_sort(tree, items, n, 0);
+		size_t n_pages = (n + fill - 1) / fill;
+		struct rtree_page **level = pages + used_pages;
+		for (size_t p = 0; p < n_pages; p++) {
+			level[p] = rtree_page_alloc(tree);
+			if (level[p] == NULL)
+				goto out;
+			used_pages++;
+		}
+		rtree_str_pack(tree, items, n, level, n_pages);
+		height++;
+		if (n_pages == 1)
+			break;
+		/* Pages of the level are branches of the next one. */
+		for (size_t p = 0; p < n_pages; p++) {
+			struct rtree_page_branch *b = (struct rtree_page_branch *)
+				(branches + p * tree->page_branch_size);
+			rtree_page_cover(tree, level[p], &b->rect);
+			b->data.page = level[p];
+			items[p].branch = b;
+		}
+		n = n_pages;
+	}
+	assert(used_pages == total_pages);
+	tree->root = pages[used_pages - 1];
+	tree->height = height;
+	tree->n_pages += used_pages;
+	tree->n_records = count;
+	tree->version++;
+	used_pages = 0;
+	rc = 0;
+out:
+	for (size_t p = 0; p < used_pages; p++)
+		rtree_page_free(tree, pages[p]);
+	free(pages);
+	free(items);
+	free(branches);
+	return rc;
+}
+
 bool
 rtree_remove(struct rtree *tree, const struct rtree_rect *rect, record_t obj)
 {
@@ -1116,8 +1355,9 @@ rtree_search(const struct rtree *tree, const struct rtree_rect *rect,
 		}
 	}
 	if (tree->root && rtree_iterator_goto_first(itr, 0, tree->root)) {
-		itr->stack[tree->height-1].pos -= 1;
-		/* will be incremented by goto_next */
+		unsigned sp = tree->height - 1;
+		itr->stack[sp].match |= UINT64_C(1) << itr->stack[sp].pos;
+		/* will be taken by goto_next */
 		itr->eof = false;
 		return true;
 	} else {
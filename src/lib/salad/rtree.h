@@ -31,6 +31,7 @@
  * SUCH DAMAGE.
  */
 #include <stddef.h>
+#include <stdint.h>
 #include <stdbool.h>
 #include "small/matras.h"
 
@@ -114,6 +115,10 @@ typedef bool (*rtree_comparator_t)(const struct rtree_rect *rt1,
 				   const struct rtree_rect *rt2,
 				   unsigned dimension);
 
+/* Type of function, filling the rectangle of a record */
+typedef void (*rtree_rect_extract_t)(struct rtree_rect *rect, record_t record,
+				     void *ctx);
+
 /* Type distance comparison */
 enum rtree_distance_type {
 	RTREE_EUCLID = 0, /* Euclid distance, sqrt(dx*dx + dy*dy) */
@@ -195,6 +200,8 @@ struct rtree_iterator
 	struct {
 		struct rtree_page *page;
 		int pos;
+		/* Bit mask of matching branches after pos */
+		uint64_t match;
 	} stack[RTREE_MAX_HEIGHT];
 };
 
@@ -275,6 +282,24 @@ rtree_search(const struct rtree *tree, const struct rtree_rect *rect,
 void
 rtree_insert(struct rtree *tree, struct rtree_rect *rect, record_t obj);
 
+/**
+ * @brief Fill an empty tree with records using Sort-Tile-Recursive
+ * packing. Records are sorted by the centers of their rectangles
+ * along every axis in turn and packed into completely filled pages,
+ * bottom-up. Compared to inserting the records one by one, it is
+ * much faster and gives pages with less overlap.
+ * @param tree - pointer to an empty tree
+ * @param records - array of records to insert
+ * @param count - number of records in the array
+ * @param extract_rect - function filling the rectangle of a record
+ * @param ctx - argument passed to extract_rect
+ * @return 0 on success, -1 on memory allocation error (the tree is
+ *  left empty)
+ */
+int
+rtree_build(struct rtree *tree, const record_t *records, size_t count,
+	    rtree_rect_extract_t extract_rect, void *ctx);
+
 /**
  * @brief Remove the record from a tree
  * @return true if the record deleted (false otherwise)
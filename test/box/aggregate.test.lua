@@ -0,0 +1,45 @@
+s = box.schema.space.create('aggregate')
+pk = s:create_index('pk')
+sk = s:create_index('sk', {parts = {2, 'unsigned'}, unique = false})
+for i = 1, 10 do s:insert{i, i % 3, i * 1.5} end
+s:aggregate(1, 'count')
+s:aggregate(1, 'sum')
+s:aggregate(1, 'min')
+s:aggregate(1, 'max')
+s:aggregate(1, 'avg')
+s:aggregate(3, 'sum')
+pk:aggregate(1, 'sum', 5, {iterator = 'GT'})
+pk:aggregate(1, 'count', 5, {iterator = 'LE'})
+sk:aggregate(1, 'sum', 0)
+sk:aggregate(3, 'max', 1)
+-- absent fields are skipped
+s:aggregate(4, 'sum')
+s:aggregate(4, 'min')
+s:insert{11, 2}
+s:aggregate(3, 'count')
+-- errors
+s:insert{12, 2, 'abc'}
+s:aggregate(3, 'sum')
+s:aggregate(1, 'median')
+s:aggregate('a', 'sum')
+s:aggregate(0, 'sum')
+s:drop()
+-- integers are aggregated exactly
+s = box.schema.space.create('aggregate')
+pk = s:create_index('pk')
+_ = s:insert{1, 9007199254740993ULL}
+_ = s:insert{2, 1}
+_ = s:insert{3, -9223372036854775807LL}
+_ = s:insert{4, 18446744073709551615ULL}
+_ = s:insert{5, 18446744073709551615ULL}
+_ = s:insert{6, 0.5}
+_ = s:insert{7, 2}
+pk:aggregate(2, 'sum', 2, {iterator = 'LE'})
+pk:aggregate(2, 'sum', 3, {iterator = 'LE'})
+pk:aggregate(2, 'min', 3, {iterator = 'LE'})
+s:aggregate(2, 'max')
+s:aggregate(2, 'count')
+pk:aggregate(2, 'sum', 5, {iterator = 'LE'})
+-- a floating point value makes the sum a double
+pk:aggregate(2, 'sum', 6, {iterator = 'GE'})
+s:drop()
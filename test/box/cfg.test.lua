@@ -25,6 +25,13 @@ box.cfg{replication = {}}
 box.cfg{memtx_memory = "100500"}
 box.cfg{vinyl = "vinyl"}
 box.cfg{vinyl_threads = "threads"}
+-- vinyl_threads can be changed at runtime
+box.cfg{vinyl_threads = 1}
+box.cfg.vinyl_threads
+box.cfg{vinyl_threads = 4}
+box.cfg.vinyl_threads
+box.cfg{vinyl_threads = 2}
+box.cfg.vinyl_threads
 
 
 --------------------------------------------------------------------------------
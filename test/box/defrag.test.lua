@@ -0,0 +1,36 @@
+fiber = require('fiber')
+s = box.schema.space.create('defrag')
+pk = s:create_index('pk')
+hk = s:create_index('hk', {type = 'hash', parts = {2, 'unsigned'}})
+bk = s:create_index('bk', {type = 'bitset', parts = {3, 'unsigned'}, unique = false})
+tk = s:create_index('tk', {parts = {3, 'unsigned'}, unique = false})
+-- fragment the arena with tuples of different sizes
+for i = 1, 40000 do s:insert{i, i, i % 8, string.rep('x', 100 + i % 300)} end
+for i = 1, 40000 do if i % 4 ~= 0 then s:delete{i} end end
+-- tuples referenced from Lua are not moved
+collectgarbage('collect')
+box.slab.defrag_info().running
+box.slab.defrag_info().ratio > 0.5
+box.cfg{memtx_defrag_threshold = 0.3}
+while box.slab.defrag_info().passes == 0 do fiber.sleep(0.01) end
+box.cfg{memtx_defrag_threshold = 0}
+box.slab.defrag_info().moved > 0
+box.slab.defrag_info().moved_size > 0
+-- all indexes point to the relocated tuples
+s:count()
+pk:min()[1], pk:max()[1]
+good = 0
+for i = 4, 40000, 4 do local t = hk:get{i} if t ~= nil and t[1] == i and #t[4] == 100 + i % 300 then good = good + 1 end end
+good
+bk:count(4)
+tk:count(4)
+tk:count()
+bad = 0
+for _, t in tk:pairs() do if hk:get{t[2]}[1] ~= t[1] or t[3] ~= t[1] % 8 then bad = bad + 1 end end
+bad
+s:drop()
+-- invalid values
+box.cfg{memtx_defrag_threshold = 1}
+box.cfg{memtx_defrag_threshold = -0.5}
+box.cfg{memtx_defrag_budget = 0}
+box.cfg.memtx_defrag_threshold, box.cfg.memtx_defrag_budget
@@ -0,0 +1,36 @@
+fiber = require('fiber')
+errinj = box.error.injection
+--
+-- Tuples of a transaction waiting for WAL are not moved: if
+-- the write fails, the rollback puts the original tuples back.
+--
+tmp = box.schema.space.create('tmp', {temporary = true})
+_ = tmp:create_index('pk')
+s = box.schema.space.create('test')
+_ = s:create_index('pk')
+_ = s:create_index('sk', {parts = {2, 'unsigned'}})
+-- fill the lower slabs with tuples which are not written to WAL
+for i = 1, 40000 do tmp:insert{i, i, string.rep('x', 300)} end
+errinj.set('ERRINJ_WAL_WRITE', true)
+errinj.set('ERRINJ_WAL_DELAY', true)
+function insert() box.begin() for i = 1, 10000 do s:insert{i, i, string.rep('x', 300)} end ok, err = pcall(box.commit) end
+f = fiber.create(insert)
+s:count()
+-- free space for the tuples of the transaction in the lower slabs
+for i = 1, 40000 do if i % 4 ~= 0 then tmp:delete{i} end end
+passes = box.slab.defrag_info().passes
+box.cfg{memtx_defrag_threshold = 0.3}
+while box.slab.defrag_info().passes == passes do fiber.sleep(0.01) end
+box.cfg{memtx_defrag_threshold = 0}
+f:status()
+while f:status() ~= 'dead' do fiber.sleep(0.01) end
+ok, tostring(err)
+errinj.set('ERRINJ_WAL_WRITE', false)
+s:count()
+s.index.sk:count()
+tmp:count()
+good = 0
+for i = 4, 40000, 4 do local t = tmp:get{i} if t ~= nil and #t[3] == 300 then good = good + 1 end end
+good
+s:drop()
+tmp:drop()
@@ -0,0 +1,40 @@
+-- offsets of all leading fields are stored in the field map
+s = box.schema.space.create('field_map', {field_map = 100})
+pk = s:create_index('pk')
+sk = s:create_index('sk', {parts = {50, 'unsigned'}})
+t = {} for i = 1, 120 do t[i] = i * 10 end
+_ = s:insert(t)
+t = s:get{10}
+t[1], t[2], t[80], t[100], t[101], t[120], t[121]
+#t
+sk:get{500}[100]
+-- tuples shorter than the mapped part
+t = {} for i = 1, 60 do t[i] = 20 + i end
+_ = s:insert(t)
+t = s:get{21}
+t[59], t[60], t[61], #t
+-- updates keep the map valid
+s:update({10}, {{'=', 80, 1}})[80]
+s:update({10}, {{'#', 2, 1}})[80]
+s:update({21}, {{'!', 30, 'x'}})[31]
+s:get{21}[30]
+s:drop()
+-- only every N-th field is mapped
+s = box.schema.space.create('field_map', {field_map = 100, field_map_step = 7})
+pk = s:create_index('pk')
+t = {} for i = 1, 100 do t[i] = i end
+_ = s:insert(t)
+t = s:get{1}
+ok = true for i = 1, 101 do if t[i] ~= (i <= 100 and i or nil) then ok = false end end
+ok
+t:totable(97)
+opts = box.space._space.index.name:get{'field_map'}[6]
+opts.field_map, opts.field_map_step
+s:drop()
+-- invalid options
+s = box.schema.space.create('field_map', {field_map = -1})
+s = box.schema.space.create('field_map', {field_map = 10, field_map_step = 0})
+s = box.schema.space.create('field_map', {field_map = 2147483648})
+s = box.schema.space.create('field_map', {field_map = 10, field_map_step = 2147483648})
+s = box.schema.space.create('field_map', {field_map = 100000})
+box.space.field_map
@@ -0,0 +1,66 @@
+package.cpath = '../box/?.so;../box/?.dylib;'..package.cpath
+
+--
+-- Functional indexes: TREE indexes on keys computed by a C
+-- stored function.
+--
+box.schema.func.create('function1.sum_key', {language = "C"})
+s = box.schema.space.create('test')
+_ = s:create_index('primary')
+
+-- Invalid definitions.
+s:create_index('sum', {func = 'no_such_function', parts = {1, 'unsigned'}})
+s:create_index('sum', {func = 'function1.sum_key', parts = {2, 'unsigned'}})
+s:create_index('sum', {func = 'function1.sum_key', type = 'hash', parts = {1, 'unsigned'}})
+s2 = box.schema.space.create('test2')
+s2:create_index('primary', {func = 'function1.sum_key', parts = {1, 'unsigned'}})
+s2:drop()
+s2 = box.schema.space.create('test2', {engine = 'vinyl'})
+_ = s2:create_index('primary')
+s2:create_index('sum', {func = 'function1.sum_key', parts = {1, 'unsigned'}})
+s2:drop()
+
+idx = s:create_index('sum', {func = 'function1.sum_key', parts = {1, 'unsigned'}, unique = false})
+idx.func
+s:insert{1, 1, 2}
+s:insert{2, 2, 2}
+s:insert{3, 3, 3}
+s:insert{4, 0, 10}
+idx:select{}
+idx:select{3}
+idx:select({3}, {iterator = 'GT'})
+idx:count({4}, {iterator = 'GE'})
+
+-- The function fails, the statement is rolled back.
+s:insert{5, 'x', 1}
+s:get{5}
+
+-- The key is recomputed on update.
+s:update({3}, {{'=', 3, 5}})
+idx:select{8}
+idx:select{6}
+s:delete{1}
+idx:select{}
+
+-- A unique functional index built on existing data.
+uidx = s:create_index('usum', {func = 'function1.sum_key', parts = {1, 'unsigned'}})
+uidx:select{}
+uidx:get{8}
+s:insert{6, 4, 0}
+idx:select{4}
+s:replace{2, 1, 1}
+uidx:select{}
+uidx:get_many{{2}, {8}, {9}}
+
+-- The function can't be dropped while an index uses it.
+ok, err = pcall(box.schema.func.drop, 'function1.sum_key')
+ok, tostring(err):match('function is used by a functional index') ~= nil
+
+-- Functional indexes don't support read views.
+ok, err = pcall(idx.pairs, idx, nil, {read_view = true})
+ok, tostring(err):match('does not support consistent read view') ~= nil
+
+uidx:drop()
+idx:drop()
+box.schema.func.drop('function1.sum_key')
+s:drop()
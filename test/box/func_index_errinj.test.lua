@@ -0,0 +1,55 @@
+package.cpath = '../box/?.so;../box/?.dylib;'..package.cpath
+errinj = box.error.injection
+
+--
+-- Keys removed from a functional index are kept by the
+-- statement and put back when it is rolled back.
+--
+box.schema.func.create('function1.sum_key', {language = "C"})
+s = box.schema.space.create('test')
+_ = s:create_index('primary')
+idx = s:create_index('sum', {func = 'function1.sum_key', parts = {1, 'unsigned'}, unique = false})
+uidx = s:create_index('usum', {func = 'function1.sum_key', parts = {1, 'unsigned'}})
+s:insert{1, 1, 2}
+s:insert{2, 2, 2}
+s:insert{3, 3, 3}
+
+-- A unique index fails after the key has been removed from
+-- the other one.
+s:replace{3, 1, 3}
+idx:select{}
+
+-- WAL write fails.
+errinj.set("ERRINJ_WAL_IO", true)
+s:insert{4, 0, 10}
+s:replace{1, 5, 5}
+s:update({2}, {{'=', 3, 0}})
+s:delete{3}
+box.begin() s:delete{1} s:replace{2, 1, 2} s:insert{5, 1, 1} box.commit()
+errinj.set("ERRINJ_WAL_IO", false)
+idx:select{}
+uidx:select{}
+uidx:get{4}
+s:replace{1, 5, 5}
+uidx:select{}
+
+-- Rollback takes the keys of both tuples from the statement
+-- and doesn't call the function: it is called twice per index
+-- to replace a tuple.
+net = require('net.box')
+box.schema.func.create('function1.sum_key_calls', {language = "C"})
+box.schema.user.grant('guest', 'execute', 'function', 'function1.sum_key_calls')
+c = net.connect(os.getenv("LISTEN"))
+calls = c:call('function1.sum_key_calls')[1][1]
+errinj.set("ERRINJ_WAL_IO", true)
+s:replace{1, 2, 3}
+errinj.set("ERRINJ_WAL_IO", false)
+c:call('function1.sum_key_calls')[1][1] - calls
+uidx:select{}
+c:close()
+box.schema.func.drop('function1.sum_key_calls')
+
+uidx:drop()
+idx:drop()
+box.schema.func.drop('function1.sum_key')
+s:drop()
@@ -42,6 +42,67 @@ args(box_function_ctx_t *ctx, const char *args, const char *args_end)
 	return box_return_tuple(ctx, tuple);
 }
 
+/** Number of sum_key() calls, see sum_key_calls(). */
+static uint64_t sum_key_call_count;
+
+/*
+ * Key function of a functional index: the key is the sum of
+ * the second and the third tuple fields.
+ */
+int
+sum_key(box_function_ctx_t *ctx, const char *args, const char *args_end)
+{
+	sum_key_call_count++;
+	uint32_t arg_count = mp_decode_array(&args);
+	if (arg_count < 3) {
+		return box_error_set(__FILE__, __LINE__, ER_PROC_C, "%s",
+			"invalid argument count");
+	}
+	mp_next(&args);
+	if (mp_typeof(*args) != MP_UINT) {
+		return box_error_set(__FILE__, __LINE__, ER_PROC_C, "%s",
+			"second tuple field must be uint");
+	}
+	uint64_t a = mp_decode_uint(&args);
+	if (mp_typeof(*args) != MP_UINT) {
+		return box_error_set(__FILE__, __LINE__, ER_PROC_C, "%s",
+			"third tuple field must be uint");
+	}
+	uint64_t b = mp_decode_uint(&args);
+
+	char tuple_buf[16];
+	char *d = tuple_buf;
+	d = mp_encode_array(d, 1);
+	d = mp_encode_uint(d, a + b);
+	assert(d <= tuple_buf + sizeof(tuple_buf));
+
+	box_tuple_format_t *fmt = box_tuple_format_default();
+	box_tuple_t *tuple = box_tuple_new(fmt, tuple_buf, d);
+	if (tuple == NULL)
+		return -1;
+	return box_return_tuple(ctx, tuple);
+}
+
+/*
+ * Return the number of sum_key() calls, to check when a
+ * functional index calls its function.
+ */
+int
+sum_key_calls(box_function_ctx_t *ctx, const char *args, const char *args_end)
+{
+	char tuple_buf[16];
+	char *d = tuple_buf;
+	d = mp_encode_array(d, 1);
+	d = mp_encode_uint(d, sum_key_call_count);
+	assert(d <= tuple_buf + sizeof(tuple_buf));
+
+	box_tuple_format_t *fmt = box_tuple_format_default();
+	box_tuple_t *tuple = box_tuple_new(fmt, tuple_buf, d);
+	if (tuple == NULL)
+		return -1;
+	return box_return_tuple(ctx, tuple);
+}
+
 /*
  * For each UINT key in arguments create or increment counter in
  * box.space.test space.
@@ -0,0 +1,32 @@
+s = box.schema.space.create('get_many')
+pk = s:create_index('pk')
+hash = s:create_index('hash', {type = 'hash', parts = {2, 'unsigned'}})
+sk = s:create_index('sk', {parts = {3, 'unsigned'}, unique = false})
+for i = 1, 100 do s:insert{i, i * 10, i % 7} end
+s:get_many{3, 1, 2}
+pk:get_many{{5}, 500, 6}
+hash:get_many{70, 71, 10}
+pk:get_many{}
+-- batches longer than a single lookup batch
+keys = {}
+for i = 1, 200 do keys[i] = 201 - i end
+r = pk:get_many(keys)
+#r, r[1][1], r[#r][1]
+keys = {}
+for i = 1, 200 do keys[i] = i * 5 end
+r = hash:get_many(keys)
+#r, r[1][1], r[#r][1]
+-- multipart keys
+m = box.schema.space.create('get_many_multipart')
+_ = m:create_index('pk', {parts = {1, 'unsigned', 2, 'string'}})
+m:insert{1, 'a'}
+m:insert{1, 'b'}
+m:insert{2, 'a'}
+m:get_many{{1, 'b'}, {2, 'b'}, {2, 'a'}}
+m:drop()
+-- errors
+sk:get_many{1}
+pk:get_many{{1, 2}}
+pk:get_many{'a'}
+pk:get_many(1)
+s:drop()
@@ -141,6 +141,10 @@ space.index['i1']:count(2, { iterator = 'GE' })
 space:count(2, { iterator = 'GE' })
 space.index['i1']:count({2, 0}, { iterator = 'LE' })
 space.index['i1']:count({2, 1}, { iterator = 'GE' })
+-- ALL with a key counts like GE, the same as select() returns
+space.index['i1']:count(2, { iterator = 'ALL' })
+space.index['i1']:count({2, 1}, { iterator = 'ALL' })
+#space.index['i1']:select({2, 1}, { iterator = 'ALL' })
 
 space.index['i1']:count(2)
 space.index['i1']:count({2, 1})
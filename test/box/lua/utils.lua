@@ -195,6 +195,37 @@ function check_space(space, N)
     return errors
 end
 
+-- Check that an index has all tuples of the primary key and
+-- returns them in key order.
+function check_index(index)
+    local space = box.space[index.space_id]
+    if index:count() ~= space:count() then
+        return false
+    end
+    local prev = nil
+    for _, t in index:pairs() do
+        local key = {}
+        for i, part in ipairs(index.parts) do
+            key[i] = t[part.fieldno]
+        end
+        if prev ~= nil and index.type == 'TREE' then
+            for i = 1, #key do
+                if key[i] < prev[i] then
+                    return false
+                end
+                if key[i] > prev[i] then
+                    break
+                end
+            end
+        end
+        if index:select(key)[1] == nil then
+            return false
+        end
+        prev = key
+    end
+    return true
+end
+
 function space_bsize(s)
     local bsize = 0
     for _, t in s:pairs() do
@@ -214,4 +245,5 @@ return {
     tuple_to_string = tuple_to_string;
     check_space = check_space;
     space_bsize = space_bsize;
+    check_index = check_index;
 };
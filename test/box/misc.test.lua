@@ -85,7 +85,10 @@ t = {};
 for k, v in pairs(box.slab.info()) do
     table.insert(t, k)
 end;
+table.sort(t);
 t;
+box.slab.info().huge_pages;
+box.slab.info().numa_node;
 box.runtime.info().used > 0;
 box.runtime.info().maxalloc > 0;
 
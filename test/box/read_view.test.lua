@@ -0,0 +1,49 @@
+s = box.schema.space.create('read_view')
+pk = s:create_index('pk')
+hk = s:create_index('hk', {type = 'hash', parts = {2, 'unsigned'}})
+for i = 1, 5 do s:insert{i, i * 10} end
+rv1 = pk:pairs(nil, {read_view = true})
+rv2 = hk:pairs({30}, {read_view = true})
+rv3 = s:pairs({3}, {iterator = 'GE', read_view = true})
+s:delete{3}
+s:replace{1, 100}
+s:insert{6, 60}
+box.slab.read_view_info().count
+box.slab.read_view_info().pinned_size > 0
+-- DDL is not allowed while a read view is open
+s:truncate()
+rv1:totable()
+rv2:totable()
+rv3:take(1):totable()
+box.slab.read_view_info().count
+-- an abandoned read view is released by the garbage collector
+rv3 = nil
+collectgarbage('collect')
+box.slab.read_view_info().count
+box.slab.read_view_info().pinned_size
+s:select{}
+s:truncate()
+-- equality iterators over a non-unique tree don't compare the key
+-- with tuples deleted after the read view is created
+sk = s:create_index('sk', {parts = {2, 'unsigned'}, unique = false})
+for i = 1, 10 do s:insert{i, i % 3} end
+rv1 = sk:pairs({1}, {read_view = true})
+rv2 = sk:pairs({1}, {iterator = 'REQ', read_view = true})
+for i = 1, 10 do s:delete{i} end
+for i = 11, 20 do s:insert{i, 1} end
+t = rv1:map(function(t) return t[1] end):totable()
+table.sort(t)
+t
+t = rv2:map(function(t) return t[1] end):totable()
+table.sort(t)
+t
+box.slab.read_view_info().count
+sk:count({1})
+sk:drop()
+s:truncate()
+-- not supported by other index types
+bk = s:create_index('bk', {type = 'bitset', parts = {2, 'unsigned'}, unique = false})
+ok, err = pcall(bk.pairs, bk, nil, {read_view = true})
+ok
+string.match(tostring(err), 'does not support consistent read view') ~= nil
+s:drop()
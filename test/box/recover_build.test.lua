@@ -0,0 +1,98 @@
+test_run = require('test_run').new()
+utils = dofile('utils.lua')
+
+--
+-- Secondary keys are built concurrently at the end of recovery.
+--
+s1 = box.schema.space.create('test1')
+_ = s1:create_index('pk')
+_ = s1:create_index('sk1', {parts = {2, 'unsigned'}, unique = false})
+_ = s1:create_index('sk2', {parts = {3, 'string', 1, 'unsigned'}})
+_ = s1:create_index('sk3', {type = 'hash', parts = {4, 'unsigned'}})
+_ = s1:create_index('sk4', {parts = {4, 'unsigned'}})
+s2 = box.schema.space.create('test2')
+_ = s2:create_index('pk', {parts = {1, 'string'}})
+_ = s2:create_index('sk1', {parts = {2, 'integer'}})
+_ = s2:create_index('sk2', {parts = {3, 'unsigned', 2, 'integer'}, unique = false})
+for i = 1, 1000 do s1:insert{i, i % 7, tostring(1000 - i), i * 3} end
+for i = 1, 500 do s2:insert{tostring(i), -i, i % 5} end
+box.snapshot()
+-- Rows recovered from the WAL.
+for i = 1001, 1100 do s1:insert{i, i % 7, tostring(1000 - i), i * 3} end
+s2:delete{'1'}
+
+test_run:cmd("restart server default")
+
+utils = dofile('utils.lua')
+s1 = box.space.test1
+s2 = box.space.test2
+s1:count()
+s2:count()
+utils.check_index(s1.index.sk1)
+utils.check_index(s1.index.sk2)
+utils.check_index(s1.index.sk3)
+utils.check_index(s1.index.sk4)
+utils.check_index(s2.index.sk1)
+utils.check_index(s2.index.sk2)
+s1.index.sk1:count{3}
+s1.index.sk2:get{'-100', 1100}
+s1.index.sk4:select({3297}, {iterator = 'GE'})
+s2.index.sk1:select({-2}, {iterator = 'LE', limit = 2})
+s2.index.sk2:select({0}, {limit = 3})
+
+s1:drop()
+s2:drop()
+
+--
+-- A tree index is not sorted on build if its input comes in
+-- key order. Build indexes on input in order, in reverse order
+-- and in order but for a few tuples.
+--
+s = box.schema.space.create('test')
+_ = s:create_index('pk')
+for i = 1, 100 do s:insert{i, i, 101 - i, i % 10 == 0 and 0 or i} end
+_ = s:create_index('asc', {parts = {2, 'unsigned'}})
+_ = s:create_index('desc', {parts = {3, 'unsigned'}})
+_ = s:create_index('mixed', {parts = {4, 'unsigned', 1, 'unsigned'}})
+utils.check_index(s.index.asc)
+utils.check_index(s.index.desc)
+utils.check_index(s.index.mixed)
+s.index.desc:select({}, {limit = 2})
+s.index.mixed:select({}, {limit = 3})
+box.snapshot()
+-- The primary key comes in order from the snapshot.
+test_run:cmd("restart server default")
+
+utils = dofile('utils.lua')
+s = box.space.test
+utils.check_index(s.index.pk)
+utils.check_index(s.index.asc)
+utils.check_index(s.index.desc)
+utils.check_index(s.index.mixed)
+s:select({}, {limit = 2})
+s.index.mixed:select({0}, {iterator = 'GT', limit = 2})
+s:drop()
+
+--
+-- A unique tree index is checked for duplicates after the
+-- input is sorted. The duplicates may end up at the beginning
+-- or at the end of the sorted input.
+--
+s = box.schema.space.create('test')
+_ = s:create_index('pk')
+for i = 1, 1000 do s:insert{i, i} end
+_ = s:replace{500, 1}
+_ = s:create_index('sk', {parts = {2, 'unsigned'}})
+s.index.sk == nil
+_ = s:replace{500, 1000}
+_ = s:create_index('sk', {parts = {2, 'unsigned'}})
+s.index.sk == nil
+-- Tuples differing in the last key part are not duplicates.
+_ = s:create_index('sk', {parts = {2, 'unsigned', 1, 'unsigned'}})
+utils.check_index(s.index.sk)
+s.index.sk:select({1000}, {iterator = 'GE'})
+s.index.sk:drop()
+_ = s:replace{500, 500}
+_ = s:create_index('sk', {parts = {2, 'unsigned'}})
+utils.check_index(s.index.sk)
+s:drop()
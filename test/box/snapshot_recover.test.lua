@@ -0,0 +1,74 @@
+test_run = require('test_run').new()
+
+--
+-- A snapshot is read ahead of TX in batches limited by row
+-- count and by size. Recover enough rows to fill every batch
+-- many times either way.
+--
+s1 = box.schema.space.create('test1')
+_ = s1:create_index('pk')
+s2 = box.schema.space.create('test2')
+_ = s2:create_index('pk')
+box.begin() for i = 1, 20000 do s1:insert{i, i * 2} end box.commit()
+box.begin() for i = 1, 40 do s2:insert{i, string.rep(string.char(64 + i), 200000)} end box.commit()
+box.snapshot()
+test_run:cmd("restart server default")
+
+s1 = box.space.test1
+s2 = box.space.test2
+s1:count()
+s2:count()
+bad = 0
+for i = 1, 20000 do if s1:get{i}[2] ~= i * 2 then bad = bad + 1 end end
+for i = 1, 40 do if s2:get{i}[2] ~= string.rep(string.char(64 + i), 200000) then bad = bad + 1 end end
+bad
+s1:drop()
+s2:drop()
+
+--
+-- Snapshot blocks are compressed in parallel and written in the
+-- order they were filled. Mix random and repetitive rows so that
+-- blocks compress differently.
+--
+fio = require('fio')
+xlog = require('xlog').pairs
+test_run:cmd("setopt delimiter ';'")
+function random_string(seed, len)
+    math.randomseed(seed)
+    local t = {}
+    for i = 1, len do
+        t[i] = string.char(math.random(0, 255))
+    end
+    return table.concat(t)
+end;
+test_run:cmd("setopt delimiter ''");
+s = box.schema.space.create('test')
+_ = s:create_index('pk')
+box.begin() for i = 1, 200 do s:insert{i, i % 2 == 0 and random_string(i, 10000) or string.rep('x', 10000)} end box.commit()
+box.snapshot()
+-- Rows of the snapshot are numbered 1..N, rows of the space come
+-- in key order.
+snaps = fio.glob(fio.pathjoin(box.cfg.memtx_dir, '*.snap'))
+table.sort(snaps)
+lsn, count, prev, ordered = 0, 0, 0, true
+for _, row in xlog(snaps[#snaps]) do lsn = lsn + 1 if row.HEADER.lsn ~= lsn then ordered = false end if row.BODY.space_id == s.id then count = count + 1 if row.BODY.tuple[1] ~= prev + 1 then ordered = false end prev = row.BODY.tuple[1] end end
+ordered
+count
+test_run:cmd("restart server default")
+
+test_run:cmd("setopt delimiter ';'")
+function random_string(seed, len)
+    math.randomseed(seed)
+    local t = {}
+    for i = 1, len do
+        t[i] = string.char(math.random(0, 255))
+    end
+    return table.concat(t)
+end;
+test_run:cmd("setopt delimiter ''");
+s = box.space.test
+s:count()
+bad = 0
+for i = 1, 200 do local v = i % 2 == 0 and random_string(i, 10000) or string.rep('x', 10000) if s:get{i}[2] ~= v then bad = bad + 1 end end
+bad
+s:drop()
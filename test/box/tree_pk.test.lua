@@ -191,3 +191,19 @@ utils.sort(s0.index['i2']:select(0))
 s0:drop()
 s0 = nil
 
+
+-- Comparison hints can be turned off for a TREE index
+s = box.schema.space.create('test')
+pk = s:create_index('pk', {parts = {1, 'string'}})
+sk = s:create_index('sk', {parts = {2, 'unsigned'}, hint = false})
+s.index.pk.hint
+s.index.sk.hint
+for i = 1, 10 do s:replace{'key' .. i, 10 - i} end
+s.index.sk:select({5}, {iterator = 'LE', limit = 3})
+s.index.pk:select({'key1'}, {iterator = 'GT', limit = 2})
+-- turning hints on rebuilds the index
+s.index.sk:alter({hint = true})
+s.index.sk.hint
+s.index.sk:select({5}, {iterator = 'GE', limit = 3})
+s:create_index('hash', {type = 'hash', hint = false})
+s:drop()
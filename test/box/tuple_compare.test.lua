@@ -0,0 +1,63 @@
+--
+-- Comparators specialized by key part types. Tuples are
+-- compared with each other on insertion and index build, and
+-- with keys on search. Hints are turned off for INTEGER keys
+-- so that every comparison reaches the comparator.
+--
+
+-- INTEGER key, negative values.
+s = box.schema.space.create('test')
+_ = s:create_index('primary', {parts = {1, 'integer'}, hint = false})
+for _, v in ipairs({5, -3, 0, -100, 42, -1}) do s:insert{v} end
+s:select{}
+s:select({-1}, {iterator = 'LT'})
+s:select({-2}, {iterator = 'GE'})
+s:get{-100}
+s:insert{-3}
+s:drop()
+
+-- Multipart INTEGER key, full and partial keys.
+s = box.schema.space.create('test')
+_ = s:create_index('primary', {parts = {1, 'integer', 2, 'integer', 3, 'integer'}, hint = false})
+for a = -1, 1 do for b = -1, 1 do s:insert{a, b, a + b} end end
+s:select{}
+s:select{-1}
+s:select({0, 0}, {iterator = 'GT'})
+s:select({1, -1}, {iterator = 'LE', limit = 3})
+s:get{0, -1, -1}
+
+-- Key not starting at the first field.
+sk = s:create_index('sk', {parts = {3, 'integer', 2, 'integer'}, hint = false})
+sk:select{0}
+sk:select({1, 0}, {iterator = 'GE'})
+sk:select({-1}, {iterator = 'LT'})
+sk:get{-1, 0}
+s:insert{0, 1, 0}
+s:drop()
+
+-- NUMBER key, integers mixed with doubles.
+s = box.schema.space.create('test')
+_ = s:create_index('primary', {parts = {1, 'number'}})
+sk = s:create_index('sk', {parts = {2, 'number'}, unique = false})
+for _, v in ipairs({1, -2, 1.5, -2.5, 3, 0.5}) do s:insert{v, -v} end
+s:select{}
+s:select({1}, {iterator = 'GT'})
+s:select({-2}, {iterator = 'LE'})
+s:get{1.5}
+s:get{2}
+sk:select({0}, {iterator = 'LT'})
+sk:select{2.5}
+s:insert{-2.5, 0}
+s:drop()
+
+-- SCALAR key, values of different types.
+s = box.schema.space.create('test')
+_ = s:create_index('primary', {parts = {1, 'scalar'}})
+for _, v in ipairs({'b', 10, true, -1.5, 'A', false, 2}) do s:insert{v} end
+s:select{}
+s:select({true}, {iterator = 'GT'})
+s:select({'a'}, {iterator = 'LT'})
+s:select({0}, {iterator = 'GE'})
+s:get{2}
+s:get{'a'}
+s:drop()
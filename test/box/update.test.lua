@@ -268,4 +268,34 @@ s:replace({1, 2, 3})
 t:update({{'=', 3, map}})
 s:update(1, {{'=', 3, map}})
 
+--
+-- In-place update of non-indexed fields
+--
+s:replace({1, 10, 'abc'})
+s:update(1, {{'+', 2, 1}})
+s:update(1, {{'=', 3, 'xyz'}})
+s:get{1}
+-- a referenced tuple must not change
+t = s:get{1}
+s:update(1, {{'+', 2, 1}})
+t
+s:get{1}
+t = nil
+-- rollback restores the old value
+box.begin() s:update(1, {{'+', 2, 100}}) box.rollback()
+s:get{1}
+-- the updated field is indexed
+sk = s:create_index('sk', {parts = {2, 'unsigned'}})
+s:update(1, {{'+', 2, 1}})
+sk:get{13}
+sk:drop()
+-- a tuple inserted before an index was added has an older format
+s:replace({2, 20, 'abc', 'def'})
+sk = s:create_index('sk', {parts = {3, 'string'}})
+s:update(2, {{'+', 2, 1}})
+s:update(2, {{'+', 2, 1}})
+s:get{2}
+sk:get{'abc'}
+sk:drop()
+
 s:drop()
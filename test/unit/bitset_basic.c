@@ -195,12 +195,66 @@ void test_get_set()
 	footer();
 }
 
+static
+void test_page_containers()
+{
+	header();
+
+	struct bitset bm;
+	bitset_create(&bm, realloc);
+	struct bitset_info info;
+
+	/* A sparse page is stored as an array of offsets */
+	const size_t BASE = 100000;
+	for (size_t i = 0; i < 10; i++)
+		fail_if(bitset_set(&bm, BASE + i * 7) < 0);
+	bitset_info(&bm, &info);
+	fail_unless(info.pages == 1 && info.array_pages == 1);
+	fail_unless(info.total_size < info.page_total_size);
+
+	/* A dense page is converted to a bitmap */
+	size_t page_bit = info.page_data_size * CHAR_BIT;
+	size_t first = BASE - BASE % page_bit;
+	for (size_t i = 0; i < page_bit; i += 2)
+		fail_if(bitset_set(&bm, first + i) < 0);
+	bitset_info(&bm, &info);
+	fail_unless(info.pages == 1 && info.array_pages == 0);
+	for (size_t i = 0; i < page_bit; i++) {
+		bool expected = i % 2 == 0 || (first + i >= BASE &&
+			first + i < BASE + 70 && (first + i - BASE) % 7 == 0);
+		fail_unless(bitset_test(&bm, first + i) == expected);
+	}
+
+	/* And back to an array when it becomes sparse again */
+	for (size_t i = 0; i < page_bit; i++)
+		fail_if(bitset_clear(&bm, first + i) < 0 ||
+			bitset_cardinality(&bm) > page_bit);
+	fail_unless(bitset_cardinality(&bm) == 0);
+	for (size_t i = 0; i < page_bit; i += 2)
+		fail_if(bitset_set(&bm, first + i) < 0);
+	for (size_t i = 0; i < page_bit; i += 2) {
+		if (i % 64 != 0)
+			fail_if(bitset_clear(&bm, first + i) < 0);
+	}
+	bitset_info(&bm, &info);
+	fail_unless(info.pages == 1 && info.array_pages == 1);
+	for (size_t i = 0; i < page_bit; i++) {
+		bool expected = i % 64 == 0;
+		fail_unless(bitset_test(&bm, first + i) == expected);
+	}
+
+	bitset_destroy(&bm);
+
+	footer();
+}
+
 int main(int argc, char *argv[])
 {
 	setbuf(stdout, NULL);
 	srand(time(NULL));
 	test_cardinality();
 	test_get_set();
+	test_page_containers();
 
 	return 0;
 }
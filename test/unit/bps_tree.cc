@@ -60,6 +60,27 @@ compare(type_t a, type_t b);
 #undef bps_tree_key_t
 #undef bps_tree_arg_t
 
+/* tree with child cardinalities for offset tests */
+#define BPS_TREE_NAME card
+#define BPS_TREE_BLOCK_SIZE 128 /* value is to low specially for tests */
+#define BPS_TREE_EXTENT_SIZE 2048 /* value is to low specially for tests */
+#define BPS_TREE_COMPARE(a, b, arg) compare(a, b)
+#define BPS_TREE_COMPARE_KEY(a, b, arg) compare(a, b)
+#define bps_tree_elem_t type_t
+#define bps_tree_key_t type_t
+#define bps_tree_arg_t int
+#define BPS_INNER_CHILD_CARDS
+#include "salad/bps_tree.h"
+#undef BPS_TREE_NAME
+#undef BPS_TREE_BLOCK_SIZE
+#undef BPS_TREE_EXTENT_SIZE
+#undef BPS_TREE_COMPARE
+#undef BPS_TREE_COMPARE_KEY
+#undef bps_tree_elem_t
+#undef bps_tree_key_t
+#undef bps_tree_arg_t
+#undef BPS_INNER_CHILD_CARDS
+
 /* tree for approximate_count test */
 #define BPS_TREE_NAME approx
 #define BPS_TREE_BLOCK_SIZE 128 /* value is to low specially for tests */
@@ -755,6 +776,131 @@ approximate_count()
 	footer();
 }
 
+static void
+offset_check_tree(card *tree, const bool *present, int elem_limit)
+{
+	if (card_debug_check(tree))
+		fail("debug check nonzero", "true");
+	size_t offset = 0;
+	for (int i = 0; i < elem_limit; i++) {
+		size_t lower, upper;
+		bool exact;
+		card_iterator itr =
+			card_lower_bound_get_offset(tree, i, &exact, &lower);
+		if (lower != offset || exact != present[i])
+			fail("lower bound offset", "false");
+		if (card_iterator_get_offset(tree, &itr) != lower)
+			fail("iterator offset", "false");
+		card_upper_bound_get_offset(tree, i, NULL, &upper);
+		if (upper != offset + present[i])
+			fail("upper bound offset", "false");
+		if (present[i]) {
+			itr = card_iterator_at(tree, offset);
+			type_t *elem = card_iterator_get_elem(tree, &itr);
+			if (elem == NULL || *elem != i)
+				fail("iterator at offset", "false");
+			offset++;
+		}
+	}
+	if (offset != tree->size)
+		fail("tree size", "false");
+	card_iterator itr = card_iterator_at(tree, offset);
+	if (!card_iterator_is_invalid(&itr))
+		fail("iterator at the end", "false");
+}
+
+static void
+offset_check()
+{
+	header();
+
+	if (card_debug_check_internal_functions(false))
+		fail("debug self test", "true");
+
+	card tree;
+	card_create(&tree, 0, extent_alloc, extent_free, &extents_count);
+
+	const int rounds = 16 * 1024;
+	const int elem_limit = 1024;
+	bool present[elem_limit];
+	memset(present, 0, sizeof(present));
+
+	for (int i = 0; i < rounds; i++) {
+		type_t rnd = rand() % elem_limit;
+		if (present[rnd])
+			card_delete(&tree, rnd);
+		else
+			card_insert(&tree, rnd, 0);
+		present[rnd] = !present[rnd];
+		if (i % 64 == 0)
+			offset_check_tree(&tree, present, elem_limit);
+	}
+	offset_check_tree(&tree, present, elem_limit);
+	card_destroy(&tree);
+
+	card_create(&tree, 0, extent_alloc, extent_free, &extents_count);
+	type_t arr[elem_limit];
+	int count = 0;
+	for (int i = 0; i < elem_limit; i++) {
+		present[i] = i % 3 != 0;
+		if (present[i])
+			arr[count++] = i;
+	}
+	card_build(&tree, arr, count);
+	offset_check_tree(&tree, present, elem_limit);
+	for (int i = 0; i < elem_limit; i += 2) {
+		if (present[i])
+			card_delete(&tree, i);
+		else
+			card_insert(&tree, i, 0);
+		present[i] = !present[i];
+	}
+	offset_check_tree(&tree, present, elem_limit);
+	card_destroy(&tree);
+
+	footer();
+}
+
+static void
+find_batch_check()
+{
+	header();
+
+	test tree;
+	test_create(&tree, 0, extent_alloc, extent_free, &extents_count);
+
+	const int elem_limit = 8192;
+	const int batch_limit = 100;
+	type_t keys[batch_limit];
+	type_t *found[batch_limit];
+
+	/* empty tree */
+	for (int j = 0; j < batch_limit; j++)
+		keys[j] = j;
+	test_find_batch(&tree, keys, batch_limit, found);
+	for (int j = 0; j < batch_limit; j++)
+		if (found[j] != NULL)
+			fail("found in empty tree", "true");
+
+	/* even numbers only, so that half of the keys are missing */
+	for (type_t i = 0; i < elem_limit; i += 2)
+		test_insert(&tree, i, 0);
+
+	for (int i = 0; i < 64; i++) {
+		int batch_size = 1 + rand() % batch_limit;
+		for (int j = 0; j < batch_size; j++)
+			keys[j] = rand() % (elem_limit + 16) - 8;
+		test_find_batch(&tree, keys, batch_size, found);
+		for (int j = 0; j < batch_size; j++) {
+			if (found[j] != test_find(&tree, keys[j]))
+				fail("batch find differs from find", "true");
+		}
+	}
+	test_destroy(&tree);
+
+	footer();
+}
+
 int
 main(void)
 {
@@ -766,6 +912,8 @@ main(void)
 	printing_test();
 	white_box_test();
 	approximate_count();
+	offset_check();
+	find_batch_check();
 	if (extents_count != 0)
 		fail("memory leak!", "true");
 }
@@ -3,6 +3,7 @@
 #include <stdio.h>
 #include <stdbool.h>
 #include <inttypes.h>
+#include <string.h>
 
 #include "unit.h"
 #include "salad/rtree.h"
@@ -260,12 +261,122 @@ neighbor_test()
 	footer();
 }
 
+static void
+bulk_extract_rect(struct rtree_rect *rect, record_t record, void *ctx)
+{
+	struct rtree_rect *arr = (struct rtree_rect *)ctx;
+	*rect = arr[(uintptr_t)record - 1];
+}
+
+static void
+bulk_check_tree(struct rtree *tree, struct rtree_rect *arr, bool *present,
+		unsigned dimension, size_t count)
+{
+	struct rtree_iterator iterator;
+	rtree_iterator_init(&iterator);
+	size_t expected = 0;
+	for (size_t i = 0; i < count; i++)
+		expected += present[i];
+	if (rtree_number_of_records(tree) != expected)
+		fail("number of records", "false");
+
+	struct rtree_rect all;
+	memset(&all, 0, sizeof(all));
+	size_t found = 0;
+	rtree_search(tree, &all, SOP_ALL, &iterator);
+	while (rtree_iterator_next(&iterator) != NULL)
+		found++;
+	if (found != expected)
+		fail("all records are found", "false");
+
+	for (int k = 0; k < 16; k++) {
+		struct rtree_rect box;
+		for (unsigned d = 0; d < dimension; d++) {
+			box.coords[2 * d] = rand() % 1000;
+			box.coords[2 * d + 1] = box.coords[2 * d] + rand() % 300;
+		}
+		size_t overlaps = 0;
+		for (size_t i = 0; i < count; i++) {
+			if (!present[i])
+				continue;
+			bool match = true;
+			for (unsigned d = 0; d < dimension; d++) {
+				if (arr[i].coords[2 * d] > box.coords[2 * d + 1] ||
+				    arr[i].coords[2 * d + 1] < box.coords[2 * d])
+					match = false;
+			}
+			overlaps += match;
+		}
+		found = 0;
+		rtree_search(tree, &box, SOP_OVERLAPS, &iterator);
+		while (rtree_iterator_next(&iterator) != NULL)
+			found++;
+		if (found != overlaps)
+			fail("overlapping records are found", "false");
+	}
+	rtree_iterator_destroy(&iterator);
+}
+
+static void
+bulk_build_test()
+{
+	header();
+
+	const size_t max_count = 5000;
+	const size_t counts[] = {0, 1, 2, 24, 25, 26, 60, 1000, max_count};
+	struct rtree_rect *arr = (struct rtree_rect *)
+		malloc(max_count * sizeof(*arr));
+	record_t *records = (record_t *)malloc(max_count * sizeof(*records));
+	bool *present = (bool *)malloc(max_count * sizeof(*present));
+
+	for (unsigned dimension = 1; dimension <= 3; dimension++) {
+		for (size_t c = 0; c < sizeof(counts) / sizeof(counts[0]); c++) {
+			size_t count = counts[c];
+			for (size_t i = 0; i < count; i++) {
+				for (unsigned d = 0; d < dimension; d++) {
+					coord_t v = rand() % 1000;
+					arr[i].coords[2 * d] = v;
+					arr[i].coords[2 * d + 1] = v + rand() % 10;
+				}
+				records[i] = (record_t)(i + 1);
+				present[i] = true;
+			}
+			struct rtree tree;
+			rtree_init(&tree, dimension, extent_size,
+				   extent_alloc, extent_free, &page_count,
+				   RTREE_EUCLID);
+			if (rtree_build(&tree, records, count,
+					bulk_extract_rect, arr) != 0)
+				fail("build", "true");
+			bulk_check_tree(&tree, arr, present, dimension, count);
+			/* the tree must stay valid under modifications */
+			for (size_t i = 0; i < count; i += 2) {
+				if (!rtree_remove(&tree, &arr[i], records[i]))
+					fail("remove", "false");
+				present[i] = false;
+			}
+			bulk_check_tree(&tree, arr, present, dimension, count);
+			for (size_t i = 0; i < count; i += 2) {
+				rtree_insert(&tree, &arr[i], records[i]);
+				present[i] = true;
+			}
+			bulk_check_tree(&tree, arr, present, dimension, count);
+			rtree_destroy(&tree);
+		}
+	}
+	free(present);
+	free(records);
+	free(arr);
+
+	footer();
+}
 
 int
 main(void)
 {
 	simple_check();
 	neighbor_test();
+	bulk_build_test();
 	if (page_count != 0) {
 		fail("memory leak!", "true");
 	}
@@ -0,0 +1,10 @@
+#!/usr/bin/env tarantool
+
+box.cfg({
+    listen            = os.getenv("LISTEN"),
+    vinyl_memory      = 128 * 1024 * 1024,
+    vinyl_page_size   = 1024,
+    vinyl_direct_io   = true,
+})
+
+require('console').listen(os.getenv('ADMIN'))
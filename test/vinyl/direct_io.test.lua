@@ -0,0 +1,35 @@
+test_run = require('test_run').new()
+
+test_run:cmd('create server direct_io with script="vinyl/direct_io.lua"')
+test_run:cmd("start server direct_io")
+test_run:cmd('switch direct_io')
+
+box.cfg.vinyl_direct_io
+
+s = box.schema.space.create('test', {engine = 'vinyl'})
+_ = s:create_index('pk', {run_count_per_level = 1})
+pad = string.rep('x', 10)
+for i = 1, 1000 do s:replace{i, pad} end
+box.snapshot()
+for i = 1, 1000, 2 do s:replace{i, pad, i} end
+box.snapshot()
+s:count()
+s:get{1}
+s:get{2}
+s:get{1000}
+
+test_run:cmd('switch default')
+test_run:cmd("stop server direct_io")
+test_run:cmd("start server direct_io")
+test_run:cmd('switch direct_io')
+
+s = box.space.test
+s:count()
+s:get{1}
+s:get{2}
+s:get{1000}
+s:drop()
+
+test_run:cmd('switch default')
+test_run:cmd("stop server direct_io")
+test_run:cmd("cleanup server direct_io")
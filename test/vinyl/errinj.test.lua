@@ -130,3 +130,27 @@ for i=1,256 do s:upsert({0, 0}, {{'+', 2, 1}}) end
 s:drop() -- index is gone
 fiber.sleep(0.05)
 errinj.set("ERRINJ_VY_SQUASH_TIMEOUT", 0)
+
+--
+-- The worker pool grows while there is dump backlog and shrinks
+-- back when workers stay idle.
+--
+box.cfg{vinyl_threads = 4}
+box.info.vinyl().scheduler.workers_max
+errinj.set("ERRINJ_VY_WORKER_IDLE_TIMEOUT", 10)
+while box.info.vinyl().scheduler.workers > 2 do fiber.sleep(0.01) end
+box.info.vinyl().scheduler.workers
+spaces = {}
+for i = 1, 4 do spaces[i] = box.schema.space.create('test'..i, {engine='vinyl'}) spaces[i]:create_index('pk') spaces[i]:insert{i} end
+errinj.set("ERRINJ_VY_TASK_DELAY", true)
+c = fiber.channel(1)
+_ = fiber.create(function() box.snapshot() c:put(true) end)
+while box.info.vinyl().scheduler.workers < 4 do fiber.sleep(0.01) end
+box.info.vinyl().scheduler.workers
+errinj.set("ERRINJ_VY_TASK_DELAY", false)
+c:get()
+while box.info.vinyl().scheduler.workers > 2 do fiber.sleep(0.01) end
+box.info.vinyl().scheduler.workers
+errinj.set("ERRINJ_VY_WORKER_IDLE_TIMEOUT", 0)
+for i = 1, 4 do spaces[i]:drop() end
+box.cfg{vinyl_threads = 3}
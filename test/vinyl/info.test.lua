@@ -18,7 +18,8 @@ for _, v in ipairs({ 'path', 'build', 'tx_latency', 'cursor_latency',
                      'page_count', 'memory_used', 'run_max', 'run_histogram',
                      'size', 'size_uncompressed', 'used', 'count', 'rps',
                      'total', 'dumped_statements', 'bandwidth', 'avg', 'max',
-                     'watermark' }) do
+                     'watermark', 'scan_latency', 'lookup_runs',
+                     'lookup_pages', 'disk_bytes', 'returned_bytes' }) do
     test_run:cmd("push filter '"..v..": .*' to '"..v..": <"..v..">'")
 end;
 test_run:cmd("setopt delimiter ''");
@@ -57,5 +58,71 @@ box.info.vinyl().memory.min_lsn == box.info.vclock[1]
 space:drop()
 box.info.vinyl().memory.min_lsn
 
+--
+-- Read statistics: a lookup served from a disk run, the same
+-- lookup served from the cache and a range scan.
+--
+space = box.schema.space.create('test', { engine = 'vinyl' })
+index = space:create_index('primary', { page_size = 128 })
+for i = 1, 10 do space:replace({i, string.rep('x', 100)}) end
+box.snapshot()
+
+test_run:cmd("setopt delimiter ';'")
+-- Return the total number of requests in a histogram and the
+-- number of requests that fell into buckets above zero.
+function hist_count(h)
+    local total, nonzero = 0, 0
+    for min, count in h:gmatch('%[(%d+)%-?%d*%]:(%d+)') do
+        total = total + tonumber(count)
+        if tonumber(min) > 0 then
+            nonzero = nonzero + tonumber(count)
+        end
+    end
+    return total, nonzero
+end;
+function read_stat()
+    local s = box.info.vinyl().db[space.id..'/0'].read
+    local r = {}
+    r.get = hist_count(s.get_latency)
+    r.scan = hist_count(s.scan_latency)
+    _, r.runs = hist_count(s.lookup_runs)
+    r.lookups, r.pages = hist_count(s.lookup_pages)
+    r.disk = s.disk_bytes
+    r.returned = s.returned_bytes
+    return r
+end;
+test_run:cmd("setopt delimiter ''");
+
+s1 = read_stat()
+space:get({1})[1]
+s2 = read_stat()
+s2.get - s1.get
+s2.lookups - s1.lookups
+s2.runs - s1.runs
+s2.pages - s1.pages
+s2.disk > s1.disk
+s2.returned - s1.returned
+
+-- the second lookup of the same key is served by the cache
+space:get({1})[1]
+s3 = read_stat()
+s3.get - s2.get
+s3.lookups - s2.lookups
+s3.runs - s2.runs
+s3.pages - s2.pages
+s3.disk - s2.disk
+s3.returned - s2.returned
+
+-- a full scan has to read all pages of the run
+#space:select()
+s4 = read_stat()
+s4.scan - s3.scan
+s4.get - s3.get
+s4.pages - s3.pages
+s4.disk - s3.disk > s2.disk - s1.disk
+s4.returned - s3.returned
+
+space:drop()
+
 test_run:cmd('switch default')
 test_run:cmd("stop server vinyl_info")
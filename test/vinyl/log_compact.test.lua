@@ -0,0 +1,86 @@
+test_run = require('test_run').new()
+fiber = require('fiber')
+fio = require('fio')
+
+errinj = box.error.injection
+
+test_run:cmd("setopt delimiter ';'")
+function vylog_size()
+    local files = fio.glob(fio.pathjoin(box.cfg.vinyl_dir, '*.vylog'))
+    table.sort(files)
+    return fio.stat(files[#files]).size
+end;
+function vinyl_state(space)
+    local result = {}
+    for _, index in ipairs({space.index[0], space.index[1]}) do
+        local info = box.info.vinyl().db[space.id..'/'..index.id]
+        table.insert(result, {info.range_count, info.run_count, info.count})
+    end
+    return result
+end;
+test_run:cmd("setopt delimiter ''");
+
+--
+-- Check that the metadata log compacted in place is
+-- recovered to the same state as the original one.
+--
+
+s1 = box.schema.space.create('test1', {engine = 'vinyl'})
+_ = s1:create_index('pk', {run_count_per_level = 10})
+_ = s1:create_index('sk', {parts = {2, 'unsigned'}, run_count_per_level = 10})
+for i = 1, 10 do s1:replace{i, i * 10} end
+box.snapshot()
+for i = 11, 20 do s1:replace{i, i * 10} end
+box.snapshot()
+
+-- Fill the log with records of dropped indexes.
+test_run:cmd("setopt delimiter ';'")
+for i = 1, 20 do
+    local s = box.schema.space.create('tmp', {engine = 'vinyl'})
+    s:create_index('pk')
+    s:create_index('sk', {parts = {2, 'unsigned'}})
+    s:drop()
+end;
+test_run:cmd("setopt delimiter ''");
+
+s2 = box.schema.space.create('test2', {engine = 'vinyl'})
+_ = s2:create_index('pk')
+size = vylog_size()
+
+-- The next log write starts compaction.
+errinj.set('ERRINJ_VY_LOG_COMPACT', true)
+_ = s2:create_index('sk', {parts = {2, 'unsigned'}})
+while vylog_size() >= size do fiber.sleep(0.01) end
+errinj.info().ERRINJ_VY_LOG_COMPACT.state
+
+for i = 1, 10 do s2:replace{i, i * 100} end
+vinyl_state(s1)
+vinyl_state(s2)
+
+test_run:cmd('restart server default')
+
+test_run = require('test_run').new()
+
+s1 = box.space.test1
+s2 = box.space.test2
+
+test_run:cmd("setopt delimiter ';'")
+function vinyl_state(space)
+    local result = {}
+    for _, index in ipairs({space.index[0], space.index[1]}) do
+        local info = box.info.vinyl().db[space.id..'/'..index.id]
+        table.insert(result, {info.range_count, info.run_count, info.count})
+    end
+    return result
+end;
+test_run:cmd("setopt delimiter ''");
+
+vinyl_state(s1)
+vinyl_state(s2)
+s1.index.sk:select({}, {limit = 3})
+s2.index.sk:select({}, {limit = 3})
+s1:count()
+s2:count()
+
+s1:drop()
+s2:drop()
@@ -45,3 +45,20 @@ space:select{}
 box.info.vinyl().memory.used
 
 space:drop()
+
+--
+-- Per-index memory limit
+--
+
+space = box.schema.space.create('test', { engine = 'vinyl' })
+space:create_index('pk', { memory_limit = -1 })
+pk = space:create_index('pk', { memory_limit = 4096 })
+fiber = require('fiber')
+for i = 1, 100 do space:insert({i, string.rep('x', 100)}) end
+info = function() return box.info.vinyl().db[space.id..'/0'] end
+info().memory_limit
+while info().run_count == 0 do fiber.sleep(0.01) end
+while info().memory_used > 4096 do fiber.sleep(0.01) end
+info().memory_used <= 4096
+space:count()
+space:drop()